@@ -60,6 +60,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/time.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/threadpool.h"
 #include "libavcodec/mathops.h"
 #include "libavformat/os_support.h"
 
@@ -118,7 +119,7 @@ const char *const forced_keyframes_const_names[] = {
     NULL
 };
 
-static void do_video_stats(OutputStream *ost, int frame_size);
+static int do_video_stats(OutputStream *ost, int frame_size);
 static int64_t getutime(void);
 static int64_t getmaxrss(void);
 
@@ -156,7 +157,26 @@ static int restore_tty;
 
 #if HAVE_PTHREADS
 static void free_input_threads(void);
+static int free_output_threads(int abort);
+
+/* protects the muxers, the finished state of the output streams and the
+ * statistics shared by the encoding threads and the main thread */
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void lock_output(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&output_lock);
 #endif
+}
+
+static void unlock_output(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&output_lock);
+#endif
+}
 
 /* sub2video hack:
    Convert subtitles to video with alpha to insert them in filter graphs.
@@ -427,6 +447,10 @@ static void ffmpeg_cleanup(int ret)
 {
     int i, j;
 
+#if HAVE_PTHREADS
+    free_output_threads(1);
+#endif
+
     if (do_benchmark) {
         int maxrss = getmaxrss() / 1024;
         printf("bench: maxrss=%ikB\n", maxrss);
@@ -524,6 +548,8 @@ static void ffmpeg_cleanup(int ret)
 
     uninit_opts();
 
+    av_thread_pool_set_global(NULL);
+
     avformat_network_deinit();
 
     if (received_sigterm) {
@@ -578,13 +604,20 @@ static void update_benchmark(const char *fmt, ...)
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
+    lock_output();
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost2 = output_streams[i];
         ost2->finished |= ost == ost2 ? this_stream : others;
     }
+    unlock_output();
 }
 
-static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
+/**
+ * Mux pkt, after filtering it through the bitstream filters of ost.
+ *
+ * @return 0 on success, a negative error code on a fatal error
+ */
+static int write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
 {
     AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
     AVCodecContext          *avctx = ost->encoding_needed ? ost->enc_ctx : ost->st->codec;
@@ -610,11 +643,14 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
      * reordering, see do_video_out()
      */
     if (!(avctx->codec_type == AVMEDIA_TYPE_VIDEO && avctx->codec)) {
+        lock_output();
         if (ost->frame_number >= ost->max_frames) {
+            unlock_output();
             av_free_packet(pkt);
-            return;
+            return 0;
         }
         ost->frame_number++;
+        unlock_output();
     }
 
     if (bsfc)
@@ -648,14 +684,16 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
             new_pkt.buf = av_buffer_create(new_pkt.data, new_pkt.size,
                                            av_buffer_default_free, NULL, 0);
             if (!new_pkt.buf)
-                exit_program(1);
+                return AVERROR(ENOMEM);
         } else if (a < 0) {
             av_log(NULL, AV_LOG_ERROR, "Failed to open bitstream filter %s for stream %d with codec %s",
                    bsfc->filter->name, pkt->stream_index,
                    avctx->codec ? avctx->codec->name : "copy");
             print_error("", a);
-            if (exit_on_error)
-                exit_program(1);
+            if (exit_on_error) {
+                av_free_packet(pkt);
+                return a;
+            }
         }
         *pkt = new_pkt;
 
@@ -686,7 +724,8 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
                ost->file_index, ost->st->index, ost->last_mux_dts, pkt->dts);
         if (exit_on_error) {
             av_log(NULL, AV_LOG_FATAL, "aborting.\n");
-            exit_program(1);
+            av_free_packet(pkt);
+            return AVERROR(EINVAL);
         }
         av_log(s, loglevel, "changing to %"PRId64". This may result "
                "in incorrect timestamps in the output file.\n",
@@ -714,16 +753,20 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
               );
     }
 
+    lock_output();
     ret = av_interleaved_write_frame(s, pkt);
+    unlock_output();
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
         close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
     }
     av_free_packet(pkt);
+    return 0;
 }
 
-static void close_output_stream(OutputStream *ost)
+/* must be called with output_lock held */
+static void close_output_stream_locked(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
 
@@ -734,21 +777,31 @@ static void close_output_stream(OutputStream *ost)
     }
 }
 
+static void close_output_stream(OutputStream *ost)
+{
+    lock_output();
+    close_output_stream_locked(ost);
+    unlock_output();
+}
+
 static int check_recording_time(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
+    int ret = 1;
 
+    lock_output();
     if (of->recording_time != INT64_MAX &&
         av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, of->recording_time,
                       AV_TIME_BASE_Q) >= 0) {
-        close_output_stream(ost);
-        return 0;
+        close_output_stream_locked(ost);
+        ret = 0;
     }
-    return 1;
+    unlock_output();
+    return ret;
 }
 
-static void do_audio_out(AVFormatContext *s, OutputStream *ost,
-                         AVFrame *frame)
+static int do_audio_out(AVFormatContext *s, OutputStream *ost,
+                        AVFrame *frame)
 {
     AVCodecContext *enc = ost->enc_ctx;
     AVPacket pkt;
@@ -759,11 +812,13 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
     pkt.size = 0;
 
     if (!check_recording_time(ost))
-        return;
+        return 0;
 
     if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
         frame->pts = ost->sync_opts;
+    lock_output();
     ost->sync_opts = frame->pts + frame->nb_samples;
+    unlock_output();
     ost->samples_encoded += frame->nb_samples;
     ost->frames_encoded++;
 
@@ -778,7 +833,7 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
 
     if (avcodec_encode_audio2(enc, &pkt, frame, &got_packet) < 0) {
         av_log(NULL, AV_LOG_FATAL, "Audio encoding failed (avcodec_encode_audio2)\n");
-        exit_program(1);
+        return AVERROR_EXTERNAL;
     }
     update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
 
@@ -792,8 +847,9 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
         }
 
-        write_frame(s, &pkt, ost);
+        return write_frame(s, &pkt, ost);
     }
+    return 0;
 }
 
 static void do_subtitle_out(AVFormatContext *s,
@@ -876,14 +932,16 @@ static void do_subtitle_out(AVFormatContext *s,
                 pkt.pts += 90 * sub->end_display_time;
         }
         pkt.dts = pkt.pts;
-        write_frame(s, &pkt, ost);
+        if (write_frame(s, &pkt, ost) < 0)
+            exit_program(1);
     }
 }
 
-static void do_video_out(AVFormatContext *s,
-                         OutputStream *ost,
-                         AVFrame *next_picture,
-                         double sync_ipts)
+static int do_video_out(AVFormatContext *s,
+                        OutputStream *ost,
+                        AVFrame *next_picture,
+                        double sync_ipts,
+                        AVRational frame_rate)
 {
     int ret, format_video_sync;
     AVPacket pkt;
@@ -894,14 +952,12 @@ static void do_video_out(AVFormatContext *s,
     double duration = 0;
     int frame_size = 0;
     InputStream *ist = NULL;
-    AVFilterContext *filter = ost->filter->filter;
 
     if (ost->source_index >= 0)
         ist = input_streams[ost->source_index];
 
-    if (filter->inputs[0]->frame_rate.num > 0 &&
-        filter->inputs[0]->frame_rate.den > 0)
-        duration = 1/(av_q2d(filter->inputs[0]->frame_rate) * av_q2d(enc->time_base));
+    if (frame_rate.num > 0 && frame_rate.den > 0)
+        duration = 1/(av_q2d(frame_rate) * av_q2d(enc->time_base));
 
     if(ist && ist->st->start_time != AV_NOPTS_VALUE && ist->st->first_dts != AV_NOPTS_VALUE && ost->frame_rate.num)
         duration = FFMIN(duration, 1/(av_q2d(ost->frame_rate) * av_q2d(enc->time_base)));
@@ -1002,7 +1058,9 @@ static void do_video_out(AVFormatContext *s,
     ost->last_nb0_frames[0] = nb0_frames;
 
     if (nb0_frames == 0 && ost->last_droped) {
+        lock_output();
         nb_frames_drop++;
+        unlock_output();
         av_log(NULL, AV_LOG_VERBOSE,
                "*** dropping frame %d from stream %d at ts %"PRId64"\n",
                ost->frame_number, ost->st->index, ost->last_frame->pts);
@@ -1010,10 +1068,14 @@ static void do_video_out(AVFormatContext *s,
     if (nb_frames > (nb0_frames && ost->last_droped) + (nb_frames > nb0_frames)) {
         if (nb_frames > dts_error_threshold * 30) {
             av_log(NULL, AV_LOG_ERROR, "%d frame duplication too large, skipping\n", nb_frames - 1);
+            lock_output();
             nb_frames_drop++;
-            return;
+            unlock_output();
+            return 0;
         }
+        lock_output();
         nb_frames_dup += nb_frames - (nb0_frames && ost->last_droped) - (nb_frames > nb0_frames);
+        unlock_output();
         av_log(NULL, AV_LOG_VERBOSE, "*** %d dup!\n", nb_frames - 1);
     }
     ost->last_droped = nb_frames == nb0_frames && next_picture;
@@ -1031,7 +1093,7 @@ static void do_video_out(AVFormatContext *s,
         in_picture = next_picture;
 
     if (!in_picture)
-        return;
+        return 0;
 
     in_picture->pts = ost->sync_opts;
 
@@ -1040,7 +1102,7 @@ static void do_video_out(AVFormatContext *s,
 #else
     if (ost->frame_number >= ost->max_frames)
 #endif
-        return;
+        return 0;
 
     if (s->oformat->flags & AVFMT_RAWPICTURE &&
         enc->codec->id == AV_CODEC_ID_RAWVIDEO) {
@@ -1056,7 +1118,8 @@ static void do_video_out(AVFormatContext *s,
         pkt.pts    = av_rescale_q(in_picture->pts, enc->time_base, ost->st->time_base);
         pkt.flags |= AV_PKT_FLAG_KEY;
 
-        write_frame(s, &pkt, ost);
+        if ((ret = write_frame(s, &pkt, ost)) < 0)
+            return ret;
     } else {
         int got_packet, forced_keyframe = 0;
         double pts_time;
@@ -1129,7 +1192,7 @@ static void do_video_out(AVFormatContext *s,
         update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
         if (ret < 0) {
             av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
-            exit_program(1);
+            return ret;
         }
 
         if (got_packet) {
@@ -1153,7 +1216,8 @@ static void do_video_out(AVFormatContext *s,
             }
 
             frame_size = pkt.size;
-            write_frame(s, &pkt, ost);
+            if ((ret = write_frame(s, &pkt, ost)) < 0)
+                return ret;
 
             /* if two pass, output log */
             if (ost->logfile && enc->stats_out) {
@@ -1161,6 +1225,7 @@ static void do_video_out(AVFormatContext *s,
             }
         }
     }
+    lock_output();
     ost->sync_opts++;
     /*
      * For video, number of frames in == number of packets out.
@@ -1168,9 +1233,15 @@ static void do_video_out(AVFormatContext *s,
      * flush, we need to limit them here, before they go into encoder.
      */
     ost->frame_number++;
+    if (enc->coded_frame) {
+        ost->quality = enc->coded_frame->quality;
+        memcpy(ost->error, enc->coded_frame->error, sizeof(ost->error));
+    }
+    unlock_output();
 
     if (vstats_filename && frame_size)
-        do_video_stats(ost, frame_size);
+        if ((ret = do_video_stats(ost, frame_size)) < 0)
+            return ret;
   }
 
     if (!ost->last_frame)
@@ -1178,6 +1249,7 @@ static void do_video_out(AVFormatContext *s,
     av_frame_unref(ost->last_frame);
     if (next_picture)
         av_frame_ref(ost->last_frame, next_picture);
+    return 0;
 }
 
 static double psnr(double d)
@@ -1185,18 +1257,21 @@ static double psnr(double d)
     return -10.0 * log(d) / log(10.0);
 }
 
-static void do_video_stats(OutputStream *ost, int frame_size)
+static int do_video_stats(OutputStream *ost, int frame_size)
 {
     AVCodecContext *enc;
     int frame_number;
     double ti1, bitrate, avg_bitrate;
 
+    lock_output();
     /* this is executed just the first time do_video_stats is called */
     if (!vstats_file) {
         vstats_file = fopen(vstats_filename, "w");
         if (!vstats_file) {
+            int ret = AVERROR(errno);
             perror("fopen");
-            exit_program(1);
+            unlock_output();
+            return ret;
         }
     }
 
@@ -1219,6 +1294,8 @@ static void do_video_stats(OutputStream *ost, int frame_size)
                (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
         fprintf(vstats_file, "type= %c\n", enc->coded_frame ? av_get_picture_type_char(enc->coded_frame->pict_type) : 'I');
     }
+    unlock_output();
+    return 0;
 }
 
 static void finish_output_stream(OutputStream *ost)
@@ -1226,12 +1303,185 @@ static void finish_output_stream(OutputStream *ost)
     OutputFile *of = output_files[ost->file_index];
     int i;
 
+    lock_output();
     ost->finished = ENCODER_FINISHED | MUXER_FINISHED;
 
     if (of->shortest) {
         for (i = 0; i < of->ctx->nb_streams; i++)
             output_streams[of->ost_index + i]->finished = ENCODER_FINISHED | MUXER_FINISHED;
     }
+    unlock_output();
+}
+
+/**
+ * Encode a frame output by the filtergraph of ost, or flush the video sync
+ * code if frame is NULL.
+ *
+ * @return 0 on success, a negative error code on a fatal error
+ */
+static int encode_filtered_frame(OutputStream *ost, AVFrame *frame,
+                                  double float_pts, AVRational frame_rate)
+{
+    OutputFile      *of = output_files[ost->file_index];
+    AVCodecContext *enc = ost->enc_ctx;
+
+    switch (enc->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (!frame)
+            return do_video_out(of->ctx, ost, NULL, AV_NOPTS_VALUE, frame_rate);
+        if (!ost->frame_aspect_ratio.num)
+            enc->sample_aspect_ratio = frame->sample_aspect_ratio;
+
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s exact:%f time_base:%d/%d\n",
+                    av_ts2str(frame->pts), av_ts2timestr(frame->pts, &enc->time_base),
+                    float_pts,
+                    enc->time_base.num, enc->time_base.den);
+        }
+
+        return do_video_out(of->ctx, ost, frame, float_pts, frame_rate);
+    case AVMEDIA_TYPE_AUDIO:
+        if (!frame)
+            break;
+        if (!(enc->codec->capabilities & CODEC_CAP_PARAM_CHANGE) &&
+            enc->channels != av_frame_get_channels(frame)) {
+            av_log(NULL, AV_LOG_ERROR,
+                   "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
+            break;
+        }
+        return do_audio_out(of->ctx, ost, frame);
+    default:
+        // TODO support subtitle filters
+        av_assert0(0);
+    }
+    return 0;
+}
+
+#if HAVE_PTHREADS
+typedef struct EncodeMessage {
+    AVFrame *frame;         ///< filtered frame, NULL to flush
+    double float_pts;
+    AVRational frame_rate;  ///< frame rate of the buffersink when the frame was output
+} EncodeMessage;
+
+static void *encode_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    EncodeMessage msg;
+    int ret;
+
+    while (av_thread_message_queue_recv(ost->enc_thread_queue, &msg, 0) >= 0) {
+        ret = encode_filtered_frame(ost, msg.frame, msg.float_pts, msg.frame_rate);
+        av_frame_free(&msg.frame);
+        if (ret < 0) {
+            /* the main thread exits when it sees the error */
+            ost->enc_thread_error = ret;
+            av_thread_message_queue_set_err_send(ost->enc_thread_queue, ret);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void drain_output_thread_queue(OutputStream *ost)
+{
+    EncodeMessage msg;
+
+    while (av_thread_message_queue_recv(ost->enc_thread_queue, &msg,
+                                        AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+        av_frame_free(&msg.frame);
+}
+
+/**
+ * Stop the encoding threads once they have encoded all the queued frames,
+ * or as soon as possible, dropping the queued frames, if abort is set.
+ *
+ * @return the error of the first encoding thread which failed, 0 if none did
+ */
+static int free_output_threads(int abort)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost || !ost->enc_thread_queue)
+            continue;
+        if (abort)
+            drain_output_thread_queue(ost);
+        av_thread_message_queue_set_err_recv(ost->enc_thread_queue, AVERROR_EOF);
+
+        pthread_join(ost->enc_thread, NULL);
+        /* frames left behind by a thread which failed */
+        drain_output_thread_queue(ost);
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+
+        if (!ret)
+            ret = ost->enc_thread_error;
+    }
+    return ret;
+}
+
+static int init_output_threads(void)
+{
+    int i, ret;
+
+    if (!encode_pipeline)
+        return 0;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost->encoding_needed || !ost->filter)
+            continue;
+
+        ret = av_thread_message_queue_alloc(&ost->enc_thread_queue,
+                                            8, sizeof(EncodeMessage));
+        if (ret < 0)
+            return ret;
+
+        if ((ret = pthread_create(&ost->enc_thread, NULL, encode_thread, ost))) {
+            av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+            av_thread_message_queue_free(&ost->enc_thread_queue);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+#endif
+
+/**
+ * Encode frame, or hand it over to the encoding thread of ost if there is
+ * one. The reference held by frame is consumed.
+ */
+static int output_filtered_frame(OutputStream *ost, AVFrame *frame,
+                                 double float_pts, AVRational frame_rate)
+{
+#if HAVE_PTHREADS
+    if (ost->enc_thread_queue) {
+        EncodeMessage msg = { NULL, float_pts, frame_rate };
+        int ret;
+
+        if (frame) {
+            if (!(msg.frame = av_frame_alloc()))
+                return AVERROR(ENOMEM);
+            av_frame_move_ref(msg.frame, frame);
+        }
+        ret = av_thread_message_queue_send(ost->enc_thread_queue, &msg, 0);
+        if (ret < 0) {
+            av_frame_free(&msg.frame);
+            if (ost->enc_thread_error < 0)
+                exit_program(1);
+        }
+        return ret;
+    }
+#endif
+    if (encode_filtered_frame(ost, frame, float_pts, frame_rate) < 0)
+        exit_program(1);
+    if (frame)
+        av_frame_unref(frame);
+    return 0;
 }
 
 /**
@@ -1271,8 +1521,10 @@ static int reap_filters(int flush)
                     av_log(NULL, AV_LOG_WARNING,
                            "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
                 } else if (flush && ret == AVERROR_EOF) {
-                    if (filter->inputs[0]->type == AVMEDIA_TYPE_VIDEO)
-                        do_video_out(of->ctx, ost, NULL, AV_NOPTS_VALUE);
+                    if (filter->inputs[0]->type == AVMEDIA_TYPE_VIDEO &&
+                        (ret = output_filtered_frame(ost, NULL, AV_NOPTS_VALUE,
+                                                     filter->inputs[0]->frame_rate)) < 0)
+                        return ret;
                 }
                 break;
             }
@@ -1300,35 +1552,10 @@ static int reap_filters(int flush)
             //if (ost->source_index >= 0)
             //    *filtered_frame= *input_streams[ost->source_index]->decoded_frame; //for me_threshold
 
-            switch (filter->inputs[0]->type) {
-            case AVMEDIA_TYPE_VIDEO:
-                if (!ost->frame_aspect_ratio.num)
-                    enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
-
-                if (debug_ts) {
-                    av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s exact:%f time_base:%d/%d\n",
-                            av_ts2str(filtered_frame->pts), av_ts2timestr(filtered_frame->pts, &enc->time_base),
-                            float_pts,
-                            enc->time_base.num, enc->time_base.den);
-                }
-
-                do_video_out(of->ctx, ost, filtered_frame, float_pts);
-                break;
-            case AVMEDIA_TYPE_AUDIO:
-                if (!(enc->codec->capabilities & CODEC_CAP_PARAM_CHANGE) &&
-                    enc->channels != av_frame_get_channels(filtered_frame)) {
-                    av_log(NULL, AV_LOG_ERROR,
-                           "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
-                    break;
-                }
-                do_audio_out(of->ctx, ost, filtered_frame);
-                break;
-            default:
-                // TODO support subtitle filters
-                av_assert0(0);
-            }
-
-            av_frame_unref(filtered_frame);
+            ret = output_filtered_frame(ost, filtered_frame, float_pts,
+                                        filter->inputs[0]->frame_rate);
+            if (ret < 0)
+                return ret;
         }
     }
 
@@ -1483,6 +1710,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
+    lock_output();
     total_size = avio_size(oc->pb);
     if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
         total_size = avio_tell(oc->pb);
@@ -1495,7 +1723,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         ost = output_streams[i];
         enc = ost->enc_ctx;
         if (!ost->stream_copy && enc->coded_frame)
-            q = enc->coded_frame->quality / (float)FF_QP2LAMBDA;
+            q = ost->quality / (float)FF_QP2LAMBDA;
         if (vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "q=%2.1f ", q);
             av_bprintf(&buf_script, "stream_%d_%d_q=%.1f\n",
@@ -1534,7 +1762,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                         error = enc->error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0 * frame_number;
                     } else {
-                        error = enc->coded_frame->error[j];
+                        error = ost->error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0;
                     }
                     if (j)
@@ -1599,6 +1827,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                 nb_frames_dup, nb_frames_drop);
     av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
     av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+    unlock_output();
 
     if (print_stats || is_last_report) {
         const char end = is_last_report ? '\n' : '\r';
@@ -1689,9 +1918,11 @@ static void flush_encoders(void)
                 }
                 av_packet_rescale_ts(&pkt, enc->time_base, ost->st->time_base);
                 pkt_size = pkt.size;
-                write_frame(os, &pkt, ost);
+                if (write_frame(os, &pkt, ost) < 0)
+                    exit_program(1);
                 if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
-                    do_video_stats(ost, pkt_size);
+                    if (do_video_stats(ost, pkt_size) < 0)
+                        exit_program(1);
                 }
             }
 
@@ -1818,7 +2049,8 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
         opkt.flags |= AV_PKT_FLAG_KEY;
     }
 
-    write_frame(of->ctx, &opkt, ost);
+    if (write_frame(of->ctx, &opkt, ost) < 0)
+        exit_program(1);
 }
 
 int guess_input_channel_layout(InputStream *ist)
@@ -3260,8 +3492,9 @@ static int transcode_init(void)
 /* Return 1 if there remain streams where more output is wanted, 0 otherwise. */
 static int need_output(void)
 {
-    int i;
+    int i, ret = 0;
 
+    lock_output();
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost    = output_streams[i];
         OutputFile *of       = output_files[ost->file_index];
@@ -3273,14 +3506,16 @@ static int need_output(void)
         if (ost->frame_number >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
-                close_output_stream(output_streams[of->ost_index + j]);
+                close_output_stream_locked(output_streams[of->ost_index + j]);
             continue;
         }
 
-        return 1;
+        ret = 1;
+        break;
     }
+    unlock_output();
 
-    return 0;
+    return ret;
 }
 
 /**
@@ -3481,8 +3716,9 @@ static int init_input_threads(void)
         if (f->ctx->pb ? !f->ctx->pb->seekable :
             strcmp(f->ctx->iformat->name, "lavfi"))
             f->non_blocking = 1;
-        ret = av_thread_message_queue_alloc(&f->in_thread_queue,
-                                            f->thread_queue_size, sizeof(AVPacket));
+        ret = av_thread_message_queue_alloc2(&f->in_thread_queue,
+                                             f->thread_queue_size, sizeof(AVPacket),
+                                             AV_THREAD_MESSAGE_QUEUE_SPSC);
         if (ret < 0)
             return ret;
 
@@ -3890,6 +4126,8 @@ static int transcode(void)
 #if HAVE_PTHREADS
     if ((ret = init_input_threads()) < 0)
         goto fail;
+    if ((ret = init_output_threads()) < 0)
+        goto fail;
 #endif
 
     while (!received_sigterm) {
@@ -3933,6 +4171,12 @@ static int transcode(void)
             process_input_packet(ist, NULL);
         }
     }
+#if HAVE_PTHREADS
+    /* a fatal error of an encoding thread is raised here, as it would have
+     * been by the main thread if it had encoded the frames itself */
+    if (free_output_threads(0) < 0)
+        exit_program(1);
+#endif
     flush_encoders();
 
     term_exit();
@@ -3970,6 +4214,7 @@ static int transcode(void)
  fail:
 #if HAVE_PTHREADS
     free_input_threads();
+    free_output_threads(1);
 #endif
 
     if (output_streams) {
@@ -455,6 +455,16 @@ typedef struct OutputStream {
     // number of frames/samples sent to the encoder
     uint64_t frames_encoded;
     uint64_t samples_encoded;
+
+    /* quality and error of the last encoded video frame, for the reports */
+    int quality;
+    uint64_t error[3];
+
+#if HAVE_PTHREADS
+    AVThreadMessageQueue *enc_thread_queue; /* filtered frames waiting to be encoded */
+    pthread_t enc_thread;       /* thread encoding and muxing this stream */
+    int enc_thread_error;       /* fatal error of enc_thread, raised by the main thread */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -503,6 +513,8 @@ extern int copy_tb;
 extern int debug_ts;
 extern int exit_on_error;
 extern int print_stats;
+extern int filter_pipeline;
+extern int encode_pipeline;
 extern int qp_hist;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
@@ -911,6 +911,8 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_graph_free(&fg->graph);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    if (filter_pipeline)
+        fg->graph->thread_type |= AVFILTER_THREAD_PIPELINE;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -40,6 +40,7 @@
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/threadpool.h"
 
 #define MATCH_PER_STREAM_OPT(name, type, outvar, fmtctx, st)\
 {\
@@ -98,6 +99,8 @@ int copy_tb           = -1;
 int debug_ts          = 0;
 int exit_on_error     = 0;
 int print_stats       = -1;
+int filter_pipeline   = 0;
+int encode_pipeline   = 0;
 int qp_hist           = 0;
 int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
@@ -393,6 +396,22 @@ static int opt_sdp_file(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_thread_pool(void *optctx, const char *opt, const char *arg)
+{
+    AVThreadPool *pool;
+    int ret;
+
+    ret = av_thread_pool_alloc(&pool, parse_number_or_die(opt, arg, OPT_INT, 0, INT_MAX));
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Error creating the thread pool: %s\n",
+               av_err2str(ret));
+        return ret;
+    }
+    av_thread_pool_set_global(pool);
+    av_thread_pool_free(&pool);
+    return 0;
+}
+
 /**
  * Parse a metadata specifier passed as 'arg' parameter.
  * @param arg  metadata string to parse
@@ -2948,6 +2967,8 @@ const OptionDef options[] = {
       "enable or disable interaction on standard input" },
     { "timelimit",      HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_timelimit },
         "set max runtime in seconds", "limit" },
+    { "thread_pool",    HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_thread_pool },
+        "run slice threading of all codecs, filters and scalers on a shared pool of threads", "number" },
     { "dump",           OPT_BOOL | OPT_EXPERT,                       { &do_pkt_dump },
         "dump each input packet" },
     { "hex",            OPT_BOOL | OPT_EXPERT,                       { &do_hex_dump },
@@ -3008,6 +3029,10 @@ const OptionDef options[] = {
         "read stream filtergraph description from a file", "filename" },
     { "reinit_filter",  HAS_ARG | OPT_INT | OPT_SPEC | OPT_INPUT,    { .off = OFFSET(reinit_filters) },
         "reinit filtergraph on input parameter changes", "" },
+    { "filter_pipeline", OPT_BOOL | OPT_EXPERT,                      { &filter_pipeline },
+        "filter independent filtergraph branches in parallel" },
+    { "encode_pipeline", OPT_BOOL | OPT_EXPERT,                      { &encode_pipeline },
+        "encode each output stream in its own thread" },
     { "filter_complex", HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
@@ -3146,6 +3146,18 @@ typedef struct AVCodecContext {
      * - decoding: set by user through AVOPtions (NO direct access)
      */
     char *codec_whitelist;
+
+    /**
+     * Number of threads decoding the slices of each frame when frame
+     * threading is used, for decoders able to combine frame and slice
+     * threading. thread_count frames are then decoded at once, each on up
+     * to slice_threads threads. 0 or 1 disables slice threading within
+     * frame threads.
+     * Code outside libavcodec should access this field using AVOptions
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int slice_threads;
 } AVCodecContext;
 
 AVRational av_codec_get_pkt_timebase         (const AVCodecContext *avctx);
@@ -675,6 +675,13 @@ typedef struct H264Context {
 
     int slice_context_count;
 
+    /**
+     * Set while slices are decoded concurrently by a frame thread: their
+     * rows are reported to the other frame threads once all of them are
+     * done, not as each of them progresses.
+     */
+    int defer_row_progress;
+
     /**
      *  1 if the single thread fallback warning has already been
      *  displayed, 0 otherwise.
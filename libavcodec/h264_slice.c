@@ -2247,13 +2247,32 @@ static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
 
     ff_h264_draw_horiz_band(h, sl, top, height);
 
-    if (h->droppable || sl->h264->slice_ctx[0].er.error_occurred)
+    if (h->droppable || h->defer_row_progress ||
+        sl->h264->slice_ctx[0].er.error_occurred)
         return;
 
     ff_thread_report_progress(&h->cur_pic_ptr->tf, top + height - 1,
                               h->picture_structure == PICT_BOTTOM_FIELD);
 }
 
+/**
+ * Report progress for the rows above the current row of the last slice
+ * decoded, once all slices before it are done too.
+ */
+static void report_slices_progress(const H264Context *h, H264SliceContext *sl)
+{
+    int bottom = 16 * (sl->mb_y >> FIELD_PICTURE(h));
+
+    if (sl->deblocking_filter)
+        bottom -= (16 + 4) << FRAME_MBAFF(h);
+
+    if (h->droppable || bottom <= 0 || sl->h264->slice_ctx[0].er.error_occurred)
+        return;
+
+    ff_thread_report_progress(&h->cur_pic_ptr->tf, bottom - 1,
+                              h->picture_structure == PICT_BOTTOM_FIELD);
+}
+
 static void er_add_slice(H264SliceContext *sl,
                          int startx, int starty,
                          int endx, int endy, int status)
@@ -2513,12 +2532,20 @@ int ff_h264_execute_decode_slices(H264Context *h, unsigned context_count)
             sl->mb_index_end = mb_index_end;
         }
 
+        /* with frame threading, a slice may finish rows before the slices
+         * above it are done */
+        h->defer_row_progress = !!(avctx->active_thread_type & FF_THREAD_FRAME);
+
         avctx->execute(avctx, decode_slice, h->slice_ctx,
                        NULL, context_count, sizeof(h->slice_ctx[0]));
 
         /* pull back stuff from slices to master context */
         sl                   = &h->slice_ctx[context_count - 1];
         h->mb_y              = sl->mb_y;
+        if (h->defer_row_progress) {
+            h->defer_row_progress = 0;
+            report_slices_progress(h, sl);
+        }
         if (CONFIG_ERROR_RESILIENCE) {
             for (i = 1; i < context_count; i++)
                 h->slice_ctx[0].er.error_count += h->slice_ctx[i].er.error_count;
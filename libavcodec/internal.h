@@ -46,6 +46,15 @@
  * all.
  */
 #define FF_CODEC_CAP_INIT_CLEANUP           (1 << 1)
+/**
+ * The decoder supports slice threading within each of its frame threads.
+ * The codec context of each frame thread then has both FF_THREAD_FRAME and
+ * FF_THREAD_SLICE set in active_thread_type, and its thread_count is the
+ * number of threads running the slice jobs of its frame. Progress must not
+ * be reported to other frame threads for rows that slices decoded
+ * concurrently may still write.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS    (1 << 2)
 
 
 #ifdef DEBUG
@@ -136,6 +145,12 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threading context. With frame threading, each frame thread's
+     * codec context may have its own, when the decoder combines both.
+     */
+    void *slice_thread_ctx;
+
     /**
      * Current packet as passed into the decoder, to avoid having to pass the
      * packet into every function.
@@ -35,6 +35,17 @@
 #include <zlib.h>
 
 #define IOBUF_SIZE 4096
+#define MIN_SLICE_HEIGHT 16
+
+typedef struct PNGEncSlice {
+    z_stream zstream;           ///< raw deflate stream of this band of rows
+    uint8_t *crow_base;
+    uint8_t *buf;               ///< compressed rows, framed as part of the zlib stream
+    int buf_size;
+    int len;                    ///< bytes used in buf, or a negative error code
+    int y_start, y_end;
+    uLong adler;                ///< Adler-32 of the uncompressed rows
+} PNGEncSlice;
 
 typedef struct PNGEncContext {
     AVClass *class;
@@ -59,6 +70,12 @@ typedef struct PNGEncContext {
     // APNG
     uint32_t palette_checksum;   // Used to ensure a single unique palette
     uint32_t sequence_number;
+
+    // slice threading
+    PNGEncSlice *slices;
+    int nb_slices;
+    unsigned zlib_header;
+    const AVFrame *cur_frame;
 } PNGEncContext;
 
 static void png_get_interlaced_row(uint8_t *dst, int row_size,
@@ -392,6 +409,89 @@ static int encode_headers(AVCodecContext *avctx, const AVFrame *pict)
     return 0;
 }
 
+static int encode_slice(AVCodecContext *avctx, void *arg)
+{
+    PNGEncContext *s       = avctx->priv_data;
+    PNGEncSlice *sl        = arg;
+    const AVFrame *const p = s->cur_frame;
+    int row_size = (avctx->width * s->bits_per_pixel + 7) >> 3;
+    int last     = sl->y_end == avctx->height;
+    uint8_t *crow_buf = sl->crow_base + 15;
+    uint8_t *ptr, *crow, *top = NULL;
+    int y, ret;
+
+    if (sl->y_start)
+        top = p->data[0] + (sl->y_start - 1) * p->linesize[0];
+
+    /* The first band starts the zlib stream and the last one ends it, the
+     * bands in between are byte-aligned raw deflate data. */
+    sl->len = sl->y_start ? 0 : 2;
+    sl->zstream.next_out  = sl->buf + sl->len;
+    sl->zstream.avail_out = sl->buf_size - sl->len - (last ? 4 : 0);
+    sl->adler = adler32(0, NULL, 0);
+
+    for (y = sl->y_start; y < sl->y_end; y++) {
+        ptr  = p->data[0] + y * p->linesize[0];
+        crow = png_choose_filter(s, crow_buf, ptr, top,
+                                 row_size, s->bits_per_pixel >> 3);
+        sl->adler = adler32(sl->adler, crow, row_size + 1);
+        sl->zstream.next_in  = crow;
+        sl->zstream.avail_in = row_size + 1;
+        ret = deflate(&sl->zstream, Z_NO_FLUSH);
+        if (ret != Z_OK || sl->zstream.avail_in)
+            goto fail;
+        top = ptr;
+    }
+    /* a full flush ends the band on a byte boundary with an empty stored
+     * block, so that the next band can simply be appended */
+    ret = deflate(&sl->zstream, last ? Z_FINISH : Z_FULL_FLUSH);
+    if (ret != (last ? Z_STREAM_END : Z_OK) || !sl->zstream.avail_out)
+        goto fail;
+
+    sl->len = sl->zstream.next_out - sl->buf;
+    deflateReset(&sl->zstream);
+    return 0;
+fail:
+    sl->len = AVERROR_EXTERNAL;
+    deflateReset(&sl->zstream);
+    return sl->len;
+}
+
+static int encode_frame_slices(AVCodecContext *avctx, const AVFrame *pict)
+{
+    PNGEncContext *s = avctx->priv_data;
+    PNGEncSlice *last = &s->slices[s->nb_slices - 1];
+    int row_size = (avctx->width * s->bits_per_pixel + 7) >> 3;
+    uLong adler;
+    int i;
+
+    s->cur_frame = pict;
+    avctx->execute(avctx, encode_slice, s->slices, NULL,
+                   s->nb_slices, sizeof(*s->slices));
+    s->cur_frame = NULL;
+
+    adler = s->slices[0].adler;
+    for (i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+        if (sl->len < 0)
+            return sl->len;
+        if (i)
+            adler = adler32_combine(adler, sl->adler,
+                                    (sl->y_end - sl->y_start) * (row_size + 1));
+    }
+    AV_WB16(s->slices[0].buf, s->zlib_header);
+    AV_WB32(last->buf + last->len, adler);
+    last->len += 4;
+
+    for (i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+        if (s->bytestream_end - s->bytestream < sl->len + 100)
+            return AVERROR_BUG;
+        png_write_image_data(avctx, sl->buf, sl->len);
+    }
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 {
     PNGEncContext *s       = avctx->priv_data;
@@ -403,6 +503,9 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
     uint8_t *progressive_buf = NULL;
     uint8_t *top_buf         = NULL;
 
+    if (s->nb_slices)
+        return encode_frame_slices(avctx, pict);
+
     row_size = (avctx->width * s->bits_per_pixel + 7) >> 3;
 
     crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
@@ -605,10 +708,82 @@ static int encode_apng(AVCodecContext *avctx, AVPacket *pkt,
     return 0;
 }
 
+static av_cold void free_slices(PNGEncContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+        deflateEnd(&sl->zstream);
+        av_freep(&sl->crow_base);
+        av_freep(&sl->buf);
+    }
+    av_freep(&s->slices);
+    s->nb_slices = 0;
+}
+
+static av_cold int init_slices(AVCodecContext *avctx, int compression_level)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int row_size = (avctx->width * s->bits_per_pixel + 7) >> 3;
+    int nb_slices, level_flags, i;
+
+    nb_slices = FFMIN(avctx->thread_count,
+                      (avctx->height + MIN_SLICE_HEIGHT - 1) / MIN_SLICE_HEIGHT);
+    if (nb_slices < 2)
+        return 0;
+
+    s->slices = av_mallocz_array(nb_slices, sizeof(*s->slices));
+    if (!s->slices)
+        return AVERROR(ENOMEM);
+    s->nb_slices = nb_slices;
+
+    for (i = 0; i < nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+        int64_t buf_size;
+
+        sl->y_start = avctx->height *  i      / nb_slices;
+        sl->y_end   = avctx->height * (i + 1) / nb_slices;
+
+        sl->zstream.zalloc = ff_png_zalloc;
+        sl->zstream.zfree  = ff_png_zfree;
+        sl->zstream.opaque = NULL;
+        /* negative window bits: raw deflate, the zlib framing is written
+         * around the concatenated bands in encode_frame_slices() */
+        if (deflateInit2(&sl->zstream, compression_level, Z_DEFLATED, -15, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+            return AVERROR_EXTERNAL;
+
+        /* zlib header, flush marker and Adler-32 checksum on top of the
+         * deflate bound */
+        buf_size = deflateBound(&sl->zstream, (int64_t)(sl->y_end - sl->y_start) *
+                                              (row_size + 1)) + 2 + 16 + 4;
+        if (buf_size > INT_MAX)
+            return AVERROR(ENOMEM);
+        sl->buf_size  = buf_size;
+        sl->buf       = av_malloc(sl->buf_size);
+        sl->crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+        if (!sl->buf || !sl->crow_base)
+            return AVERROR(ENOMEM);
+    }
+
+    /* same header as written by zlib for this compression level */
+    if (compression_level == Z_DEFAULT_COMPRESSION)
+        compression_level = 6;
+    level_flags = compression_level < 2 ? 0 :
+                  compression_level < 6 ? 1 :
+                  compression_level == 6 ? 2 : 3;
+    s->zlib_header  = (Z_DEFLATED + (7 << 4)) << 8 | level_flags << 6;
+    s->zlib_header += 31 - s->zlib_header % 31;
+
+    return 0;
+}
+
 static av_cold int png_enc_init(AVCodecContext *avctx)
 {
     PNGEncContext *s = avctx->priv_data;
     int compression_level;
+    int ret;
 
     switch (avctx->pix_fmt) {
     case AV_PIX_FMT_RGBA:
@@ -705,6 +880,15 @@ static av_cold int png_enc_init(AVCodecContext *avctx)
     if (deflateInit2(&s->zstream, compression_level, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
         return -1;
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && !s->is_progressive) {
+        ret = init_slices(avctx, compression_level);
+        if (ret < 0) {
+            free_slices(s);
+            deflateEnd(&s->zstream);
+            return ret;
+        }
+    }
+
     return 0;
 }
 
@@ -713,6 +897,7 @@ static av_cold int png_enc_close(AVCodecContext *avctx)
     PNGEncContext *s = avctx->priv_data;
 
     deflateEnd(&s->zstream);
+    free_slices(s);
     av_frame_free(&avctx->coded_frame);
     return 0;
 }
@@ -748,7 +933,8 @@ AVCodec ff_png_encoder = {
     .init           = png_enc_init,
     .close          = png_enc_close,
     .encode2        = encode_png,
-    .capabilities   = CODEC_CAP_FRAME_THREADS | CODEC_CAP_INTRA_ONLY,
+    .capabilities   = CODEC_CAP_FRAME_THREADS | CODEC_CAP_SLICE_THREADS |
+                      CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
@@ -769,6 +955,7 @@ AVCodec ff_apng_encoder = {
     .init           = png_enc_init,
     .close          = png_enc_close,
     .encode2        = encode_apng,
+    .capabilities   = CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
@@ -49,6 +49,7 @@
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/threadpool_internal.h"
 
 /**
  * Context used by codec threads and stored in their AVCodecInternal thread_ctx.
@@ -241,7 +242,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 
     if (for_user) {
-        dst->delay       = src->thread_count - 1;
+        dst->delay       = dst->thread_count - 1;
         dst->coded_frame = src->coded_frame;
     } else {
         if (dst->codec->update_thread_context)
@@ -575,6 +576,9 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
         if (codec->close)
             codec->close(p->avctx);
 
+        if (p->avctx->internal->slice_thread_ctx)
+            ff_slice_thread_free(p->avctx);
+
         release_delayed_buffers(p);
         av_frame_free(&p->frame);
     }
@@ -614,6 +618,8 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     const AVCodec *codec = avctx->codec;
     AVCodecContext *src = avctx;
     FrameThreadContext *fctx;
+    AVThreadPool *pool = NULL;
+    int slice_threads = 0;
     int i, err = 0;
 
 #if HAVE_W32THREADS
@@ -636,6 +642,17 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         return 0;
     }
 
+    /* each frame thread runs the slice jobs of its frame on a pool shared by
+     * all of them: the global pool, or a private one with enough workers for
+     * every frame thread to use slice_threads threads */
+    if (avctx->slice_threads > 1 && (avctx->thread_type & FF_THREAD_SLICE) &&
+        (codec->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS)) {
+        slice_threads = FFMIN(avctx->slice_threads, MAX_AUTO_THREADS);
+        if (!(pool = avpriv_thread_pool_ref_global()) &&
+            (err = av_thread_pool_alloc(&pool, thread_count * (slice_threads - 1))) < 0)
+            return err;
+    }
+
     avctx->internal->thread_ctx = fctx = av_mallocz(sizeof(FrameThreadContext));
 
     fctx->threads = av_mallocz_array(thread_count, sizeof(PerThreadContext));
@@ -676,8 +693,16 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         }
         *copy->internal = *src->internal;
         copy->internal->thread_ctx = p;
+        copy->internal->slice_thread_ctx = NULL;
         copy->internal->pkt = &p->avpkt;
 
+        if (pool) {
+            copy->active_thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            copy->thread_count       = slice_threads;
+            if ((err = ff_slice_thread_init_pool(copy, pool)) < 0)
+                goto error;
+        }
+
         if (!i) {
             src = copy;
 
@@ -706,10 +731,13 @@ int ff_frame_thread_init(AVCodecContext *avctx)
             goto error;
     }
 
+    av_thread_pool_free(&pool);
+
     return 0;
 
 error:
     ff_frame_thread_free(avctx, i+1);
+    av_thread_pool_free(&pool);
 
     return err;
 }
@@ -19,6 +19,8 @@
 #ifndef AVCODEC_PTHREAD_INTERNAL_H
 #define AVCODEC_PTHREAD_INTERNAL_H
 
+#include "libavutil/threadpool.h"
+
 #include "avcodec.h"
 
 /* H264 slice threading seems to be buggy with more than 16 threads,
@@ -28,6 +30,13 @@
 int ff_slice_thread_init(AVCodecContext *avctx);
 void ff_slice_thread_free(AVCodecContext *avctx);
 
+/**
+ * Set up slice threading of avctx to run its jobs on pool, on up to
+ * avctx->thread_count threads at once. Used by the frame threads of
+ * decoders combining frame and slice threading.
+ */
+int ff_slice_thread_init_pool(AVCodecContext *avctx, AVThreadPool *pool);
+
 int ff_frame_thread_init(AVCodecContext *avctx);
 void ff_frame_thread_free(AVCodecContext *avctx, int thread_count);
 
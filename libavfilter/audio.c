@@ -26,7 +26,9 @@
 
 #include "audio.h"
 #include "avfilter.h"
+#include "framepool.h"
 #include "internal.h"
+#include "thread.h"
 
 int avfilter_ref_get_channels(AVFilterBufferRef *ref)
 {
@@ -38,24 +40,49 @@ AVFrame *ff_null_get_audio_buffer(AVFilterLink *link, int nb_samples)
     return ff_get_audio_buffer(link->dst->outputs[0], nb_samples);
 }
 
-AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
+#define BUFFER_ALIGN 0
+
+/* Frames are allocated from a pool owned by the link. The pool buffers are
+ * sized for the largest frame requested so far, so that varying frame sizes
+ * do not cause the pool to be recreated. */
+static AVFrame *pool_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
-    AVFrame *frame = av_frame_alloc();
+    AVFrame *frame = NULL;
     int channels = link->channels;
-    int ret;
+    int pool_channels = 0;
+    int pool_nb_samples = 0;
+    int pool_align = 0;
+    enum AVSampleFormat pool_format = AV_SAMPLE_FMT_NONE;
 
     av_assert0(channels == av_get_channel_layout_nb_channels(link->channel_layout) || !av_get_channel_layout_nb_channels(link->channel_layout));
 
+    if (link->frame_pool) {
+        ff_frame_pool_get_audio_config(link->frame_pool, &pool_channels,
+                                       &pool_nb_samples, &pool_format,
+                                       &pool_align);
+        if (pool_channels != channels || pool_nb_samples < nb_samples ||
+            pool_format != link->format || pool_align != BUFFER_ALIGN)
+            ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
+    }
+
+    if (!link->frame_pool) {
+        link->frame_pool = ff_frame_pool_audio_init(av_buffer_allocz, channels,
+                                                    nb_samples, link->format,
+                                                    BUFFER_ALIGN);
+        if (!link->frame_pool)
+            return NULL;
+    }
+
+    frame = ff_frame_pool_get(link->frame_pool);
     if (!frame)
         return NULL;
 
+    /* keep the linesize a freshly allocated frame of this size would have */
     frame->nb_samples     = nb_samples;
-    frame->format         = link->format;
-    av_frame_set_channels(frame, link->channels);
     frame->channel_layout = link->channel_layout;
     frame->sample_rate    = link->sample_rate;
-    ret = av_frame_get_buffer(frame, 0);
-    if (ret < 0) {
+    if (av_samples_get_buffer_size(&frame->linesize[0], channels, nb_samples,
+                                   link->format, BUFFER_ALIGN) < 0) {
         av_frame_free(&frame);
         return NULL;
     }
@@ -67,6 +94,21 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
     return frame;
 }
 
+AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
+{
+    AVFrame *frame;
+
+    if (!(link->flags & FF_LINK_FLAG_PIPELINE))
+        return pool_get_audio_buffer(link, nb_samples);
+
+    /* the pool of an asynchronous link is shared with its pipeline worker */
+    ff_graph_pipeline_lock(link->graph);
+    frame = pool_get_audio_buffer(link, nb_samples);
+    ff_graph_pipeline_unlock(link->graph);
+
+    return frame;
+}
+
 AVFrame *ff_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
     AVFrame *ret = NULL;
@@ -35,6 +35,7 @@
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
+#include "framepool.h"
 #include "internal.h"
 
 #include "libavutil/ffversion.h"
@@ -168,6 +169,7 @@ void avfilter_link_free(AVFilterLink **link)
         return;
 
     av_frame_free(&(*link)->partial_buf);
+    ff_frame_pool_uninit((FFFramePool**)&(*link)->frame_pool);
 
     av_freep(link);
 }
@@ -340,6 +342,32 @@ void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
     }
 }
 
+/* The request state of an asynchronous link is shared with the pipeline
+ * worker filtering the frames sent on it. */
+static void set_frame_requested(AVFilterLink *link, int requested)
+{
+    if (link->flags & FF_LINK_FLAG_PIPELINE) {
+        ff_graph_pipeline_lock(link->graph);
+        link->frame_requested = requested;
+        ff_graph_pipeline_unlock(link->graph);
+    } else {
+        link->frame_requested = requested;
+    }
+}
+
+static int get_frame_requested(AVFilterLink *link)
+{
+    int requested;
+
+    if (!(link->flags & FF_LINK_FLAG_PIPELINE))
+        return link->frame_requested;
+
+    ff_graph_pipeline_lock(link->graph);
+    requested = link->frame_requested;
+    ff_graph_pipeline_unlock(link->graph);
+    return requested;
+}
+
 int ff_request_frame(AVFilterLink *link)
 {
     int ret = -1;
@@ -347,9 +375,14 @@ int ff_request_frame(AVFilterLink *link)
 
     if (link->closed)
         return AVERROR_EOF;
-    av_assert0(!link->frame_requested);
-    link->frame_requested = 1;
-    while (link->frame_requested) {
+    if (link->flags & FF_LINK_FLAG_PIPELINE) {
+        int queued, r = ff_graph_pipeline_request_frame(link, &queued);
+        if (r < 0 || queued)
+            return r;
+    }
+    av_assert0(!get_frame_requested(link));
+    set_frame_requested(link, 1);
+    while (get_frame_requested(link)) {
         if (link->srcpad->request_frame)
             ret = link->srcpad->request_frame(link);
         else if (link->src->inputs[0])
@@ -360,11 +393,11 @@ int ff_request_frame(AVFilterLink *link)
             ret = ff_filter_frame_framed(link, pbuf);
         }
         if (ret < 0) {
-            link->frame_requested = 0;
+            set_frame_requested(link, 0);
             if (ret == AVERROR_EOF)
                 link->closed = 1;
         } else {
-            av_assert0(!link->frame_requested ||
+            av_assert0(!get_frame_requested(link) ||
                        link->flags & FF_LINK_FLAG_REQUEST_LOOP);
         }
     }
@@ -451,10 +484,12 @@ void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
 {
     if (pts == AV_NOPTS_VALUE)
         return;
+    ff_graph_pipeline_lock(link->graph);
     link->current_pts = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
     /* TODO use duration */
     if (link->graph && link->age_index >= 0)
         ff_avfilter_graph_update_heap(link->graph, link);
+    ff_graph_pipeline_unlock(link->graph);
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -1090,7 +1125,7 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     }
     ret = filter_frame(link, out);
     link->frame_count++;
-    link->frame_requested = 0;
+    set_frame_requested(link, 0);
     ff_update_link_current_pts(link, pts);
     return ret;
 
@@ -1161,6 +1196,14 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_assert1(frame->sample_rate           == link->sample_rate);
     }
 
+    if (link->flags & FF_LINK_FLAG_PIPELINE)
+        return ff_graph_pipeline_filter_frame(link, frame);
+
+    return ff_filter_frame_direct(link, frame);
+}
+
+int ff_filter_frame_direct(AVFilterLink *link, AVFrame *frame)
+{
     /* Go directly to actual filtering if possible */
     if (link->type == AVMEDIA_TYPE_AUDIO &&
         link->min_samples &&
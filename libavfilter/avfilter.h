@@ -626,6 +626,13 @@ typedef struct AVFilter {
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Run independent branches of the filtergraph, such as the outputs of
+ * split, concurrently. Branches containing filters that request frames from
+ * their inputs are run synchronously. Only meaningful for
+ * AVFilterGraph.thread_type.
+ */
+#define AVFILTER_THREAD_PIPELINE (1 << 1)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -860,6 +867,18 @@ struct AVFilterLink {
      * Number of past frames sent through the link.
      */
     int64_t frame_count;
+
+    /**
+     * A pointer to a FFFramePool struct, used to allocate the frames
+     * returned by the default get_video_buffer/get_audio_buffer callbacks.
+     */
+    void *frame_pool;
+
+    /**
+     * The filtergraph pipeline branch the destination filter of the link
+     * belongs to, if any. Only used internally by the pipeline threading.
+     */
+    void *pipeline_branch;
 };
 
 /**
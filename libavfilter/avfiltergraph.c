@@ -42,7 +42,8 @@
 static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
-        { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "slice",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE },    .flags = FLAGS, .unit = "thread_type" },
+        { "pipeline", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_PIPELINE }, .flags = FLAGS, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, FLAGS },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
@@ -71,6 +72,50 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_pipeline_init(AVFilterGraph *graph)
+{
+    return 0;
+}
+
+void ff_graph_pipeline_free(AVFilterGraph *graph)
+{
+}
+
+int ff_graph_pipeline_filter_frame(AVFilterLink *link, AVFrame *frame)
+{
+    return ff_filter_frame_direct(link, frame);
+}
+
+int ff_graph_pipeline_request_frame(AVFilterLink *link, int *queued)
+{
+    *queued = 0;
+    return 0;
+}
+
+void ff_graph_pipeline_enter(AVFilterLink *link)
+{
+}
+
+void ff_graph_pipeline_leave(AVFilterLink *link)
+{
+}
+
+void ff_graph_pipeline_enter_all(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_pipeline_leave_all(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_pipeline_lock(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_pipeline_unlock(AVFilterGraph *graph)
+{
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -109,6 +154,8 @@ void avfilter_graph_free(AVFilterGraph **graph)
     if (!*graph)
         return;
 
+    ff_graph_pipeline_free(*graph);
+
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
@@ -181,7 +228,8 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
 {
     AVFilterContext **filters, *s;
 
-    if (graph->thread_type && !graph->internal->thread_execute) {
+    if (graph->thread_type & AVFILTER_THREAD_SLICE &&
+        !graph->internal->thread_execute) {
         if (graph->execute) {
             graph->internal->thread_execute = graph->execute;
         } else {
@@ -1213,19 +1261,18 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if ((ret = ff_graph_pipeline_init(graphctx)) < 0)
+        return ret;
 
     return 0;
 }
 
-int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
+static int graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
     int i, r = AVERROR(ENOSYS);
 
-    if (!graph)
-        return r;
-
     if ((flags & AVFILTER_CMD_FLAG_ONE) && !(flags & AVFILTER_CMD_FLAG_FAST)) {
-        r = avfilter_graph_send_command(graph, target, cmd, arg, res, res_len, flags | AVFILTER_CMD_FLAG_FAST);
+        r = graph_send_command(graph, target, cmd, arg, res, res_len, flags | AVFILTER_CMD_FLAG_FAST);
         if (r != AVERROR(ENOSYS))
             return r;
     }
@@ -1247,12 +1294,23 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
     return r;
 }
 
-int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
-    int i;
+    int r;
 
-    if(!graph)
-        return 0;
+    if (!graph)
+        return AVERROR(ENOSYS);
+
+    ff_graph_pipeline_enter_all(graph);
+    r = graph_send_command(graph, target, cmd, arg, res, res_len, flags);
+    ff_graph_pipeline_leave_all(graph);
+
+    return r;
+}
+
+static void graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+{
+    int i;
 
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
@@ -1268,9 +1326,19 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
             (*queue)->flags   = flags;
             (*queue)->next    = next;
             if(flags & AVFILTER_CMD_FLAG_ONE)
-                return 0;
+                return;
         }
     }
+}
+
+int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+{
+    if(!graph)
+        return 0;
+
+    ff_graph_pipeline_enter_all(graph);
+    graph_queue_command(graph, target, command, arg, flags, ts);
+    ff_graph_pipeline_leave_all(graph);
 
     return 0;
 }
@@ -1327,19 +1395,27 @@ void ff_avfilter_graph_update_heap(AVFilterGraph *graph, AVFilterLink *link)
 
 int avfilter_graph_request_oldest(AVFilterGraph *graph)
 {
+    ff_graph_pipeline_lock(graph);
     while (graph->sink_links_count) {
         AVFilterLink *oldest = graph->sink_links[0];
-        int r = ff_request_frame(oldest);
+        int r;
+
+        ff_graph_pipeline_unlock(graph);
+        ff_graph_pipeline_enter(oldest);
+        r = ff_request_frame(oldest);
+        ff_graph_pipeline_leave(oldest);
         if (r != AVERROR_EOF)
             return r;
         av_log(oldest->dst, AV_LOG_DEBUG, "EOF on sink link %s:%s.\n",
                oldest->dst ? oldest->dst->name : "unknown",
                oldest->dstpad ? oldest->dstpad->name : "unknown");
+        ff_graph_pipeline_lock(graph);
         /* EOF: remove the link from the heap */
         if (oldest->age_index < --graph->sink_links_count)
             heap_bubble_down(graph, graph->sink_links[graph->sink_links_count],
                              oldest->age_index);
         oldest->age_index = -1;
     }
+    ff_graph_pipeline_unlock(graph);
     return AVERROR_EOF;
 }
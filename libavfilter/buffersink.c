@@ -35,6 +35,7 @@
 #include "avfilter.h"
 #include "buffersink.h"
 #include "internal.h"
+#include "thread.h"
 
 typedef struct BufferSinkContext {
     const AVClass *class;
@@ -123,7 +124,7 @@ int attribute_align_arg av_buffersink_get_frame(AVFilterContext *ctx, AVFrame *f
     return av_buffersink_get_frame_flags(ctx, frame, 0);
 }
 
-int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
+static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags)
 {
     BufferSinkContext *buf = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
@@ -156,6 +157,17 @@ int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFr
     return 0;
 }
 
+int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
+{
+    int ret;
+
+    ff_graph_pipeline_enter(ctx->inputs[0]);
+    ret = get_frame_internal(ctx, frame, flags);
+    ff_graph_pipeline_leave(ctx->inputs[0]);
+
+    return ret;
+}
+
 static int read_from_fifo(AVFilterContext *ctx, AVFrame *frame,
                           int nb_samples)
 {
@@ -178,8 +190,8 @@ static int read_from_fifo(AVFilterContext *ctx, AVFrame *frame,
     return 0;
 }
 
-int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
-                                                  AVFrame *frame, int nb_samples)
+static int get_samples_internal(AVFilterContext *ctx,
+                                AVFrame *frame, int nb_samples)
 {
     BufferSinkContext *s = ctx->priv;
     AVFilterLink   *link = ctx->inputs[0];
@@ -198,7 +210,7 @@ int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
 
         if (!(cur_frame = av_frame_alloc()))
             return AVERROR(ENOMEM);
-        ret = av_buffersink_get_frame_flags(ctx, cur_frame, 0);
+        ret = get_frame_internal(ctx, cur_frame, 0);
         if (ret == AVERROR_EOF && av_audio_fifo_size(s->audio_fifo)) {
             av_frame_free(&cur_frame);
             return read_from_fifo(ctx, frame, av_audio_fifo_size(s->audio_fifo));
@@ -222,6 +234,18 @@ int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
     return ret;
 }
 
+int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
+                                                  AVFrame *frame, int nb_samples)
+{
+    int ret;
+
+    ff_graph_pipeline_enter(ctx->inputs[0]);
+    ret = get_samples_internal(ctx, frame, nb_samples);
+    ff_graph_pipeline_leave(ctx->inputs[0]);
+
+    return ret;
+}
+
 AVBufferSinkParams *av_buffersink_params_alloc(void)
 {
     static const int pixel_fmts[] = { AV_PIX_FMT_NONE };
@@ -282,8 +306,12 @@ static int compat_read(AVFilterContext *ctx,
     AVFrame *frame;
     int ret;
 
-    if (!pbuf)
-        return ff_poll_frame(ctx->inputs[0]);
+    if (!pbuf) {
+        ff_graph_pipeline_enter(ctx->inputs[0]);
+        ret = ff_poll_frame(ctx->inputs[0]);
+        ff_graph_pipeline_leave(ctx->inputs[0]);
+        return ret;
+    }
 
     frame = av_frame_alloc();
     if (!frame)
@@ -367,13 +395,18 @@ int attribute_align_arg av_buffersink_poll_frame(AVFilterContext *ctx)
 {
     BufferSinkContext *buf = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
+    int ret;
 
     av_assert0(   !strcmp(ctx->filter->name, "buffersink")
                || !strcmp(ctx->filter->name, "abuffersink")
                || !strcmp(ctx->filter->name, "ffbuffersink")
                || !strcmp(ctx->filter->name, "ffabuffersink"));
 
-    return av_fifo_size(buf->fifo)/sizeof(AVFilterBufferRef *) + ff_poll_frame(inlink);
+    ff_graph_pipeline_enter(inlink);
+    ret = av_fifo_size(buf->fifo)/sizeof(AVFilterBufferRef *) + ff_poll_frame(inlink);
+    ff_graph_pipeline_leave(inlink);
+
+    return ret;
 }
 
 static av_cold int vsink_init(AVFilterContext *ctx, void *opaque)
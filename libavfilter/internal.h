@@ -156,6 +156,7 @@ struct AVFilterPad {
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
+    void *pipeline;
 };
 
 struct AVFilterInternal {
@@ -346,6 +347,12 @@ int ff_buffersink_read_samples_compat(AVFilterContext *ctx, AVFilterBufferRef **
  */
 int ff_filter_frame(AVFilterLink *link, AVFrame *frame);
 
+/**
+ * Same as ff_filter_frame(), but always filter the frame in the calling
+ * thread, even if the link is asynchronous.
+ */
+int ff_filter_frame_direct(AVFilterLink *link, AVFrame *frame);
+
 /**
  * Flags for AVFilterLink.flags.
  */
@@ -358,6 +365,12 @@ enum {
      */
     FF_LINK_FLAG_REQUEST_LOOP = 1,
 
+    /**
+     * Frames sent on this link are filtered asynchronously by a pipeline
+     * worker, see AVFILTER_THREAD_PIPELINE.
+     */
+    FF_LINK_FLAG_PIPELINE = 2,
+
 };
 
 /**
@@ -27,6 +27,7 @@
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
 #include "libavutil/mem.h"
+#include "libavutil/threadpool_internal.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -42,6 +43,7 @@
 
 typedef struct ThreadContext {
     AVFilterGraph *graph;
+    AVThreadPool *pool;         ///< shared pool running the jobs instead of workers
 
     int nb_threads;
     pthread_t *workers;
@@ -96,10 +98,34 @@ static void* attribute_align_arg worker(void *v)
     }
 }
 
+/* Parameters of an execute call running on the shared pool. They are kept
+ * on the stack of the caller, since branches of a pipelined graph may call
+ * thread_execute() concurrently. */
+typedef struct PoolExecute {
+    AVFilterContext *ctx;
+    avfilter_action_func *func;
+    void *arg;
+    int *rets;
+    int nb_rets;
+    int nb_jobs;
+} PoolExecute;
+
+static void pool_job(void *opaque, int jobnr, int threadnr)
+{
+    PoolExecute *e = opaque;
+
+    e->rets[jobnr % e->nb_rets] = e->func(e->ctx, e->arg, jobnr, e->nb_jobs);
+}
+
 static void slice_thread_uninit(ThreadContext *c)
 {
     int i;
 
+    if (c->pool) {
+        av_thread_pool_free(&c->pool);
+        return;
+    }
+
     pthread_mutex_lock(&c->current_job_lock);
     c->done = 1;
     pthread_cond_broadcast(&c->current_job_cond);
@@ -130,6 +156,18 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
     if (nb_jobs <= 0)
         return 0;
 
+    if (c->pool) {
+        PoolExecute e = {
+            .ctx     = ctx,
+            .func    = func,
+            .arg     = arg,
+            .rets    = ret ? ret : &dummy_ret,
+            .nb_rets = ret ? nb_jobs : 1,
+            .nb_jobs = nb_jobs,
+        };
+        return av_thread_pool_execute(c->pool, pool_job, &e, nb_jobs, c->nb_threads);
+    }
+
     pthread_mutex_lock(&c->current_job_lock);
 
     c->current_job = c->nb_threads;
@@ -170,6 +208,12 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
         return 1;
 
     c->nb_threads = nb_threads;
+
+    /* with a global pool installed, jobs run on its workers and the calling
+     * thread instead of threads of our own */
+    if ((c->pool = avpriv_thread_pool_ref_global()))
+        return nb_threads;
+
     c->workers = av_mallocz_array(sizeof(*c->workers), nb_threads);
     if (!c->workers)
         return AVERROR(ENOMEM);
@@ -207,7 +251,7 @@ int ff_graph_thread_init(AVFilterGraph *graph)
 #endif
 
     if (graph->nb_threads == 1) {
-        graph->thread_type = 0;
+        graph->thread_type &= ~AVFILTER_THREAD_SLICE;
         return 0;
     }
 
@@ -218,7 +262,7 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
     if (ret <= 1) {
         av_freep(&graph->internal->thread);
-        graph->thread_type = 0;
+        graph->thread_type &= ~AVFILTER_THREAD_SLICE;
         graph->nb_threads  = 1;
         return (ret < 0) ? ret : 0;
     }
@@ -235,3 +279,418 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+#define PIPELINE_QUEUE_SIZE 8
+
+typedef struct PipelineBranch {
+    struct PipelineContext *pc;
+    AVFilterLink *link;         ///< asynchronous link feeding the branch
+
+    AVFrame *queue[PIPELINE_QUEUE_SIZE];
+    int queue_start;
+    int nb_queued;
+
+    int busy;                   ///< a worker is filtering a frame of the branch
+    int held;                   ///< nesting level of ff_graph_pipeline_enter()
+    int error;                  ///< first error returned when filtering
+} PipelineBranch;
+
+typedef struct PipelineContext {
+    PipelineBranch *branches;
+    int nb_branches;
+    int next_branch;
+
+    pthread_t *workers;
+    int nb_workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;   ///< a branch became runnable
+    pthread_cond_t idle_cond;   ///< a worker finished filtering a frame
+    int done;
+} PipelineContext;
+
+static AVFrame *branch_pop(PipelineBranch *b)
+{
+    AVFrame *frame = b->queue[b->queue_start];
+
+    b->queue_start = (b->queue_start + 1) % PIPELINE_QUEUE_SIZE;
+    b->nb_queued--;
+    return frame;
+}
+
+static void* attribute_align_arg pipeline_worker(void *arg)
+{
+    PipelineContext *pc = arg;
+
+    pthread_mutex_lock(&pc->lock);
+    while (!pc->done) {
+        PipelineBranch *b = NULL;
+        AVFrame *frame;
+        int i, ret;
+
+        for (i = 0; i < pc->nb_branches; i++) {
+            int idx = (pc->next_branch + i) % pc->nb_branches;
+            PipelineBranch *cur = &pc->branches[idx];
+            if (cur->nb_queued && !cur->busy && !cur->held) {
+                b = cur;
+                pc->next_branch = (idx + 1) % pc->nb_branches;
+                break;
+            }
+        }
+        if (!b) {
+            pthread_cond_wait(&pc->work_cond, &pc->lock);
+            continue;
+        }
+
+        frame   = branch_pop(b);
+        b->busy = 1;
+        pthread_mutex_unlock(&pc->lock);
+
+        if (b->error < 0) {
+            av_frame_free(&frame);
+            ret = b->error;
+        } else {
+            ret = ff_filter_frame_direct(b->link, frame);
+        }
+
+        pthread_mutex_lock(&pc->lock);
+        if (ret < 0 && !b->error)
+            b->error = ret;
+        b->busy = 0;
+        pthread_cond_broadcast(&pc->idle_cond);
+    }
+    pthread_mutex_unlock(&pc->lock);
+
+    return NULL;
+}
+
+/**
+ * Filter the frames queued on the link of a branch held by the calling
+ * thread.
+ */
+static int branch_flush(PipelineBranch *b)
+{
+    PipelineContext *pc = b->pc;
+    AVFrame *frame;
+    int ret = 0;
+
+    while (ret >= 0) {
+        pthread_mutex_lock(&pc->lock);
+        if (!b->nb_queued) {
+            pthread_mutex_unlock(&pc->lock);
+            break;
+        }
+        frame = branch_pop(b);
+        pthread_cond_broadcast(&pc->idle_cond);
+        pthread_mutex_unlock(&pc->lock);
+
+        ret = ff_filter_frame_direct(b->link, frame);
+    }
+    return ret;
+}
+
+int ff_graph_pipeline_filter_frame(AVFilterLink *link, AVFrame *frame)
+{
+    PipelineBranch *b   = link->pipeline_branch;
+    PipelineContext *pc = b->pc;
+    int ret;
+
+    pthread_mutex_lock(&pc->lock);
+    if (b->held) {
+        pthread_mutex_unlock(&pc->lock);
+        if ((ret = branch_flush(b)) < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+        return ff_filter_frame_direct(link, frame);
+    }
+
+    while (b->nb_queued == PIPELINE_QUEUE_SIZE && !b->error)
+        pthread_cond_wait(&pc->idle_cond, &pc->lock);
+    if ((ret = b->error) < 0) {
+        pthread_mutex_unlock(&pc->lock);
+        av_frame_free(&frame);
+        return ret;
+    }
+
+    b->queue[(b->queue_start + b->nb_queued++) % PIPELINE_QUEUE_SIZE] = frame;
+    pthread_cond_signal(&pc->work_cond);
+    pthread_mutex_unlock(&pc->lock);
+
+    return 0;
+}
+
+int ff_graph_pipeline_request_frame(AVFilterLink *link, int *queued)
+{
+    PipelineBranch *b   = link->pipeline_branch;
+    PipelineContext *pc = b->pc;
+    AVFrame *frame;
+    int ret;
+
+    *queued = 0;
+
+    pthread_mutex_lock(&pc->lock);
+    /* Branches containing filters that pull frames are never made
+     * asynchronous (see branch_pulls_frames()), so the worker of a branch
+     * never gets here and the caller must be holding the branch. */
+    if (!b->held) {
+        pthread_mutex_unlock(&pc->lock);
+        av_log(link->dst, AV_LOG_ERROR,
+               "Frame requested on a pipeline link without holding its branch.\n");
+        return AVERROR_BUG;
+    }
+    if ((ret = b->error) < 0 || !b->nb_queued) {
+        pthread_mutex_unlock(&pc->lock);
+        return ret;
+    }
+    frame = branch_pop(b);
+    pthread_cond_broadcast(&pc->idle_cond);
+    pthread_mutex_unlock(&pc->lock);
+
+    *queued = 1;
+    return ff_filter_frame_direct(link, frame);
+}
+
+static void branch_enter(PipelineBranch *b)
+{
+    PipelineContext *pc = b->pc;
+
+    pthread_mutex_lock(&pc->lock);
+    while (b->busy)
+        pthread_cond_wait(&pc->idle_cond, &pc->lock);
+    b->held++;
+    pthread_mutex_unlock(&pc->lock);
+}
+
+static void branch_leave(PipelineBranch *b)
+{
+    PipelineContext *pc = b->pc;
+
+    pthread_mutex_lock(&pc->lock);
+    if (!--b->held && b->nb_queued)
+        pthread_cond_signal(&pc->work_cond);
+    pthread_mutex_unlock(&pc->lock);
+}
+
+void ff_graph_pipeline_enter(AVFilterLink *link)
+{
+    if (link->pipeline_branch)
+        branch_enter(link->pipeline_branch);
+}
+
+void ff_graph_pipeline_leave(AVFilterLink *link)
+{
+    if (link->pipeline_branch)
+        branch_leave(link->pipeline_branch);
+}
+
+void ff_graph_pipeline_enter_all(AVFilterGraph *graph)
+{
+    PipelineContext *pc = graph->internal->pipeline;
+    int i;
+
+    if (pc)
+        for (i = 0; i < pc->nb_branches; i++)
+            branch_enter(&pc->branches[i]);
+}
+
+void ff_graph_pipeline_leave_all(AVFilterGraph *graph)
+{
+    PipelineContext *pc = graph->internal->pipeline;
+    int i;
+
+    if (pc)
+        for (i = 0; i < pc->nb_branches; i++)
+            branch_leave(&pc->branches[i]);
+}
+
+void ff_graph_pipeline_lock(AVFilterGraph *graph)
+{
+    PipelineContext *pc = graph ? graph->internal->pipeline : NULL;
+
+    if (pc)
+        pthread_mutex_lock(&pc->lock);
+}
+
+void ff_graph_pipeline_unlock(AVFilterGraph *graph)
+{
+    PipelineContext *pc = graph ? graph->internal->pipeline : NULL;
+
+    if (pc)
+        pthread_mutex_unlock(&pc->lock);
+}
+
+/**
+ * Check that every filter downstream of link has link as its only source
+ * of frames.
+ */
+static int link_is_independent(AVFilterLink *link)
+{
+    AVFilterContext *f = link->dst;
+    int i;
+
+    if (f->nb_inputs != 1)
+        return 0;
+    for (i = 0; i < f->nb_outputs; i++)
+        if (!link_is_independent(f->outputs[i]))
+            return 0;
+    return 1;
+}
+
+/**
+ * Check if a filter downstream of link requests frames from its inputs.
+ * Such requests can be made while filtering a frame, i.e. on the worker of
+ * the branch, which can not pull frames from the rest of the graph.
+ */
+static int branch_pulls_frames(AVFilterLink *link)
+{
+    AVFilterContext *f = link->dst;
+    int i;
+
+    for (i = 0; i < f->nb_outputs; i++)
+        if (f->output_pads[i].request_frame ||
+            f->outputs[i]->flags & FF_LINK_FLAG_REQUEST_LOOP ||
+            branch_pulls_frames(f->outputs[i]))
+            return 1;
+    return 0;
+}
+
+/**
+ * Check if link feeds a branch that can be filtered asynchronously.
+ */
+static int link_is_pipelined(AVFilterLink *link)
+{
+    return link_is_independent(link) && !branch_pulls_frames(link);
+}
+
+/**
+ * Check if a filter is itself part of the subgraph fed by the asynchronous
+ * link of a branch.
+ */
+static int filter_in_branch(AVFilterContext *f)
+{
+    while (f->nb_inputs == 1) {
+        AVFilterLink *link = f->inputs[0];
+        if (link->src->nb_outputs > 1 && link_is_pipelined(link))
+            return 1;
+        f = link->src;
+    }
+    return 0;
+}
+
+static void set_branch(AVFilterLink *link, PipelineBranch *b)
+{
+    int i;
+
+    link->pipeline_branch = b;
+    for (i = 0; i < link->dst->nb_outputs; i++)
+        set_branch(link->dst->outputs[i], b);
+}
+
+void ff_graph_pipeline_free(AVFilterGraph *graph)
+{
+    PipelineContext *pc = graph->internal->pipeline;
+    int i;
+
+    if (!pc)
+        return;
+
+    pthread_mutex_lock(&pc->lock);
+    pc->done = 1;
+    pthread_cond_broadcast(&pc->work_cond);
+    pthread_mutex_unlock(&pc->lock);
+
+    for (i = 0; i < pc->nb_workers; i++)
+        pthread_join(pc->workers[i], NULL);
+
+    for (i = 0; i < pc->nb_branches; i++) {
+        PipelineBranch *b = &pc->branches[i];
+        while (b->nb_queued) {
+            AVFrame *frame = branch_pop(b);
+            av_frame_free(&frame);
+        }
+        b->link->flags &= ~FF_LINK_FLAG_PIPELINE;
+        set_branch(b->link, NULL);
+    }
+
+    pthread_mutex_destroy(&pc->lock);
+    pthread_cond_destroy(&pc->work_cond);
+    pthread_cond_destroy(&pc->idle_cond);
+    av_freep(&pc->workers);
+    av_freep(&pc->branches);
+    av_freep(&graph->internal->pipeline);
+}
+
+int ff_graph_pipeline_init(AVFilterGraph *graph)
+{
+    PipelineContext *pc;
+    int i, j, nb_threads, nb_branches = 0, ret;
+
+    ff_graph_pipeline_free(graph);
+
+    if (!(graph->thread_type & AVFILTER_THREAD_PIPELINE))
+        return 0;
+
+    /* the caller keeps filtering the rest of the graph, so a single worker
+     * already runs the branches concurrently with it */
+    nb_threads = graph->nb_threads ? graph->nb_threads : av_cpu_count();
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        if (f->nb_outputs < 2 || filter_in_branch(f))
+            continue;
+        for (j = 0; j < f->nb_outputs; j++)
+            nb_branches += link_is_pipelined(f->outputs[j]);
+    }
+    if (!nb_branches)
+        return 0;
+
+    pc = av_mallocz(sizeof(*pc));
+    if (!pc)
+        return AVERROR(ENOMEM);
+    pc->branches = av_mallocz_array(nb_branches, sizeof(*pc->branches));
+    pc->workers  = av_mallocz_array(FFMIN(nb_threads, nb_branches),
+                                    sizeof(*pc->workers));
+    if (!pc->branches || !pc->workers) {
+        av_freep(&pc->branches);
+        av_freep(&pc->workers);
+        av_freep(&pc);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_init(&pc->lock, NULL);
+    pthread_cond_init(&pc->work_cond, NULL);
+    pthread_cond_init(&pc->idle_cond, NULL);
+    graph->internal->pipeline = pc;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        if (f->nb_outputs < 2 || filter_in_branch(f))
+            continue;
+        for (j = 0; j < f->nb_outputs; j++) {
+            PipelineBranch *b;
+            if (!link_is_pipelined(f->outputs[j]))
+                continue;
+            b = &pc->branches[pc->nb_branches++];
+            b->pc   = pc;
+            b->link = f->outputs[j];
+            b->link->flags |= FF_LINK_FLAG_PIPELINE;
+            set_branch(b->link, b);
+        }
+    }
+
+    for (i = 0; i < FFMIN(nb_threads, nb_branches); i++) {
+        ret = pthread_create(&pc->workers[i], NULL, pipeline_worker, pc);
+        if (ret) {
+            ff_graph_pipeline_free(graph);
+            return AVERROR(ret);
+        }
+        pc->nb_workers++;
+    }
+
+    av_log(graph, AV_LOG_VERBOSE,
+           "Running %d filtergraph branches on %d pipeline threads.\n",
+           pc->nb_branches, pc->nb_workers);
+
+    return 0;
+}
@@ -26,4 +26,55 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Start the pipeline workers of a configured graph, if pipeline threading
+ * is enabled. The output links of multi-output filters that feed a subgraph
+ * reachable only through them (e.g. the branches after split) become
+ * asynchronous: frames sent on them are queued and filtered on a worker
+ * thread.
+ */
+int ff_graph_pipeline_init(AVFilterGraph *graph);
+
+void ff_graph_pipeline_free(AVFilterGraph *graph);
+
+/**
+ * Queue a frame on an asynchronous link, or filter it directly when the
+ * calling thread is pulling from the branch the link feeds.
+ */
+int ff_graph_pipeline_filter_frame(AVFilterLink *link, AVFrame *frame);
+
+/**
+ * Filter one frame already queued on an asynchronous link.
+ *
+ * @param queued set to 1 if a queued frame was filtered, 0 otherwise
+ * @return the return value of filtering the frame, or a negative AVERROR
+ *         code if the link can not be pulled from the calling thread
+ */
+int ff_graph_pipeline_request_frame(AVFilterLink *link, int *queued);
+
+/**
+ * Suspend the pipeline worker of the branch containing link, if any, so
+ * that the calling thread can access the filters of the branch. Calls can
+ * be nested and must be balanced by ff_graph_pipeline_leave().
+ */
+void ff_graph_pipeline_enter(AVFilterLink *link);
+
+void ff_graph_pipeline_leave(AVFilterLink *link);
+
+/**
+ * Same as ff_graph_pipeline_enter() and ff_graph_pipeline_leave(), for all
+ * the branches of the graph.
+ */
+void ff_graph_pipeline_enter_all(AVFilterGraph *graph);
+
+void ff_graph_pipeline_leave_all(AVFilterGraph *graph);
+
+/**
+ * Lock the graph state shared between pipeline workers (the sink links
+ * heap and the current_pts of the links).
+ */
+void ff_graph_pipeline_lock(AVFilterGraph *graph);
+
+void ff_graph_pipeline_unlock(AVFilterGraph *graph);
+
 #endif /* AVFILTER_THREAD_H */
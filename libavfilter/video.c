@@ -29,7 +29,9 @@
 #include "libavutil/mem.h"
 
 #include "avfilter.h"
+#include "framepool.h"
 #include "internal.h"
+#include "thread.h"
 #include "video.h"
 
 AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
@@ -37,24 +39,47 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
     return ff_get_video_buffer(link->dst->outputs[0], w, h);
 }
 
-/* TODO: set the buffer's priv member to a context structure for the whole
- * filter chain.  This will allow for a buffer pool instead of the constant
- * alloc & free cycle currently implemented. */
-AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
+#define BUFFER_ALIGN 32
+
+/* Frames are allocated from a pool owned by the link, which is recreated
+ * whenever the requested dimensions or the link format change. */
+static AVFrame *pool_get_video_buffer(AVFilterLink *link, int w, int h)
 {
-    AVFrame *frame = av_frame_alloc();
-    int ret;
+    int pool_width = 0;
+    int pool_height = 0;
+    int pool_align = 0;
+    enum AVPixelFormat pool_format = AV_PIX_FMT_NONE;
+
+    if (link->frame_pool) {
+        ff_frame_pool_get_video_config(link->frame_pool, &pool_width,
+                                       &pool_height, &pool_format,
+                                       &pool_align);
+        if (pool_width  != w || pool_height != h ||
+            pool_format != link->format || pool_align != BUFFER_ALIGN)
+            ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
+    }
+
+    if (!link->frame_pool) {
+        link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
+                                                    link->format, BUFFER_ALIGN);
+        if (!link->frame_pool)
+            return NULL;
+    }
+
+    return ff_frame_pool_get(link->frame_pool);
+}
 
-    if (!frame)
-        return NULL;
+AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
+{
+    AVFrame *frame;
 
-    frame->width  = w;
-    frame->height = h;
-    frame->format = link->format;
+    if (!(link->flags & FF_LINK_FLAG_PIPELINE))
+        return pool_get_video_buffer(link, w, h);
 
-    ret = av_frame_get_buffer(frame, 32);
-    if (ret < 0)
-        av_frame_free(&frame);
+    /* the pool of an asynchronous link is shared with its pipeline worker */
+    ff_graph_pipeline_lock(link->graph);
+    frame = pool_get_video_buffer(link, w, h);
+    ff_graph_pipeline_unlock(link->graph);
 
     return frame;
 }
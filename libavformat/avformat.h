@@ -1171,6 +1171,17 @@ typedef struct AVStream {
      * - decoding: Set by libavformat to calculate sample_aspect_ratio internally
      */
     AVRational display_aspect_ratio;
+
+    /**
+     * Keyframes found by the generic index code that would have to be
+     * inserted in the middle of index_entries, sorted by timestamp. They
+     * are merged into index_entries in batches, and before any index
+     * lookup or seek.
+     * NOT PART OF PUBLIC API
+     */
+    AVIndexEntry *index_pending;
+    int nb_index_pending;
+    unsigned int index_pending_allocated_size;
 } AVStream;
 
 AVRational av_stream_get_r_frame_rate(const AVStream *s);
@@ -1799,6 +1810,16 @@ typedef struct AVFormatContext {
      * Demuxing: Set by user.
      */
     int (*open_cb)(struct AVFormatContext *s, AVIOContext **p, const char *url, int flags, const AVIOInterruptCB *int_cb, AVDictionary **options);
+
+    /**
+     * Directory in which avformat_find_stream_info() caches the stream
+     * parameters it finds, and from which it loads them instead of
+     * analyzing an input it has already seen.
+     * If NULL then no cache is used.
+     * - encoding: unused
+     * - decoding: set by user through AVOptions (NO direct access)
+     */
+    char *stream_info_cache;
 } AVFormatContext;
 
 int av_format_get_probe_score(const AVFormatContext *s);
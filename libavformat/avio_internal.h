@@ -62,6 +62,18 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
  */
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size);
 
+/**
+ * Read size bytes from AVIOContext as a reference into memory owned by the
+ * underlying protocol, instead of copying them, if the protocol supports it
+ * (e.g. the file protocol with the mmap option set).
+ * The data may be read-only, and the padding bytes following it are
+ * readable, but not necessarily zeroed; see ff_get_packet_ref().
+ *
+ * @return size on success, AVERROR(ENOSYS) if the data cannot be referenced,
+ *         in which case nothing was read, or another AVERROR code
+ */
+int ffio_read_ref(AVIOContext *s, int size, int padding, AVBufferRef **buf);
+
 void ffio_fill(AVIOContext *s, int b, int count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
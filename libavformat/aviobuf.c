@@ -629,6 +629,41 @@ int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
     return len;
 }
 
+int ffio_read_ref(AVIOContext *s, int size, int padding, AVBufferRef **buf)
+{
+    URLContext *h;
+    int64_t pos;
+    int ret;
+
+    if (size <= 0 || s->write_flag || s->update_checksum ||
+        s->read_packet != (int (*)(void *, uint8_t *, int)) ffurl_read)
+        return AVERROR(ENOSYS);
+    h = s->opaque;
+    if (!h->prot->url_read_ref)
+        return AVERROR(ENOSYS);
+
+    pos = avio_tell(s);
+    ret = h->prot->url_read_ref(h, pos, size, padding, buf);
+    if (ret < 0)
+        return ret;
+
+    if (s->buf_end - s->buf_ptr >= size) {
+        s->buf_ptr += size;
+    } else {
+        /* Move the protocol past the referenced data directly, avio_seek()
+         * would read short distances into the buffer instead. */
+        int64_t res = s->seek(s->opaque, pos + size, SEEK_SET);
+        if (res < 0) {
+            av_buffer_unref(buf);
+            return res;
+        }
+        s->buf_end = s->buf_ptr = s->buffer;
+        s->pos = pos + size;
+    }
+    s->eof_reached = 0;
+    return size;
+}
+
 unsigned int avio_rl16(AVIOContext *s)
 {
     unsigned int val;
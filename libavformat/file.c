@@ -32,6 +32,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -51,11 +54,20 @@ typedef struct FileContext {
     int fd;
     int trunc;
     int blocksize;
+    int use_mmap;
+    AVBufferRef *map;   ///< FileMapping of the whole file, if use_mmap
+    int64_t map_size;
 } FileContext;
 
+typedef struct FileMapping {
+    uint8_t *data;
+    size_t size;
+} FileMapping;
+
 static const AVOption file_options[] = {
     { "truncate", "truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "map files opened for reading into memory and read packets without copying", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -133,6 +145,90 @@ static int file_check(URLContext *h, int mask)
 
 #if CONFIG_FILE_PROTOCOL
 
+#if HAVE_MMAP
+static void file_mapping_free(void *opaque, uint8_t *data)
+{
+    FileMapping *m = (FileMapping *)data;
+    munmap(m->data, m->size);
+    av_free(m);
+}
+
+static void file_mapping_unref(void *opaque, uint8_t *data)
+{
+    AVBufferRef *map = opaque;
+    av_buffer_unref(&map);
+}
+
+static int file_map(URLContext *h, const struct stat *st)
+{
+    FileContext *c = h->priv_data;
+    FileMapping *m;
+    void *ptr;
+
+    if (!S_ISREG(st->st_mode) || st->st_size <= 0 ||
+        st->st_size > SIZE_MAX)
+        return AVERROR(ENOSYS);
+
+    m = av_mallocz(sizeof(*m));
+    if (!m)
+        return AVERROR(ENOMEM);
+
+    ptr = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, c->fd, 0);
+    if (ptr == MAP_FAILED) {
+        int err = AVERROR(errno);
+        av_free(m);
+        return err;
+    }
+    m->data = ptr;
+    m->size = st->st_size;
+
+    c->map = av_buffer_create((uint8_t *)m, sizeof(*m), file_mapping_free, NULL, 0);
+    if (!c->map) {
+        munmap(ptr, st->st_size);
+        av_free(m);
+        return AVERROR(ENOMEM);
+    }
+    c->map_size = st->st_size;
+    return 0;
+}
+
+static int file_read_ref(URLContext *h, int64_t pos, int size, int padding,
+                         AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+    const FileMapping *m;
+    AVBufferRef *map;
+
+    /* data appended since the file was mapped is read() instead */
+    if (!c->map || pos < 0 || size <= 0 || pos + size > c->map_size)
+        return AVERROR(ENOSYS);
+
+    m = (const FileMapping *)c->map->data;
+    if (pos + size + padding > c->map_size) {
+        /* the tail of the file, copy it to get the padding */
+        *buf = av_buffer_alloc(size + padding);
+        if (!*buf)
+            return AVERROR(ENOMEM);
+        memcpy((*buf)->data, m->data + pos, size);
+        memset((*buf)->data + size, 0, padding);
+        return size;
+    }
+
+    map = av_buffer_ref(c->map);
+    if (!map)
+        return AVERROR(ENOMEM);
+    /* The packets share the read-only mapping, so they must never be
+     * written to; av_buffer_make_writable() will copy them. */
+    *buf = av_buffer_create(m->data + pos, size, file_mapping_unref, map,
+                            AV_BUFFER_FLAG_READONLY);
+    if (!*buf) {
+        av_buffer_unref(&map);
+        return AVERROR(ENOMEM);
+    }
+    return size;
+}
+#endif
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
@@ -163,6 +259,15 @@ static int file_open(URLContext *h, const char *filename, int flags)
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !h->is_streamed) {
+        int ret = file_map(h, &st);
+        if (ret < 0 && ret != AVERROR(ENOSYS))
+            av_log(h, AV_LOG_WARNING, "Could not map %s, reading it instead\n",
+                   filename);
+    }
+#endif
+
     return 0;
 }
 
@@ -186,6 +291,7 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+    av_buffer_unref(&c->map);
     return close(c->fd);
 }
 
@@ -198,6 +304,9 @@ URLProtocol ff_file_protocol = {
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
+#if HAVE_MMAP
+    .url_read_ref        = file_read_ref,
+#endif
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
 };
@@ -166,12 +166,366 @@ AVInputFormat *av_find_input_format(const char *short_name)
     return NULL;
 }
 
+/**
+ * Fixed leading bytes required by a demuxer's read_probe() callback.
+ * Only demuxers whose probe function returns 0 whenever the buffer does
+ * not start with one of the listed signatures may appear here; demuxers
+ * which scan the buffer for a sync pattern are always probed.
+ */
+static const struct {
+    const char *name;
+    const char *magic;
+    int len;
+} probe_magic[] = {
+    { "4xm",          "RIFF",                               4 },
+    { "aiff",         "FORM",                               4 },
+    { "apng",         "\x89PNG\r\n\x1a\n",                  8 },
+    { "asf",          "\x30\x26\xb2\x75",                   4 },
+    { "au",           ".snd",                               4 },
+    { "avi",          "RIFF",                               4 },
+    { "avi",          "ON2 ",                               4 },
+    { "bink",         "BIK",                                3 },
+    { "bink",         "KB2",                                3 },
+    { "bmp_pipe",     "BM",                                 2 },
+    { "caf",          "caff",                               4 },
+    { "dpx_pipe",     "SDPX",                               4 },
+    { "dpx_pipe",     "XPDS",                               4 },
+    { "dsf",          "DSD ",                               4 },
+    { "exr_pipe",     "\x76\x2f\x31\x01",                   4 },
+    { "ffm",          "FFM1",                               4 },
+    { "ffm",          "FFM2",                               4 },
+    { "ffmetadata",   ";FFMETADATA",                       11 },
+    { "film_cpk",     "FILM",                               4 },
+    { "flac",         "fLaC",                               4 },
+    { "flac",         "\xff\xf8",                           2 },
+    { "flac",         "\xff\xf9",                           2 },
+    { "flv",          "FLV",                                3 },
+    { "gif",          "GIF8",                               4 },
+    { "iff",          "FORM",                               4 },
+    { "iff",          "FRM8",                               4 },
+    { "ivf",          "DKIF",                               4 },
+    { "j2k_pipe",     "\x00\x00\x00\x0c\x6a\x50\x20\x20",   8 },
+    { "j2k_pipe",     "\xff\x4f\xff\x51",                   4 },
+    { "jpeg_pipe",    "\xff\xd8",                           2 },
+    { "jpegls_pipe",  "\xff\xd8\xff\xf7",                   4 },
+    { "live_flv",     "FLV",                                3 },
+    { "lvf",          "LVFF",                               4 },
+    { "matroska",     "\x1a\x45\xdf\xa3",                   4 },
+    { "mpc",          "MP+",                                3 },
+    { "mpc8",         "MPCK",                               4 },
+    { "ogg",          "OggS",                               4 },
+    { "pictor_pipe",  "\x34\x12",                           2 },
+    { "png_pipe",     "\x89PNG\r\n\x1a\n",                  8 },
+    { "qcp",          "RIFF",                               4 },
+    { "rm",           ".RMF",                               4 },
+    { "rm",           ".ra\xfd",                            4 },
+    { "sdr2",         "SRA\x01",                            4 },
+    { "sgi_pipe",     "\x01\xda",                           2 },
+    { "smk",          "SMK2",                               4 },
+    { "smk",          "SMK4",                               4 },
+    { "sox",          ".SoX",                               4 },
+    { "sox",          "XoS.",                               4 },
+    { "sunrast_pipe", "\x59\xa6\x6a\x95",                   4 },
+    { "thp",          "THP\x00",                            4 },
+    { "tiff_pipe",    "II*\x00",                            4 },
+    { "tiff_pipe",    "MM\x00*",                            4 },
+    { "tta",          "TTA1",                               4 },
+    { "voc",          "Creative",                           8 },
+    { "vqf",          "TWIN",                               4 },
+    { "w64",          "riff",                               4 },
+    { "wav",          "RIFF",                               4 },
+    { "wav",          "RIFX",                               4 },
+    { "wav",          "RF64",                               4 },
+    { "webp_pipe",    "RIFF",                               4 },
+    { "wv",           "wvpk",                               4 },
+    { "xwma",         "RIFF",                               4 },
+    { "yuv4mpegpipe", "YUV4MPEG2",                          9 },
+};
+
+#define PROBE_EXT_SIZE 16
+
+typedef struct ProbeMagic {
+    AVInputFormat *fmt;
+    const uint8_t *magic;
+    int len;
+} ProbeMagic;
+
+typedef struct ProbeExt {
+    char ext[PROBE_EXT_SIZE];
+    AVInputFormat *fmt;
+    int probe_always;   ///< fmt is also part of ProbeIndex.probe_always
+} ProbeExt;
+
+/**
+ * Lookup tables restricting the demuxers considered by
+ * av_probe_input_format3() to the plausible ones.
+ */
+typedef struct ProbeIndex {
+    AVInputFormat *last;            ///< last format registered when the index was built
+    AVInputFormat **probe_always;   ///< formats with a probe function but no known signature
+    int nb_probe_always;
+    ProbeMagic *magic;              ///< signatures, sorted by their first byte
+    int nb_magic;
+    int magic_start[257];           ///< index of the first signature for each first byte
+    ProbeExt *ext;                  ///< extensions, sorted case-insensitively
+    int nb_ext;
+} ProbeIndex;
+
+static ProbeIndex *volatile probe_index;
+
+static int probe_magic_cmp(const void *a, const void *b)
+{
+    const ProbeMagic *ma = a, *mb = b;
+    return ma->magic[0] - mb->magic[0];
+}
+
+static int probe_ext_cmp(const void *a, const void *b)
+{
+    const ProbeExt *ea = a, *eb = b;
+    return av_strcasecmp(ea->ext, eb->ext);
+}
+
+static void probe_index_free(ProbeIndex *idx)
+{
+    if (!idx)
+        return;
+    av_freep(&idx->probe_always);
+    av_freep(&idx->magic);
+    av_freep(&idx->ext);
+    av_free(idx);
+}
+
+static int has_magic(const ProbeIndex *idx, const AVInputFormat *fmt)
+{
+    int i;
+    for (i = 0; i < idx->nb_magic; i++)
+        if (idx->magic[i].fmt == fmt)
+            return 1;
+    return 0;
+}
+
+static ProbeIndex *probe_index_build(void)
+{
+    ProbeIndex *idx = av_mallocz(sizeof(*idx));
+    AVInputFormat *fmt = NULL;
+    int i, j, nb_formats = 0, nb_ext = 0;
+
+    if (!idx)
+        return NULL;
+
+    while ((fmt = av_iformat_next(fmt))) {
+        const char *p = fmt->extensions;
+        nb_formats++;
+        idx->last = fmt;
+        while (p && *p) {
+            nb_ext++;
+            p += strcspn(p, ",");
+            p += !!*p;
+        }
+    }
+
+    idx->magic        = av_malloc_array(FF_ARRAY_ELEMS(probe_magic), sizeof(*idx->magic));
+    idx->probe_always = av_malloc_array(nb_formats, sizeof(*idx->probe_always));
+    idx->ext          = av_malloc_array(nb_ext,     sizeof(*idx->ext));
+    if (!idx->magic || !idx->probe_always || (nb_ext && !idx->ext))
+        goto fail;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(probe_magic); i++) {
+        AVInputFormat *f = av_find_input_format(probe_magic[i].name);
+        if (!f || !f->read_probe)
+            continue;
+        idx->magic[idx->nb_magic].fmt   = f;
+        idx->magic[idx->nb_magic].magic = (const uint8_t *)probe_magic[i].magic;
+        idx->magic[idx->nb_magic].len   = probe_magic[i].len;
+        idx->nb_magic++;
+    }
+    qsort(idx->magic, idx->nb_magic, sizeof(*idx->magic), probe_magic_cmp);
+    for (i = 0, j = 0; i < 256; i++) {
+        while (j < idx->nb_magic && idx->magic[j].magic[0] < i)
+            j++;
+        idx->magic_start[i] = j;
+    }
+    idx->magic_start[256] = idx->nb_magic;
+
+    fmt = NULL;
+    while ((fmt = av_iformat_next(fmt))) {
+        const char *p = fmt->extensions;
+        int always = fmt->read_probe && !has_magic(idx, fmt);
+
+        if (always)
+            idx->probe_always[idx->nb_probe_always++] = fmt;
+        while (p && *p) {
+            int len = strcspn(p, ",");
+            if (len < PROBE_EXT_SIZE) {
+                ProbeExt *e = &idx->ext[idx->nb_ext++];
+                av_strlcpy(e->ext, p, len + 1);
+                e->fmt          = fmt;
+                e->probe_always = always;
+            }
+            p += len;
+            p += !!*p;
+        }
+        if (fmt == idx->last)
+            break;
+    }
+    qsort(idx->ext, idx->nb_ext, sizeof(*idx->ext), probe_ext_cmp);
+
+    return idx;
+fail:
+    probe_index_free(idx);
+    return NULL;
+}
+
+static ProbeIndex *get_probe_index(void)
+{
+    ProbeIndex *idx = probe_index;
+
+    if (!idx) {
+        idx = probe_index_build();
+        if (idx && avpriv_atomic_ptr_cas((void * volatile *)&probe_index, NULL, idx)) {
+            probe_index_free(idx);
+            idx = probe_index;
+        }
+    }
+    return idx;
+}
+
+typedef struct ProbeState {
+    AVProbeData *pd;
+    int is_opened;
+    int nodat;
+    int score_max;
+    AVInputFormat *fmt;
+} ProbeState;
+
+static void probe_format(ProbeState *st, AVInputFormat *fmt1, int ext_match)
+{
+    AVProbeData *lpd = st->pd;
+    int score = 0;
+
+    if (!st->is_opened == !(fmt1->flags & AVFMT_NOFILE) && strcmp(fmt1->name, "image2"))
+        return;
+    if (fmt1->read_probe) {
+        score = fmt1->read_probe(lpd);
+        if (score)
+            av_log(NULL, AV_LOG_TRACE, "Probing %s score:%d size:%d\n", fmt1->name, score, lpd->buf_size);
+        if (fmt1->extensions && ext_match) {
+            if      (st->nodat == 0) score = FFMAX(score, 1);
+            else if (st->nodat == 1) score = FFMAX(score, AVPROBE_SCORE_EXTENSION / 2 - 1);
+            else                     score = FFMAX(score, AVPROBE_SCORE_EXTENSION);
+        }
+    } else if (fmt1->extensions) {
+        if (ext_match)
+            score = AVPROBE_SCORE_EXTENSION;
+    }
+    if (av_match_name(lpd->mime_type, fmt1->mime_type))
+        score = FFMAX(score, AVPROBE_SCORE_MIME);
+    if (score > st->score_max) {
+        st->score_max = score;
+        st->fmt       = fmt1;
+    } else if (score == st->score_max)
+        st->fmt = NULL;
+}
+
+#define MAX_PROBE_CANDIDATES 64
+
+/**
+ * Probe only the formats which may return a nonzero score: those without
+ * a known signature, those whose signature matches the buffer and those
+ * whose extension matches the file name. Since the result of probing does
+ * not depend on the order in which the formats are tried, this gives the
+ * same result as trying every registered format.
+ *
+ * @return 0 on success, a negative value if the full scan must be used
+ */
+static int probe_indexed(ProbeState *st)
+{
+    const ProbeIndex *idx = get_probe_index();
+    AVProbeData *lpd = st->pd;
+    AVInputFormat *cand[MAX_PROBE_CANDIDATES], *ext_fmt[MAX_PROBE_CANDIDATES];
+    AVInputFormat *fmt1;
+    const char *ext = NULL;
+    int nb_cand = 0, nb_ext_fmt = 0, i, j;
+
+    if (!idx || lpd->mime_type)
+        return -1;
+
+    if (lpd->filename && (ext = strrchr(lpd->filename, '.'))) {
+        ext++;
+        if (!*ext || strlen(ext) >= PROBE_EXT_SIZE || strchr(ext, ','))
+            return -1;
+    }
+
+    if (ext) {
+        ProbeExt key, *e;
+
+        av_strlcpy(key.ext, ext, sizeof(key.ext));
+        e = bsearch(&key, idx->ext, idx->nb_ext, sizeof(*idx->ext), probe_ext_cmp);
+        if (e) {
+            while (e > idx->ext && !probe_ext_cmp(e - 1, &key))
+                e--;
+            for (; e < idx->ext + idx->nb_ext && !probe_ext_cmp(e, &key); e++) {
+                if (nb_ext_fmt == MAX_PROBE_CANDIDATES)
+                    return -1;
+                ext_fmt[nb_ext_fmt++] = e->fmt;
+                if (!e->probe_always)
+                    cand[nb_cand++] = e->fmt;
+            }
+        }
+    }
+
+    for (i = idx->magic_start[lpd->buf[0]]; i < idx->magic_start[lpd->buf[0] + 1]; i++) {
+        const ProbeMagic *m = &idx->magic[i];
+        if (memcmp(lpd->buf, m->magic, m->len))
+            continue;
+        if (nb_cand == MAX_PROBE_CANDIDATES)
+            return -1;
+        cand[nb_cand++] = m->fmt;
+    }
+
+    for (i = 0; i < idx->nb_probe_always; i++) {
+        int ext_match = 0;
+        fmt1 = idx->probe_always[i];
+        for (j = 0; j < nb_ext_fmt && !ext_match; j++)
+            ext_match = ext_fmt[j] == fmt1;
+        probe_format(st, fmt1, ext_match);
+    }
+
+    for (i = 0; i < nb_cand; i++) {
+        int ext_match = 0, dup = 0;
+        fmt1 = cand[i];
+        for (j = 0; j < i && !dup; j++)
+            dup = cand[j] == fmt1;
+        if (dup)
+            continue;
+        for (j = 0; j < nb_ext_fmt && !ext_match; j++)
+            ext_match = ext_fmt[j] == fmt1;
+        probe_format(st, fmt1, ext_match);
+    }
+
+    /* formats registered after the index was built */
+    fmt1 = idx->last;
+    while ((fmt1 = av_iformat_next(fmt1)))
+        probe_format(st, fmt1, fmt1->extensions && av_match_ext(lpd->filename, fmt1->extensions));
+
+    return 0;
+}
+
+static void probe_all(ProbeState *st)
+{
+    AVInputFormat *fmt1 = NULL;
+
+    st->score_max = 0;
+    st->fmt       = NULL;
+    while ((fmt1 = av_iformat_next(fmt1)))
+        probe_format(st, fmt1, fmt1->extensions && av_match_ext(st->pd->filename, fmt1->extensions));
+}
+
 AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened,
                                       int *score_ret)
 {
     AVProbeData lpd = *pd;
-    AVInputFormat *fmt1 = NULL, *fmt;
-    int score, nodat = 0, score_max = 0;
+    ProbeState st = { &lpd, is_opened };
     const static uint8_t zerobuffer[AVPROBE_PADDING_SIZE];
 
     if (!lpd.buf)
@@ -183,42 +537,18 @@ AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened,
             lpd.buf      += id3len;
             lpd.buf_size -= id3len;
         } else if (id3len >= PROBE_BUF_MAX) {
-            nodat = 2;
+            st.nodat = 2;
         } else
-            nodat = 1;
+            st.nodat = 1;
     }
 
-    fmt = NULL;
-    while ((fmt1 = av_iformat_next(fmt1))) {
-        if (!is_opened == !(fmt1->flags & AVFMT_NOFILE) && strcmp(fmt1->name, "image2"))
-            continue;
-        score = 0;
-        if (fmt1->read_probe) {
-            score = fmt1->read_probe(&lpd);
-            if (score)
-                av_log(NULL, AV_LOG_TRACE, "Probing %s score:%d size:%d\n", fmt1->name, score, lpd.buf_size);
-            if (fmt1->extensions && av_match_ext(lpd.filename, fmt1->extensions)) {
-                if      (nodat == 0) score = FFMAX(score, 1);
-                else if (nodat == 1) score = FFMAX(score, AVPROBE_SCORE_EXTENSION / 2 - 1);
-                else                 score = FFMAX(score, AVPROBE_SCORE_EXTENSION);
-            }
-        } else if (fmt1->extensions) {
-            if (av_match_ext(lpd.filename, fmt1->extensions))
-                score = AVPROBE_SCORE_EXTENSION;
-        }
-        if (av_match_name(lpd.mime_type, fmt1->mime_type))
-            score = FFMAX(score, AVPROBE_SCORE_MIME);
-        if (score > score_max) {
-            score_max = score;
-            fmt       = fmt1;
-        } else if (score == score_max)
-            fmt = NULL;
-    }
-    if (nodat == 1)
-        score_max = FFMIN(AVPROBE_SCORE_EXTENSION / 2 - 1, score_max);
-    *score_ret = score_max;
+    if (probe_indexed(&st) < 0)
+        probe_all(&st);
+    if (st.nodat == 1)
+        st.score_max = FFMIN(AVPROBE_SCORE_EXTENSION / 2 - 1, st.score_max);
+    *score_ret = st.score_max;
 
-    return fmt;
+    return st.fmt;
 }
 
 AVInputFormat *av_probe_input_format2(AVProbeData *pd, int is_opened, int *score_max)
@@ -338,3 +668,89 @@ int av_probe_input_buffer(AVIOContext *pb, AVInputFormat **fmt,
     int ret = av_probe_input_buffer2(pb, fmt, filename, logctx, offset, max_probe_size);
     return ret < 0 ? ret : 0;
 }
+
+#ifdef TEST
+#include <stdio.h>
+#include "libavutil/lfg.h"
+
+#define TEST_BUF_SIZE 2048
+
+static int nb_checks, nb_errors;
+
+/* probing through the index must give the format and score of a full scan */
+static void check(uint8_t *buf, int size, const char *filename)
+{
+    AVProbeData pd = { filename, buf, size };
+    int is_opened;
+
+    for (is_opened = 0; is_opened < 2; is_opened++) {
+        ProbeState indexed = { &pd, is_opened }, full = { &pd, is_opened };
+
+        if (probe_indexed(&indexed) < 0)
+            continue;
+        probe_all(&full);
+        nb_checks++;
+        if (indexed.fmt != full.fmt || indexed.score_max != full.score_max) {
+            printf("%s, size %d, first bytes %02x%02x%02x%02x, opened %d: "
+                   "%s/%d indexed, %s/%d full scan\n",
+                   filename, size, buf[0], buf[1], buf[2], buf[3], is_opened,
+                   indexed.fmt ? indexed.fmt->name : "none", indexed.score_max,
+                   full.fmt    ? full.fmt->name    : "none", full.score_max);
+            nb_errors++;
+        }
+    }
+}
+
+static void fill(AVLFG *lfg, uint8_t *buf, int size)
+{
+    int i;
+    /* zeros are common in headers and make more probe functions succeed */
+    for (i = 0; i < size; i++)
+        buf[i] = av_lfg_get(lfg) & 3 ? av_lfg_get(lfg) : 0;
+    memset(buf + size, 0, AVPROBE_PADDING_SIZE);
+}
+
+int main(void)
+{
+    static const char *filenames[] = { "", "file", "file.", "file.bin" };
+    uint8_t buf[TEST_BUF_SIZE + AVPROBE_PADDING_SIZE];
+    char filename[32];
+    AVInputFormat *fmt = NULL;
+    AVLFG lfg;
+    int i, j, size;
+
+    av_register_all();
+    av_lfg_init(&lfg, 1);
+
+    /* every signature, with random data after it */
+    for (i = 0; i < FF_ARRAY_ELEMS(probe_magic); i++) {
+        for (size = probe_magic[i].len; size <= TEST_BUF_SIZE; size *= 4) {
+            fill(&lfg, buf, size);
+            memcpy(buf, probe_magic[i].magic, probe_magic[i].len);
+            for (j = 0; j < FF_ARRAY_ELEMS(filenames); j++)
+                check(buf, size, filenames[j]);
+            snprintf(filename, sizeof(filename), "file.%s", probe_magic[i].name);
+            check(buf, size, filename);
+        }
+    }
+
+    /* every first byte, with the extensions of every demuxer */
+    for (i = 0; i < 4096; i++) {
+        const char *ext;
+
+        if (!(fmt = av_iformat_next(fmt)))
+            fmt = av_iformat_next(NULL);
+        ext = fmt->extensions ? fmt->extensions : fmt->name;
+        snprintf(filename, sizeof(filename), "file.%.*s",
+                 (int)strcspn(ext, ","), ext);
+        size = av_lfg_get(&lfg) % TEST_BUF_SIZE;
+        fill(&lfg, buf, size);
+        buf[0] = i;
+        check(buf, size, filename);
+    }
+
+    if (nb_errors)
+        printf("%d of %d checks failed\n", nb_errors, nb_checks);
+    return !!nb_errors;
+}
+#endif /* TEST */
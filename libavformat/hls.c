@@ -28,6 +28,7 @@
 
 #include "libavutil/avstring.h"
 #include "libavutil/avassert.h"
+#include "libavutil/atomic.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
@@ -39,6 +40,10 @@
 #include "url.h"
 #include "id3v2.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #define INITIAL_BUFFER_SIZE 32768
 
 #define MAX_FIELD_LEN 64
@@ -75,6 +80,28 @@ struct segment {
     uint8_t iv[16];
 };
 
+/*
+ * A request for a media segment, downloaded ahead of time by the prefetch
+ * thread of the playlist. Everything needed to open the segment is copied
+ * into the job, so that the thread never touches the segment list, which
+ * may change when the playlist is reloaded.
+ */
+struct segment_job {
+    int seq_no;
+    char url[MAX_URL_SIZE];
+    AVDictionary *opts;
+    int64_t seek_offset;        /* offset to seek to after opening, or -1 */
+    int64_t size;               /* size of the segment, or -1 if unknown */
+
+    /* set by the prefetch thread, valid once done is set */
+    int started, done;
+    int ret;                    /* result of opening the segment */
+    URLContext *input;          /* rest of the segment, if it did not fit in buf */
+    uint8_t *buf;
+    int buf_len, buf_size;
+    int buf_pos;                /* read position of the demuxer in buf */
+};
+
 struct rendition;
 
 enum PlaylistType {
@@ -135,6 +162,21 @@ struct playlist {
      * multiple (playlist-less) renditions associated with them. */
     int n_renditions;
     struct rendition **renditions;
+
+    /* Segment prefetching, see prefetch_thread(). The job list holds
+     * queued, running and completed jobs in segment order, cur_job is
+     * the one currently being read from. */
+    struct segment_job **jobs;
+    int n_jobs;
+    struct segment_job *cur_job;
+#if HAVE_PTHREADS
+    pthread_t *prefetch_threads;
+    int nb_prefetch_threads;
+    pthread_mutex_t prefetch_lock;
+    pthread_cond_t prefetch_cond;
+#endif
+    volatile int prefetch_abort;
+    AVIOInterruptCB prefetch_int_cb;
 };
 
 /*
@@ -182,6 +224,8 @@ typedef struct HLSContext {
     char *user_agent;                    ///< holds HTTP user agent set as an AVOption to the HTTP protocol context
     char *cookies;                       ///< holds HTTP cookie values set in either the initial response or as an AVOption to the HTTP protocol context
     char *headers;                       ///< holds HTTP headers set as an AVOption to the HTTP protocol context
+    int prefetch_segments;
+    int prefetch_buffer_size;
 } HLSContext;
 
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
@@ -204,11 +248,55 @@ static void free_segment_list(struct playlist *pls)
     pls->n_segments = 0;
 }
 
+static void free_segment_job(struct segment_job **job)
+{
+    if (!*job)
+        return;
+    ffurl_closep(&(*job)->input);
+    av_dict_free(&(*job)->opts);
+    av_freep(&(*job)->buf);
+    av_freep(job);
+}
+
+/* Stop the prefetch threads of the playlist and drop all prefetched data. */
+static void stop_prefetch(struct playlist *pls)
+{
+    int i;
+
+#if HAVE_PTHREADS
+    if (pls->nb_prefetch_threads) {
+        pthread_mutex_lock(&pls->prefetch_lock);
+        avpriv_atomic_int_set(&pls->prefetch_abort, 1);
+        pthread_cond_broadcast(&pls->prefetch_cond);
+        pthread_mutex_unlock(&pls->prefetch_lock);
+        for (i = 0; i < pls->nb_prefetch_threads; i++)
+            pthread_join(pls->prefetch_threads[i], NULL);
+        pthread_cond_destroy(&pls->prefetch_cond);
+        pthread_mutex_destroy(&pls->prefetch_lock);
+        av_freep(&pls->prefetch_threads);
+        pls->nb_prefetch_threads = 0;
+        pls->prefetch_abort = 0;
+    }
+#endif
+    for (i = 0; i < pls->n_jobs; i++)
+        free_segment_job(&pls->jobs[i]);
+    av_freep(&pls->jobs);
+    pls->n_jobs = 0;
+}
+
+/* Close the segment currently being read. */
+static void close_segment(struct playlist *pls)
+{
+    ffurl_closep(&pls->input);
+    free_segment_job(&pls->cur_job);
+}
+
 static void free_playlist_list(HLSContext *c)
 {
     int i;
     for (i = 0; i < c->n_playlists; i++) {
         struct playlist *pls = c->playlists[i];
+        stop_prefetch(pls);
         free_segment_list(pls);
         av_freep(&pls->renditions);
         av_freep(&pls->id3_buf);
@@ -216,8 +304,7 @@ static void free_playlist_list(HLSContext *c)
         ff_id3v2_free_extra_meta(&pls->id3_deferred_extra);
         av_free_packet(&pls->pkt);
         av_freep(&pls->pb.buffer);
-        if (pls->input)
-            ffurl_close(pls->input);
+        close_segment(pls);
         if (pls->ctx) {
             pls->ctx->pb = NULL;
             avformat_close_input(&pls->ctx);
@@ -691,12 +778,25 @@ static int read_from_url(struct playlist *pls, uint8_t *buf, int buf_size,
 {
     int ret;
     struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+    struct segment_job *job = pls->cur_job;
 
      /* limit read if the segment was only a part of a file */
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    if (mode == READ_COMPLETE)
+    if (job && job->buf_pos < job->buf_len) {
+        /* prefetched data first, then the rest of the segment, if any */
+        ret = FFMIN(buf_size, job->buf_len - job->buf_pos);
+        memcpy(buf, job->buf + job->buf_pos, ret);
+        job->buf_pos += ret;
+        if (mode == READ_COMPLETE && ret < buf_size && pls->input) {
+            int ret2 = ffurl_read_complete(pls->input, buf + ret, buf_size - ret);
+            if (ret2 > 0)
+                ret += ret2;
+        }
+    } else if (!pls->input)
+        ret = AVERROR_EOF;
+    else if (mode == READ_COMPLETE)
         ret = ffurl_read_complete(pls->input, buf, buf_size);
     else
         ret = ffurl_read(pls->input, buf, buf_size);
@@ -913,38 +1013,43 @@ static void update_options(char **dest, const char *name, void *src)
         av_freep(dest);
 }
 
-static int open_input(HLSContext *c, struct playlist *pls)
+/*
+ * Set up the request for a segment: the URL to open, the options to pass
+ * and the offset to seek to after opening, if any. This fetches the key of
+ * encrypted segments if it changed.
+ */
+static int prepare_segment_request(HLSContext *c, struct playlist *pls,
+                                   struct segment *seg, char *url, int url_size,
+                                   AVDictionary **opts, int64_t *seek_offset)
 {
-    AVDictionary *opts = NULL;
     AVDictionary *opts2 = NULL;
-    int ret;
-    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+    int ret = 0;
 
     // broker prior HTTP options that should be consistent across requests
-    av_dict_set(&opts, "user-agent", c->user_agent, 0);
-    av_dict_set(&opts, "cookies", c->cookies, 0);
-    av_dict_set(&opts, "headers", c->headers, 0);
-    av_dict_set(&opts, "seekable", "0", 0);
+    av_dict_set(opts, "user-agent", c->user_agent, 0);
+    av_dict_set(opts, "cookies", c->cookies, 0);
+    av_dict_set(opts, "headers", c->headers, 0);
+    av_dict_set(opts, "seekable", "0", 0);
 
     // Same opts for key request (ffurl_open mutilates the opts so it cannot be used twice)
-    av_dict_copy(&opts2, opts, 0);
+    av_dict_copy(&opts2, *opts, 0);
 
     if (seg->size >= 0) {
         /* try to restrict the HTTP request to the part we want
          * (if this is in fact a HTTP request) */
-        av_dict_set_int(&opts, "offset", seg->url_offset, 0);
-        av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+        av_dict_set_int(opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(opts, "end_offset", seg->url_offset + seg->size, 0);
     }
 
-    av_log(pls->parent, AV_LOG_VERBOSE, "HLS request for url '%s', offset %"PRId64", playlist %d\n",
-           seg->url, seg->url_offset, pls->index);
-
+    *seek_offset = -1;
     if (seg->key_type == KEY_NONE) {
-        ret = ffurl_open(&pls->input, seg->url, AVIO_FLAG_READ,
-                          &pls->parent->interrupt_callback, &opts);
-
+        av_strlcpy(url, seg->url, url_size);
+        /* Seek to the requested position. If this was a HTTP request, the
+         * offset should already be where want it to, but this allows e.g.
+         * local testing without a HTTP server. */
+        *seek_offset = seg->url_offset;
     } else if (seg->key_type == KEY_AES_128) {
-        char iv[33], key[33], url[MAX_URL_SIZE];
+        char iv[33], key[33];
         if (strcmp(seg->key, pls->key_url)) {
             URLContext *uc;
             if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ,
@@ -955,7 +1060,7 @@ static int open_input(HLSContext *c, struct playlist *pls)
                            seg->key);
                 }
                 update_options(&c->cookies, "cookies", uc->priv_data);
-                av_dict_set(&opts, "cookies", c->cookies, 0);
+                av_dict_set(opts, "cookies", c->cookies, 0);
                 ffurl_close(uc);
             } else {
                 av_log(NULL, AV_LOG_ERROR, "Unable to open key file %s\n",
@@ -967,21 +1072,13 @@ static int open_input(HLSContext *c, struct playlist *pls)
         ff_data_to_hex(key, pls->key, sizeof(pls->key), 0);
         iv[32] = key[32] = '\0';
         if (strstr(seg->url, "://"))
-            snprintf(url, sizeof(url), "crypto+%s", seg->url);
+            snprintf(url, url_size, "crypto+%s", seg->url);
         else
-            snprintf(url, sizeof(url), "crypto:%s", seg->url);
-        if ((ret = ffurl_alloc(&pls->input, url, AVIO_FLAG_READ,
-                               &pls->parent->interrupt_callback)) < 0)
-            goto cleanup;
-        av_opt_set(pls->input->priv_data, "key", key, 0);
-        av_opt_set(pls->input->priv_data, "iv", iv, 0);
-
-        if ((ret = ffurl_connect(pls->input, &opts)) < 0) {
-            ffurl_close(pls->input);
-            pls->input = NULL;
-            goto cleanup;
-        }
-        ret = 0;
+            snprintf(url, url_size, "crypto:%s", seg->url);
+        /* options of the crypto protocol, the rest is passed on to the
+         * nested protocol */
+        av_dict_set(opts, "key", key, 0);
+        av_dict_set(opts, "iv", iv, 0);
     } else if (seg->key_type == KEY_SAMPLE_AES) {
         av_log(pls->parent, AV_LOG_ERROR,
                "SAMPLE-AES encryption is not supported yet\n");
@@ -990,26 +1087,257 @@ static int open_input(HLSContext *c, struct playlist *pls)
     else
       ret = AVERROR(ENOSYS);
 
-    /* Seek to the requested position. If this was a HTTP request, the offset
-     * should already be where want it to, but this allows e.g. local testing
-     * without a HTTP server. */
-    if (ret == 0 && seg->key_type == KEY_NONE) {
-        int seekret = ffurl_seek(pls->input, seg->url_offset, SEEK_SET);
+    av_dict_free(&opts2);
+    return ret;
+}
+
+static int open_segment_url(struct playlist *pls, URLContext **in,
+                            const char *url, AVDictionary **opts,
+                            int64_t seek_offset, AVIOInterruptCB *int_cb)
+{
+    int ret = ffurl_open(in, url, AVIO_FLAG_READ, int_cb, opts);
+
+    if (ret == 0 && seek_offset >= 0) {
+        int64_t seekret = ffurl_seek(*in, seek_offset, SEEK_SET);
         if (seekret < 0) {
-            av_log(pls->parent, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", seg->url_offset, seg->url);
+            av_log(pls->parent, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", seek_offset, url);
             ret = seekret;
-            ffurl_close(pls->input);
-            pls->input = NULL;
+            ffurl_closep(in);
         }
     }
+    return ret;
+}
+
+static int open_input(HLSContext *c, struct playlist *pls)
+{
+    AVDictionary *opts = NULL;
+    char url[MAX_URL_SIZE];
+    int64_t seek_offset;
+    int ret;
+    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+
+    av_log(pls->parent, AV_LOG_VERBOSE, "HLS request for url '%s', offset %"PRId64", playlist %d\n",
+           seg->url, seg->url_offset, pls->index);
+
+    ret = prepare_segment_request(c, pls, seg, url, sizeof(url), &opts, &seek_offset);
+    if (ret == 0)
+        ret = open_segment_url(pls, &pls->input, url, &opts, seek_offset,
+                               &pls->parent->interrupt_callback);
 
-cleanup:
     av_dict_free(&opts);
-    av_dict_free(&opts2);
     pls->cur_seg_offset = 0;
     return ret;
 }
 
+#if HAVE_PTHREADS
+static int prefetch_interrupt_cb(void *opaque)
+{
+    struct playlist *pls = opaque;
+    return avpriv_atomic_int_get(&pls->prefetch_abort) ||
+           ff_check_interrupt(&pls->parent->interrupt_callback);
+}
+
+/*
+ * Open the segment of the job and read up to max_size bytes of it into
+ * memory. If the segment is larger, the connection is kept open for the
+ * demuxer to read the rest of it.
+ */
+static void run_segment_job(struct playlist *pls, struct segment_job *job,
+                            int max_size)
+{
+    job->ret = open_segment_url(pls, &job->input, job->url, &job->opts,
+                                job->seek_offset, &pls->prefetch_int_cb);
+    if (job->ret < 0)
+        return;
+
+    while (!avpriv_atomic_int_get(&pls->prefetch_abort)) {
+        int64_t left = max_size - job->buf_len;
+        int ret;
+
+        if (job->size >= 0)
+            left = FFMIN(left, job->size - job->buf_len);
+        if (left <= 0)
+            break;
+        if (job->buf_len == job->buf_size) {
+            int new_size = FFMIN(max_size, FFMAX(2 * job->buf_size, 65536));
+            uint8_t *buf = av_realloc(job->buf, new_size);
+            if (!buf)
+                break;
+            job->buf      = buf;
+            job->buf_size = new_size;
+        }
+        ret = ffurl_read(job->input, job->buf + job->buf_len,
+                         FFMIN(left, job->buf_size - job->buf_len));
+        if (ret <= 0) {
+            /* end of the segment, errors show up as a truncated segment
+             * just like without prefetching */
+            ffurl_closep(&job->input);
+            break;
+        }
+        job->buf_len += ret;
+    }
+    if (job->size >= 0 && job->buf_len >= job->size)
+        ffurl_closep(&job->input);
+}
+
+/* Download the queued segments of the playlist, in order. Each thread takes
+ * the first job nobody is working on yet. */
+static void *prefetch_thread(void *arg)
+{
+    struct playlist *pls = arg;
+    HLSContext *c = pls->parent->priv_data;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    while (!avpriv_atomic_int_get(&pls->prefetch_abort)) {
+        struct segment_job *job = NULL;
+        int i;
+
+        for (i = 0; i < pls->n_jobs; i++) {
+            if (!pls->jobs[i]->started) {
+                job = pls->jobs[i];
+                break;
+            }
+        }
+        if (!job) {
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+            continue;
+        }
+        job->started = 1;
+        pthread_mutex_unlock(&pls->prefetch_lock);
+
+        run_segment_job(pls, job, c->prefetch_buffer_size);
+
+        pthread_mutex_lock(&pls->prefetch_lock);
+        job->done = 1;
+        pthread_cond_broadcast(&pls->prefetch_cond);
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+    return NULL;
+}
+
+/* Start one thread per segment in flight: the current one and
+ * prefetch_segments ahead of it. */
+static int start_prefetch(HLSContext *c, struct playlist *pls)
+{
+    int nb_threads = c->prefetch_segments + 1;
+    int i, ret;
+
+    if (pls->nb_prefetch_threads)
+        return 0;
+
+    pls->prefetch_threads = av_malloc_array(nb_threads, sizeof(*pls->prefetch_threads));
+    if (!pls->prefetch_threads)
+        return AVERROR(ENOMEM);
+    pls->prefetch_abort = 0;
+    pls->prefetch_int_cb.callback = prefetch_interrupt_cb;
+    pls->prefetch_int_cb.opaque   = pls;
+    if ((ret = pthread_mutex_init(&pls->prefetch_lock, NULL))) {
+        av_freep(&pls->prefetch_threads);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pls->prefetch_cond, NULL))) {
+        pthread_mutex_destroy(&pls->prefetch_lock);
+        av_freep(&pls->prefetch_threads);
+        return AVERROR(ret);
+    }
+    for (i = 0; i < nb_threads; i++) {
+        ret = pthread_create(&pls->prefetch_threads[i], NULL, prefetch_thread, pls);
+        if (ret) {
+            av_log(pls->parent, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+            break;
+        }
+        pls->nb_prefetch_threads++;
+    }
+    if (!pls->nb_prefetch_threads) {
+        pthread_cond_destroy(&pls->prefetch_cond);
+        pthread_mutex_destroy(&pls->prefetch_lock);
+        av_freep(&pls->prefetch_threads);
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+/* Queue the segments from first_seq_no up to prefetch_segments ahead of the
+ * current one, which are not queued yet. */
+static void queue_segment_jobs(HLSContext *c, struct playlist *pls, int first_seq_no)
+{
+    int seq_no = first_seq_no;
+
+    if (pls->n_jobs)
+        seq_no = FFMAX(seq_no, pls->jobs[pls->n_jobs - 1]->seq_no + 1);
+    seq_no = FFMAX(seq_no, pls->start_seq_no);
+
+    if (start_prefetch(c, pls) < 0)
+        return;
+
+    for (; seq_no <= pls->cur_seq_no + c->prefetch_segments &&
+           seq_no <  pls->start_seq_no + pls->n_segments; seq_no++) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+        struct segment_job *job = av_mallocz(sizeof(*job));
+
+        if (!job)
+            return;
+        job->seq_no = seq_no;
+        job->size   = seg->size;
+        if (prepare_segment_request(c, pls, seg, job->url, sizeof(job->url),
+                                    &job->opts, &job->seek_offset) < 0) {
+            /* leave it to open_input() to report the error */
+            free_segment_job(&job);
+            return;
+        }
+        av_log(pls->parent, AV_LOG_VERBOSE, "HLS prefetch for url '%s', offset %"PRId64", playlist %d\n",
+               seg->url, seg->url_offset, pls->index);
+
+        pthread_mutex_lock(&pls->prefetch_lock);
+        if (av_dynarray_add_nofree(&pls->jobs, &pls->n_jobs, job) < 0) {
+            pthread_mutex_unlock(&pls->prefetch_lock);
+            free_segment_job(&job);
+            return;
+        }
+        pthread_cond_broadcast(&pls->prefetch_cond);
+        pthread_mutex_unlock(&pls->prefetch_lock);
+    }
+}
+
+/* Open the current segment from the prefetched data, and queue the next
+ * segments. */
+static int open_prefetched_input(HLSContext *c, struct playlist *pls)
+{
+    struct segment_job *job;
+    int ret;
+
+    /* the demuxer skipped segments, e.g. because they expired from a live
+     * playlist, so the prefetched ones are of no use */
+    if (pls->n_jobs && pls->jobs[0]->seq_no != pls->cur_seq_no)
+        stop_prefetch(pls);
+
+    queue_segment_jobs(c, pls, pls->cur_seq_no);
+    if (!pls->n_jobs || pls->jobs[0]->seq_no != pls->cur_seq_no)
+        return open_input(c, pls);
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    job = pls->jobs[0];
+    while (!job->done)
+        pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+    pls->n_jobs--;
+    memmove(pls->jobs, pls->jobs + 1, pls->n_jobs * sizeof(*pls->jobs));
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    queue_segment_jobs(c, pls, pls->cur_seq_no + 1);
+
+    pls->cur_seg_offset = 0;
+    ret = job->ret;
+    if (ret < 0) {
+        free_segment_job(&job);
+        return ret;
+    }
+    pls->input    = job->input;
+    job->input    = NULL;
+    pls->cur_job  = job;
+    return 0;
+}
+#endif
+
 static int64_t default_reload_interval(struct playlist *pls)
 {
     return pls->n_segments > 0 ?
@@ -1028,7 +1356,7 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input) {
+    if (!v->input && !v->cur_job) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1083,6 +1411,11 @@ reload:
             goto reload;
         }
 
+#if HAVE_PTHREADS
+        if (c->prefetch_segments > 0)
+            ret = open_prefetched_input(c, v);
+        else
+#endif
         ret = open_input(c, v);
         if (ret < 0) {
             av_log(v->parent, AV_LOG_WARNING, "Failed to open segment of playlist %d\n",
@@ -1103,8 +1436,7 @@ reload:
 
         return ret;
     }
-    ffurl_close(v->input);
-    v->input = NULL;
+    close_segment(v);
     v->cur_seq_no++;
 
     c->cur_seq_no = v->cur_seq_no;
@@ -1476,9 +1808,8 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             }
             av_log(s, AV_LOG_INFO, "Now receiving playlist %d, segment %d\n", i, pls->cur_seq_no);
         } else if (first && !pls->cur_needed && pls->needed) {
-            if (pls->input)
-                ffurl_close(pls->input);
-            pls->input = NULL;
+            stop_prefetch(pls);
+            close_segment(pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -1679,10 +2010,8 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
     for (i = 0; i < c->n_playlists; i++) {
         /* Reset reading */
         struct playlist *pls = c->playlists[i];
-        if (pls->input) {
-            ffurl_close(pls->input);
-            pls->input = NULL;
-        }
+        stop_prefetch(pls);
+        close_segment(pls);
         av_free_packet(&pls->pkt);
         reset_packet(&pls->pkt);
         pls->pb.eof_reached = 0;
@@ -1730,6 +2059,10 @@ static int hls_probe(AVProbeData *p)
 static const AVOption hls_options[] = {
     {"live_start_index", "segment index to start live streams at (negative values are from the end)",
         OFFSET(live_start_index), FF_OPT_TYPE_INT, {.i64 = -3}, INT_MIN, INT_MAX, FLAGS},
+    {"prefetch_segments", "number of segments to download ahead of the current one, in background threads",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 16, FLAGS},
+    {"prefetch_buffer_size", "maximum amount of data to prefetch per segment",
+        OFFSET(prefetch_buffer_size), AV_OPT_TYPE_INT, {.i64 = 4 << 20}, 4096, INT_MAX, FLAGS},
     {NULL}
 };
 
@@ -20,13 +20,18 @@
  */
 
 #include "config.h"
+#include <fcntl.h>
 #include <float.h>
 #include <stdint.h>
+#if HAVE_IO_H
+#include <io.h>
+#endif
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
 
 #include "libavutil/avassert.h"
+#include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/avstring.h"
@@ -84,6 +89,8 @@ typedef struct HLSContext {
     HLSSegment *segments;
     HLSSegment *last_segment;
     HLSSegment *old_segments;
+    HLSSegment *last_listed;    // last segment in the playlist file, if it can be appended to
+    int listed_target_duration; // target duration written in the playlist file
 
     char *basename;
     char *baseurl;
@@ -239,6 +246,66 @@ static void hls_free_segments(HLSSegment *p)
     }
 }
 
+static void hls_write_entries(HLSContext *hls, AVIOContext *out, HLSSegment *en)
+{
+    for (; en; en = en->next) {
+        if (hls->flags & HLS_ROUND_DURATIONS)
+            avio_printf(out, "#EXTINF:%d,\n",  (int)round(en->duration));
+        else
+            avio_printf(out, "#EXTINF:%f,\n", en->duration);
+        if (hls->flags & HLS_SINGLE_FILE)
+             avio_printf(out, "#EXT-X-BYTERANGE:%"PRIi64"@%"PRIi64"\n",
+                         en->size, en->pos);
+        if (hls->baseurl)
+            avio_printf(out, "%s", hls->baseurl);
+        avio_printf(out, "%s\n", en->filename);
+    }
+}
+
+/**
+ * Append the segments added since the last update to the playlist file,
+ * instead of rewriting all of it. The new lines are published by a single
+ * write to the file opened in append mode.
+ */
+static int hls_append_window(AVFormatContext *s, int last)
+{
+    HLSContext *hls = s->priv_data;
+    const char *filename = s->filename;
+    AVIOContext *out;
+    uint8_t *buf;
+    int fd, size, ret;
+
+    if ((ret = avio_open_dyn_buf(&out)) < 0)
+        return ret;
+    hls_write_entries(hls, out, hls->last_listed->next);
+    if (last && (hls->flags & HLS_OMIT_ENDLIST)==0)
+        avio_printf(out, "#EXT-X-ENDLIST\n");
+    size = avio_close_dyn_buf(out, &buf);
+    if (!buf)
+        return AVERROR(ENOMEM);
+
+    av_strstart(filename, "file:", &filename);
+    fd = avpriv_open(filename, O_WRONLY | O_APPEND);
+    if (fd < 0) {
+        ret = AVERROR(errno);
+    } else {
+        ret = write(fd, buf, size);
+        if (ret < 0)
+            ret = AVERROR(errno);
+        else if (ret != size)
+            ret = AVERROR(EIO);
+        close(fd);
+    }
+    av_free(buf);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "failed to append to the playlist %s, "
+               "rewriting it\n", filename);
+        return ret;
+    }
+    hls->last_listed = hls->last_segment;
+    return 0;
+}
+
 static int hls_window(AVFormatContext *s, int last)
 {
     HLSContext *hls = s->priv_data;
@@ -251,8 +318,23 @@ static int hls_window(AVFormatContext *s, int last)
     int version = hls->flags & HLS_SINGLE_FILE ? 4 : 3;
     const char *proto = avio_find_protocol_name(s->filename);
     int use_rename = proto && !strcmp(proto, "file");
+    int renamed = 0;
     static unsigned warned_non_file;
 
+    /* A playlist keeping all the segments only grows, so it is appended to
+     * as long as its target duration does not need to be updated. If that
+     * fails, e.g. because the file was removed, it is written again. */
+    if (hls->last_listed) {
+        target_duration = hls->listed_target_duration;
+        for (en = hls->last_listed->next; en; en = en->next) {
+            if (target_duration < en->duration)
+                target_duration = ceil(en->duration);
+        }
+        if (target_duration == hls->listed_target_duration &&
+            hls_append_window(s, last) >= 0)
+            return 0;
+    }
+
     if (!use_rename && !warned_non_file++)
         av_log(s, AV_LOG_ERROR, "Cannot use rename on non file protocol, this may lead to races and temporarly partial files\n");
 
@@ -281,18 +363,7 @@ static int hls_window(AVFormatContext *s, int last)
         avio_printf(out, "#EXT-X-DISCONTINUITY\n");
         hls->discontinuity_set = 1;
     }
-    for (en = hls->segments; en; en = en->next) {
-        if (hls->flags & HLS_ROUND_DURATIONS)
-            avio_printf(out, "#EXTINF:%d,\n",  (int)round(en->duration));
-        else
-            avio_printf(out, "#EXTINF:%f,\n", en->duration);
-        if (hls->flags & HLS_SINGLE_FILE)
-             avio_printf(out, "#EXT-X-BYTERANGE:%"PRIi64"@%"PRIi64"\n",
-                         en->size, en->pos);
-        if (hls->baseurl)
-            avio_printf(out, "%s", hls->baseurl);
-        avio_printf(out, "%s\n", en->filename);
-    }
+    hls_write_entries(hls, out, hls->segments);
 
     if (last && (hls->flags & HLS_OMIT_ENDLIST)==0)
         avio_printf(out, "#EXT-X-ENDLIST\n");
@@ -300,7 +371,11 @@ static int hls_window(AVFormatContext *s, int last)
 fail:
     avio_closep(&out);
     if (ret >= 0 && use_rename)
-        ff_rename(temp_filename, s->filename, s);
+        renamed = ff_rename(temp_filename, s->filename, s) >= 0;
+    if (renamed && !hls->max_nb_segments && hls->last_segment) {
+        hls->last_listed            = hls->last_segment;
+        hls->listed_target_duration = target_duration;
+    }
     return ret;
 }
 
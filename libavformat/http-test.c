@@ -0,0 +1,124 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Test of the reuse_connections option of the http protocol: a server
+ * accepting a single connection answers several requests made by opening
+ * and closing the http protocol, which only works if the client reuses the
+ * connection.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "url.h"
+
+#define NB_REQUESTS 3
+
+static int port = 12411;
+
+static void *server(void *arg)
+{
+    URLContext *c = NULL;
+    char url[64], req[4096];
+    int nb_requests = 0, len = 0, ret;
+
+    snprintf(url, sizeof(url), "tcp://127.0.0.1:%d?listen&listen_timeout=10000", port);
+    if ((ret = ffurl_open(&c, url, AVIO_FLAG_READ_WRITE, NULL, NULL)) < 0) {
+        printf("server: cannot listen: %s\n", av_err2str(ret));
+        return NULL;
+    }
+
+    for (;;) {
+        static const char reply[] = "HTTP/1.1 200 OK\r\n"
+                                    "Content-Length: 6\r\n"
+                                    "\r\n"
+                                    "hello\n";
+        char *end;
+
+        ret = ffurl_read(c, req + len, sizeof(req) - 1 - len);
+        if (ret <= 0)
+            break;
+        len += ret;
+        req[len] = 0;
+        while ((end = strstr(req, "\r\n\r\n"))) {
+            printf("server: request %d on connection 1: %.*s\n",
+                   ++nb_requests, (int)strcspn(req, "\r"), req);
+            ffurl_write(c, reply, sizeof(reply) - 1);
+            end += 4;
+            len -= end - req;
+            memmove(req, end, len + 1);
+        }
+    }
+    printf("server: connection closed by the client\n");
+    ffurl_close(c);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    pthread_t thread;
+    int i, ret;
+
+    if (argc > 1)
+        port = atoi(argv[1]);
+
+    av_log_set_level(AV_LOG_FATAL);
+    av_register_all();
+    avformat_network_init();
+
+    if (pthread_create(&thread, NULL, server, NULL))
+        return 1;
+
+    for (i = 0; i < NB_REQUESTS; i++) {
+        AVIOContext *pb = NULL;
+        AVDictionary *opts = NULL;
+        char url[64], buf[64];
+        int tries = 0;
+
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/%d", port, i);
+        do {
+            av_dict_set(&opts, "reuse_connections", "1", 0);
+            ret = avio_open2(&pb, url, AVIO_FLAG_READ, NULL, &opts);
+            av_dict_free(&opts);
+            /* give the server time to start listening */
+            if (ret < 0 && !i && tries++ < 100)
+                av_usleep(20000);
+            else
+                break;
+        } while (1);
+        if (ret < 0) {
+            printf("client: cannot open %s: %s\n", url, av_err2str(ret));
+            break;
+        }
+        ret = avio_read(pb, buf, sizeof(buf) - 1);
+        buf[FFMAX(ret, 0)] = 0;
+        printf("client: reply %d: %s", i + 1, buf);
+        avio_closep(&pb);
+    }
+
+    /* closes the pooled connection, which ends the server */
+    avformat_network_deinit();
+    pthread_join(thread, NULL);
+    return 0;
+}
@@ -27,6 +27,7 @@
 
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -36,6 +37,10 @@
 #include "os_support.h"
 #include "url.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 /* XXX: POST protocol is not completely implemented because ffmpeg uses
  * only a subset of it. */
 
@@ -44,16 +49,25 @@
  * path names). */
 #define BUFFER_SIZE   MAX_URL_SIZE
 #define MAX_REDIRECTS 8
+#define POOL_SIZE     32
 
 typedef struct HTTPContext {
     const AVClass *class;
     URLContext *hd;
+    /* Interrupt callback the lower protocol of hd calls through. It is
+     * changed to the one of the current owner when hd is reused from the
+     * connection pool. */
+    AVIOInterruptCB *hd_int_cb;
     unsigned char buffer[BUFFER_SIZE], *buf_ptr, *buf_end;
     int line_count;
     int http_code;
     /* Used if "Transfer-Encoding: chunked" otherwise -1. */
     int64_t chunksize;
     int64_t off, end_off, filesize;
+    /* Content-Length of the reply, and offset of the end of its body, or -1. */
+    int64_t content_length, body_end;
+    /* A flag which indicates the last chunk of a chunked reply has been read. */
+    int end_chunked_reply;
     char *location;
     HTTPAuthState auth_state;
     HTTPAuthState proxy_auth_state;
@@ -97,6 +111,8 @@ typedef struct HTTPContext {
     char *method;
     int reconnect;
     int listen;
+    int reuse_connections;
+    int idle_timeout;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -129,6 +145,8 @@ static const AVOption options[] = {
     { "method", "Override the HTTP method", OFFSET(method), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reconnect", "auto reconnect after disconnect before EOF", OFFSET(reconnect), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D },
     { "listen", "listen on HTTP", OFFSET(listen), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D | E },
+    { "reuse_connections", "reuse idle connections to the same server across requests", OFFSET(reuse_connections), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D },
+    { "idle_timeout", "close idle reusable connections after this many seconds", OFFSET(idle_timeout), AV_OPT_TYPE_INT, { .i64 = 5 }, 0, INT_MAX, D },
     { NULL }
 };
 
@@ -137,6 +155,214 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                         const char *proxyauth, int *new_location);
 static int http_read_header(URLContext *h, int *new_location);
 
+#if HAVE_PTHREADS
+/*
+ * Process-wide pool of idle connections, keyed by the URL of the lower
+ * protocol (tcp://host:port or tls://host:port, or the proxy for proxied
+ * requests) and the options it is opened with. A connection goes back to
+ * the pool when the reply to a GET request has been read completely and the
+ * server did not ask to close it.
+ */
+typedef struct HTTPPoolEntry {
+    char key[1024];
+    URLContext *hd;
+    AVIOInterruptCB *int_cb;
+    int64_t expiry;
+} HTTPPoolEntry;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static HTTPPoolEntry pool[POOL_SIZE];
+static int pool_nb;
+
+/* Remove the expired entries, they are moved to expired for the caller to
+ * close outside of the lock. Must be called with pool_lock held. */
+static int pool_purge(HTTPPoolEntry *expired, int64_t now)
+{
+    int i, nb_expired = 0;
+
+    for (i = 0; i < pool_nb; i++) {
+        if (pool[i].expiry <= now) {
+            expired[nb_expired++] = pool[i];
+            pool[i--] = pool[--pool_nb];
+        }
+    }
+    return nb_expired;
+}
+
+static void pool_close_entries(HTTPPoolEntry *entries, int nb)
+{
+    int i;
+
+    for (i = 0; i < nb; i++) {
+        ffurl_closep(&entries[i].hd);
+        av_freep(&entries[i].int_cb);
+    }
+}
+
+/* Take an idle connection to key out of the pool, most recently used first. */
+static int pool_get(const char *key, URLContext **hd, AVIOInterruptCB **int_cb)
+{
+    HTTPPoolEntry expired[POOL_SIZE];
+    int i, nb_expired, found = -1;
+
+    pthread_mutex_lock(&pool_lock);
+    nb_expired = pool_purge(expired, av_gettime_relative());
+    for (i = 0; i < pool_nb; i++)
+        if (!strcmp(pool[i].key, key) &&
+            (found < 0 || pool[i].expiry > pool[found].expiry))
+            found = i;
+    if (found >= 0) {
+        *hd     = pool[found].hd;
+        *int_cb = pool[found].int_cb;
+        pool[found] = pool[--pool_nb];
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    pool_close_entries(expired, nb_expired);
+    return found >= 0;
+}
+
+/* Put an idle connection into the pool, evicting the one closest to
+ * expiring if the pool is full. */
+static void pool_put(const char *key, URLContext *hd, AVIOInterruptCB *int_cb,
+                     int64_t expiry)
+{
+    HTTPPoolEntry expired[POOL_SIZE + 1];
+    int i, nb_expired;
+
+    pthread_mutex_lock(&pool_lock);
+    nb_expired = pool_purge(expired, av_gettime_relative());
+    if (pool_nb == POOL_SIZE) {
+        int oldest = 0;
+        for (i = 1; i < pool_nb; i++)
+            if (pool[i].expiry < pool[oldest].expiry)
+                oldest = i;
+        expired[nb_expired++] = pool[oldest];
+        pool[oldest] = pool[--pool_nb];
+    }
+    av_strlcpy(pool[pool_nb].key, key, sizeof(pool[pool_nb].key));
+    pool[pool_nb].hd     = hd;
+    pool[pool_nb].int_cb = int_cb;
+    pool[pool_nb].expiry = expiry;
+    pool_nb++;
+    pthread_mutex_unlock(&pool_lock);
+
+    pool_close_entries(expired, nb_expired);
+}
+#endif /* HAVE_PTHREADS */
+
+void ff_http_close_pool(void)
+{
+#if HAVE_PTHREADS
+    HTTPPoolEntry entries[POOL_SIZE];
+    int nb;
+
+    pthread_mutex_lock(&pool_lock);
+    nb = pool_nb;
+    memcpy(entries, pool, nb * sizeof(*pool));
+    pool_nb = 0;
+    pthread_mutex_unlock(&pool_lock);
+
+    pool_close_entries(entries, nb);
+#endif
+}
+
+/* Build the pool key of a connection to url, so that connections are only
+ * shared between requests with the same lower protocol and socket options,
+ * e.g. the same TLS verification settings or timeouts. */
+static int get_pool_key(HTTPContext *s, const char *url, char *key, int key_size)
+{
+    char *opts = NULL;
+    int ret;
+
+    if ((ret = av_dict_get_string(s->chained_options, &opts, '=', '&')) < 0)
+        return ret;
+    ret = snprintf(key, key_size, "%s?%s", url, opts);
+    av_free(opts);
+    return ret >= key_size ? AVERROR(ENOSPC) : 0;
+}
+
+static int hd_interrupt_cb(void *opaque)
+{
+    return ff_check_interrupt(opaque);
+}
+
+static void close_hd(URLContext **hd, AVIOInterruptCB **int_cb)
+{
+    ffurl_closep(hd);
+    av_freep(int_cb);
+}
+
+/* Whether the current request allows putting the connection in the pool
+ * once its reply has been read. */
+static int can_reuse_connection(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    return HAVE_PTHREADS && s->reuse_connections && !s->listen &&
+           !(h->flags & AVIO_FLAG_WRITE) && !s->post_data &&
+           (!s->method || !strcmp(s->method, "GET"));
+}
+
+/* Return the connection to the pool, if the reply has been read completely.
+ * hd is closed otherwise. */
+static void release_hd(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+#if HAVE_PTHREADS
+    char key[sizeof(pool[0].key)];
+
+    if (s->hd && s->hd_int_cb && can_reuse_connection(h) &&
+        s->end_header && !s->willclose &&
+        s->http_code >= 200 && s->http_code < 300 &&
+        s->buf_ptr == s->buf_end &&
+        (s->end_chunked_reply || (s->body_end >= 0 && s->off == s->body_end)) &&
+        get_pool_key(s, s->hd->filename, key, sizeof(key)) >= 0) {
+        *s->hd_int_cb = (AVIOInterruptCB){ NULL };
+        pool_put(key, s->hd, s->hd_int_cb,
+                 av_gettime_relative() + s->idle_timeout * 1000000LL);
+        s->hd        = NULL;
+        s->hd_int_cb = NULL;
+        return;
+    }
+#endif
+    close_hd(&s->hd, &s->hd_int_cb);
+}
+
+/* Open the connection to the lower protocol, or take an idle one from
+ * the pool. Return 1 if the connection was reused. */
+static int open_hd(URLContext *h, const char *url, AVDictionary **options)
+{
+    HTTPContext *s = h->priv_data;
+    AVIOInterruptCB cb;
+    int err;
+#if HAVE_PTHREADS
+    char key[sizeof(pool[0].key)];
+
+    if (can_reuse_connection(h) &&
+        get_pool_key(s, url, key, sizeof(key)) >= 0 &&
+        pool_get(key, &s->hd, &s->hd_int_cb)) {
+        *s->hd_int_cb = h->interrupt_callback;
+        av_log(h, AV_LOG_DEBUG, "Reusing connection to %s\n", url);
+        return 1;
+    }
+#endif
+    if (!can_reuse_connection(h))
+        return ffurl_open(&s->hd, url, AVIO_FLAG_READ_WRITE,
+                          &h->interrupt_callback, options);
+
+    s->hd_int_cb = av_malloc(sizeof(*s->hd_int_cb));
+    if (!s->hd_int_cb)
+        return AVERROR(ENOMEM);
+    *s->hd_int_cb = h->interrupt_callback;
+    cb.callback = hd_interrupt_cb;
+    cb.opaque   = s->hd_int_cb;
+    err = ffurl_open(&s->hd, url, AVIO_FLAG_READ_WRITE, &cb, options);
+    if (err < 0)
+        av_freep(&s->hd_int_cb);
+    return err;
+}
+
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
 {
     memcpy(&((HTTPContext *)dest->priv_data)->auth_state,
@@ -154,7 +380,7 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err, location_changed = 0;
+    int port, use_proxy, err, location_changed = 0, reused = 0;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -193,14 +419,25 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
-        err = ffurl_open(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                         &h->interrupt_callback, options);
+        err = open_hd(h, buf, options);
         if (err < 0)
             return err;
+        reused = err;
     }
 
+    s->line_count = 0;
+
     err = http_connect(h, path, local_path, hoststr,
                        auth, proxyauth, &location_changed);
+    if (err < 0 && reused && !s->line_count) {
+        /* The server closed the idle connection in the meantime. */
+        av_log(h, AV_LOG_DEBUG, "Reused connection failed, reconnecting\n");
+        close_hd(&s->hd, &s->hd_int_cb);
+        if ((err = open_hd(h, buf, options)) < 0)
+            return err;
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
+    }
     if (err < 0)
         return err;
 
@@ -227,7 +464,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            close_hd(&s->hd, &s->hd_int_cb);
             goto redo;
         } else
             goto fail;
@@ -235,7 +472,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            close_hd(&s->hd, &s->hd_int_cb);
             goto redo;
         } else
             goto fail;
@@ -244,7 +481,7 @@ redo:
          s->http_code == 303 || s->http_code == 307) &&
         location_changed == 1) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        close_hd(&s->hd, &s->hd_int_cb);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
         /* Restart the authentication process with the new target, which
@@ -257,8 +494,7 @@ redo:
     return 0;
 
 fail:
-    if (s->hd)
-        ffurl_closep(&s->hd);
+    close_hd(&s->hd, &s->hd_int_cb);
     if (location_changed < 0)
         return location_changed;
     return ff_http_averror(s->http_code, AVERROR(EIO));
@@ -581,8 +817,10 @@ static int process_line(URLContext *h, char *line, int line_count,
             if ((ret = parse_location(s, p)) < 0)
                 return ret;
             *new_location = 1;
-        } else if (!av_strcasecmp(tag, "Content-Length") && s->filesize == -1) {
-            s->filesize = strtoll(p, NULL, 10);
+        } else if (!av_strcasecmp(tag, "Content-Length")) {
+            s->content_length = strtoll(p, NULL, 10);
+            if (s->filesize == -1)
+                s->filesize = s->content_length;
         } else if (!av_strcasecmp(tag, "Content-Range")) {
             parse_content_range(h, p);
         } else if (!av_strcasecmp(tag, "Accept-Ranges") &&
@@ -745,7 +983,10 @@ static int http_read_header(URLContext *h, int *new_location)
     char line[MAX_URL_SIZE];
     int err = 0;
 
-    s->chunksize = -1;
+    s->chunksize         = -1;
+    s->content_length    = -1;
+    s->body_end          = -1;
+    s->end_chunked_reply = 0;
 
     for (;;) {
         if ((err = http_get_line(s, line, sizeof(line))) < 0)
@@ -764,6 +1005,9 @@ static int http_read_header(URLContext *h, int *new_location)
     if (s->seekable == -1 && s->is_mediagateway && s->filesize == 2000000000)
         h->is_streamed = 1; /* we can in fact _not_ seek */
 
+    if (s->chunksize < 0 && s->content_length >= 0)
+        s->body_end = s->off + s->content_length;
+
     // add any new cookies into the existing cookie string
     cookie_string(s->cookie_dict, &s->cookies);
     av_dict_free(&s->cookie_dict);
@@ -839,7 +1083,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                            "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: ")) {
-        if (s->multiple_requests)
+        if (s->multiple_requests || can_reuse_connection(h))
             len += av_strlcpy(headers + len, "Connection: keep-alive\r\n",
                               sizeof(headers) - len);
         else
@@ -945,6 +1189,12 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
         if ((!s->willclose || s->chunksize < 0) &&
             s->filesize >= 0 && s->off >= s->filesize)
             return AVERROR_EOF;
+        /* Do not read into the next reply on a persistent connection. */
+        if (s->body_end >= 0) {
+            if (s->off >= s->body_end)
+                return AVERROR_EOF;
+            size = FFMIN(size, s->body_end - s->off);
+        }
         len = ffurl_read(s->hd, buf, size);
         if (!len && (!s->willclose || s->chunksize < 0) &&
             s->filesize >= 0 && s->off < s->filesize) {
@@ -1013,6 +1263,8 @@ static int http_read_stream(URLContext *h, uint8_t *buf, int size)
     }
 
     if (s->chunksize >= 0) {
+        if (s->end_chunked_reply)
+            return 0;
         if (!s->chunksize) {
             char line[32];
 
@@ -1026,8 +1278,15 @@ static int http_read_stream(URLContext *h, uint8_t *buf, int size)
                 av_log(NULL, AV_LOG_TRACE, "Chunked encoding data size: %"PRId64"'\n",
                         s->chunksize);
 
-                if (!s->chunksize)
+                if (!s->chunksize) {
+                    /* skip the trailer, up to the empty line ending it */
+                    do {
+                        if ((err = http_get_line(s, line, sizeof(line))) < 0)
+                            return err;
+                    } while (*line);
+                    s->end_chunked_reply = 1;
                     return 0;
+                }
         }
         size = FFMIN(size, s->chunksize);
     }
@@ -1200,8 +1459,7 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
-    if (s->hd)
-        ffurl_closep(&s->hd);
+    release_hd(h);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -1210,7 +1468,8 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
-    int64_t old_off = s->off;
+    AVIOInterruptCB *old_hd_int_cb = s->hd_int_cb;
+    int64_t old_off = s->off, old_body_end = s->body_end;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
     AVDictionary *options = NULL;
@@ -1237,7 +1496,8 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd        = NULL;
+    s->hd_int_cb = NULL;
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
@@ -1245,12 +1505,14 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         memcpy(s->buffer, old_buf, old_buf_size);
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
-        s->hd      = old_hd;
-        s->off     = old_off;
+        s->hd        = old_hd;
+        s->hd_int_cb = old_hd_int_cb;
+        s->off       = old_off;
+        s->body_end  = old_body_end;
         return ret;
     }
     av_dict_free(&options);
-    ffurl_close(old_hd);
+    close_hd(&old_hd, &old_hd_int_cb);
     return off;
 }
 
@@ -0,0 +1,347 @@
+/*
+ * Stream information cache
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Cache of the results of avformat_find_stream_info().
+ *
+ * The cache is a directory holding one file per input URL. A file starts
+ * with a key identifying the input: its URL, size, MD5 of its first and
+ * last bytes, and the streams found by the demuxer when reading the header.
+ * It is followed by the stream parameters found by the analysis. An entry
+ * whose key does not match the input being opened is ignored and replaced
+ * after the analysis. The whole file is protected by an MD5, so that a
+ * truncated or concurrently written file is ignored too.
+ */
+
+#include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/md5.h"
+#include "libavcodec/bytestream.h"
+#include "avformat.h"
+#include "avio_internal.h"
+#include "internal.h"
+
+#define CACHE_MAGIC    MKBETAG('F', 'F', 'S', 'I')
+#define CACHE_VERSION  1
+#define CACHE_MAX_SIZE (16 << 20)
+/* number of bytes hashed at the start and at the end of the input */
+#define HASH_SIZE      (64 * 1024)
+
+typedef struct CacheField {
+    int offset;
+    int size;
+} CacheField;
+
+#define FIELD(type, x) { offsetof(type, x), sizeof(((type *)0)->x) }
+#define CTX(x)         FIELD(AVFormatContext, x)
+#define STREAM(x)      FIELD(AVStream, x)
+#define CODEC(x)       FIELD(AVCodecContext, x)
+
+static const CacheField ctx_fields[] = {
+    CTX(start_time), CTX(duration), CTX(bit_rate), CTX(duration_estimation_method),
+};
+
+static const CacheField stream_fields[] = {
+    STREAM(time_base.num), STREAM(time_base.den),
+    STREAM(start_time), STREAM(duration), STREAM(nb_frames),
+    STREAM(disposition),
+    STREAM(sample_aspect_ratio.num), STREAM(sample_aspect_ratio.den),
+    STREAM(avg_frame_rate.num), STREAM(avg_frame_rate.den),
+    STREAM(r_frame_rate.num), STREAM(r_frame_rate.den),
+    STREAM(codec_info_nb_frames),
+};
+
+static const CacheField codec_fields[] = {
+    CODEC(codec_id), CODEC(codec_tag), CODEC(bit_rate), CODEC(profile), CODEC(level),
+    CODEC(rc_max_rate), CODEC(rc_buffer_size), CODEC(timecode_frame_start),
+    CODEC(time_base.num), CODEC(time_base.den), CODEC(ticks_per_frame), CODEC(delay),
+    CODEC(width), CODEC(height), CODEC(coded_width), CODEC(coded_height),
+    CODEC(pix_fmt), CODEC(has_b_frames), CODEC(refs),
+    CODEC(sample_aspect_ratio.num), CODEC(sample_aspect_ratio.den),
+    CODEC(field_order), CODEC(color_range), CODEC(color_primaries),
+    CODEC(color_trc), CODEC(colorspace), CODEC(chroma_sample_location),
+    CODEC(bits_per_coded_sample), CODEC(bits_per_raw_sample),
+    CODEC(sample_rate), CODEC(channels), CODEC(channel_layout), CODEC(sample_fmt),
+    CODEC(frame_size), CODEC(block_align), CODEC(initial_padding),
+    CODEC(audio_service_type),
+};
+
+static void write_fields(AVIOContext *pb, const void *obj,
+                         const CacheField *fields, int nb_fields)
+{
+    int i;
+
+    for (i = 0; i < nb_fields; i++) {
+        const uint8_t *p = (const uint8_t *)obj + fields[i].offset;
+        av_assert0(fields[i].size == 4 || fields[i].size == 8);
+        if (fields[i].size == 8)
+            avio_wb64(pb, *(const int64_t *)p);
+        else
+            avio_wb32(pb, *(const int32_t *)p);
+    }
+}
+
+static void read_fields(GetByteContext *gb, void *obj,
+                        const CacheField *fields, int nb_fields)
+{
+    int i;
+
+    for (i = 0; i < nb_fields; i++) {
+        uint8_t *p = (uint8_t *)obj + fields[i].offset;
+        if (fields[i].size == 8)
+            *(int64_t *)p = bytestream2_get_be64(gb);
+        else
+            *(int32_t *)p = bytestream2_get_be32(gb);
+    }
+}
+
+static int hash_range(AVIOContext *pb, uint8_t *buf, int64_t pos, int size,
+                      AVBPrint *bp, const char *name)
+{
+    uint8_t md5[16];
+    char hex[33];
+    int ret;
+
+    if ((ret = avio_seek(pb, pos, SEEK_SET)) < 0)
+        return ret;
+    if ((ret = avio_read(pb, buf, size)) != size)
+        return ret < 0 ? ret : AVERROR(EIO);
+    av_md5_sum(md5, buf, size);
+    ff_data_to_hex(hex, md5, sizeof(md5), 1);
+    hex[32] = 0;
+    av_bprintf(bp, "%s=%s\n", name, hex);
+    return 0;
+}
+
+/* Build the string identifying the input and the result of its header
+ * parsing. Return 0 if the input cannot be cached. */
+static int make_key(AVFormatContext *s, AVBPrint *bp)
+{
+    AVIOContext *pb = s->pb;
+    int64_t size, pos = avio_tell(pb);
+    int hash_size, ret, i;
+    uint8_t *buf;
+
+    if (!pb->seekable || (size = avio_size(pb)) <= 0)
+        return 0;
+    hash_size = FFMIN(size, HASH_SIZE);
+    if (!(buf = av_malloc(hash_size)))
+        return AVERROR(ENOMEM);
+
+    av_bprintf(bp, "url=%s\nsize=%"PRId64"\n", s->filename, size);
+    ret = hash_range(pb, buf, 0, hash_size, bp, "head");
+    if (ret >= 0)
+        ret = hash_range(pb, buf, size - hash_size, hash_size, bp, "tail");
+    av_free(buf);
+    if (avio_seek(pb, pos, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    if (ret < 0)
+        return 0;
+
+    av_bprintf(bp, "format=%s\nctx_flags=%d\nstreams=%d\n",
+               s->iformat->name, s->ctx_flags, s->nb_streams);
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        av_bprintf(bp, "stream=%d,%d,%d,%u\n", st->id, st->codec->codec_type,
+                   st->codec->codec_id, st->codec->codec_tag);
+    }
+    return av_bprint_is_complete(bp) ? 1 : AVERROR(ENOMEM);
+}
+
+static char *cache_path(AVFormatContext *s)
+{
+    uint8_t md5[16];
+    char hex[33];
+
+    av_md5_sum(md5, s->filename, strlen(s->filename));
+    ff_data_to_hex(hex, md5, sizeof(md5), 1);
+    hex[32] = 0;
+    return av_asprintf("%s/%s.ffsi", s->stream_info_cache, hex);
+}
+
+static int read_cache_file(AVFormatContext *s, const char *path,
+                           uint8_t **data, int *size)
+{
+    AVIOContext *pb;
+    int64_t file_size;
+    int ret;
+
+    *data = NULL;
+    if ((ret = avio_open2(&pb, path, AVIO_FLAG_READ,
+                          &s->interrupt_callback, NULL)) < 0)
+        return ret;
+    file_size = avio_size(pb);
+    if (file_size < 24 || file_size > CACHE_MAX_SIZE) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    if (!(*data = av_malloc(file_size))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = avio_read(pb, *data, file_size)) != file_size) {
+        av_freep(data);
+        ret = ret < 0 ? ret : AVERROR_INVALIDDATA;
+        goto end;
+    }
+    *size = file_size;
+    ret   = 0;
+end:
+    avio_close(pb);
+    return ret;
+}
+
+static int apply_cache(AVFormatContext *s, GetByteContext *gb)
+{
+    int i, ret;
+
+    read_fields(gb, s, ctx_fields, FF_ARRAY_ELEMS(ctx_fields));
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        int extradata_size;
+
+        read_fields(gb, st, stream_fields, FF_ARRAY_ELEMS(stream_fields));
+        read_fields(gb, st->codec, codec_fields, FF_ARRAY_ELEMS(codec_fields));
+
+        extradata_size = bytestream2_get_be32(gb);
+        if (extradata_size < 0 ||
+            extradata_size > bytestream2_get_bytes_left(gb))
+            return AVERROR_INVALIDDATA;
+        av_freep(&st->codec->extradata);
+        st->codec->extradata_size = 0;
+        if (extradata_size) {
+            if ((ret = ff_alloc_extradata(st->codec, extradata_size)) < 0)
+                return ret;
+            bytestream2_get_buffer(gb, st->codec->extradata, extradata_size);
+        }
+    }
+    return 0;
+}
+
+int ff_stream_info_cache_load(AVFormatContext *s, char **key)
+{
+    AVBPrint bp;
+    GetByteContext gb;
+    uint8_t *data = NULL, md5[16], sum[16];
+    char *path = NULL;
+    int size, key_len, ret;
+
+    *key = NULL;
+    /* Streams of demuxers without a header are only created while reading
+     * packets, the cache could not restore them. */
+    if (!s->pb || (s->iformat->flags & AVFMT_NOFILE) ||
+        (s->ctx_flags & AVFMTCTX_NOHEADER))
+        return 0;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    if ((ret = make_key(s, &bp)) <= 0) {
+        av_bprint_finalize(&bp, NULL);
+        return ret;
+    }
+    if ((ret = av_bprint_finalize(&bp, key)) < 0)
+        return ret;
+
+    if (!(path = cache_path(s)))
+        return AVERROR(ENOMEM);
+    if (read_cache_file(s, path, &data, &size) < 0) {
+        av_log(s, AV_LOG_DEBUG, "No stream info cache entry in %s\n", path);
+        ret = 0;
+        goto end;
+    }
+
+    ret = 0;
+    bytestream2_init(&gb, data, size);
+    if (bytestream2_get_be32(&gb) != CACHE_MAGIC ||
+        bytestream2_get_be32(&gb) != CACHE_VERSION)
+        goto invalid;
+    bytestream2_get_buffer(&gb, sum, sizeof(sum));
+    av_md5_sum(md5, gb.buffer, bytestream2_get_bytes_left(&gb));
+    if (memcmp(sum, md5, sizeof(md5)))
+        goto invalid;
+    key_len = bytestream2_get_be32(&gb);
+    if (key_len != strlen(*key) || bytestream2_get_bytes_left(&gb) < key_len ||
+        memcmp(gb.buffer, *key, key_len)) {
+        av_log(s, AV_LOG_VERBOSE, "Stream info cache entry %s is stale\n", path);
+        goto end;
+    }
+    bytestream2_skip(&gb, key_len);
+
+    if ((ret = apply_cache(s, &gb)) < 0)
+        goto end;
+    av_log(s, AV_LOG_VERBOSE, "Stream info loaded from cache entry %s\n", path);
+    ret = 1;
+    goto end;
+
+invalid:
+    av_log(s, AV_LOG_WARNING, "Ignoring invalid stream info cache entry %s\n", path);
+end:
+    av_free(data);
+    av_free(path);
+    return ret;
+}
+
+int ff_stream_info_cache_save(AVFormatContext *s, const char *key)
+{
+    AVIOContext *dyn = NULL, *pb = NULL;
+    uint8_t *payload = NULL, md5[16];
+    char *path = NULL;
+    int payload_size, i, ret;
+
+    if ((ret = avio_open_dyn_buf(&dyn)) < 0)
+        return ret;
+    avio_wb32(dyn, strlen(key));
+    avio_write(dyn, key, strlen(key));
+    write_fields(dyn, s, ctx_fields, FF_ARRAY_ELEMS(ctx_fields));
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        write_fields(dyn, st, stream_fields, FF_ARRAY_ELEMS(stream_fields));
+        write_fields(dyn, st->codec, codec_fields, FF_ARRAY_ELEMS(codec_fields));
+        avio_wb32(dyn, st->codec->extradata_size);
+        avio_write(dyn, st->codec->extradata, st->codec->extradata_size);
+    }
+    payload_size = avio_close_dyn_buf(dyn, &payload);
+    if (!payload)
+        return AVERROR(ENOMEM);
+    av_md5_sum(md5, payload, payload_size);
+
+    if (!(path = cache_path(s))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = avio_open2(&pb, path, AVIO_FLAG_WRITE,
+                          &s->interrupt_callback, NULL)) < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not write stream info cache entry %s: %s\n",
+               path, av_err2str(ret));
+        goto end;
+    }
+    avio_wb32(pb, CACHE_MAGIC);
+    avio_wb32(pb, CACHE_VERSION);
+    avio_write(pb, md5, sizeof(md5));
+    avio_write(pb, payload, payload_size);
+    ret = avio_closep(&pb);
+    av_log(s, AV_LOG_VERBOSE, "Stream info saved to cache entry %s\n", path);
+
+end:
+    av_free(payload);
+    av_free(path);
+    return ret;
+}
@@ -99,6 +99,23 @@ struct AVFormatInternal {
     int inject_global_side_data;
 
     int avoid_negative_ts_use_pts;
+
+    /**
+     * Per-stream packet queues of ff_interleave_packet_per_dts(), indexed
+     * by stream index, and a min-heap of the indices of the non-empty
+     * queues ordered by the dts of their first packet.
+     * Muxing only.
+     */
+    struct InterleaveQueue *interleave_queues;
+    int nb_interleave_queues;
+    int *interleave_heap;
+    int interleave_heap_size;
+
+    /**
+     * Packet list entries released by the interleaver, reused for the
+     * next packets instead of being freed.
+     */
+    struct AVPacketList *interleave_free_list;
 };
 
 #ifdef __GNUC__
@@ -356,6 +373,18 @@ int ff_framehash_write_header(AVFormatContext *s);
  */
 int ff_read_packet(AVFormatContext *s, AVPacket *pkt);
 
+/**
+ * Like av_get_packet(), but return the data as a reference into memory
+ * owned by the protocol when possible, e.g. with the mmap option of the file
+ * protocol, instead of copying it.
+ *
+ * The packet data may then be read-only, and its padding is made of the
+ * following bytes of the file instead of zeros, as for a packet cut out of
+ * a larger buffer. Only use it in demuxers which return the data read as
+ * is and never write to it.
+ */
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size);
+
 /**
  * Interleave a packet per dts in an output media file.
  *
@@ -374,6 +403,12 @@ int ff_read_packet(AVFormatContext *s, AVPacket *pkt);
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                  AVPacket *pkt, int flush);
 
+/**
+ * Free the packets still queued by ff_interleave_packet_per_dts() and the
+ * interleaver state.
+ */
+void ff_interleave_queues_free(AVFormatContext *s);
+
 void ff_free_stream(AVFormatContext *s, AVStream *st);
 
 /**
@@ -495,4 +530,24 @@ int ff_copy_whitelists(AVFormatContext *dst, AVFormatContext *src);
 int ffio_open2_wrapper(struct AVFormatContext *s, AVIOContext **pb, const char *url, int flags,
                        const AVIOInterruptCB *int_cb, AVDictionary **options);
 
+/**
+ * Load the stream parameters of s from its entry in the stream info cache
+ * directory, if the entry matches the input and the streams found when
+ * reading its header. Inputs without a header (AVFMTCTX_NOHEADER) are not
+ * cached.
+ *
+ * @param key set to the key identifying the input, to pass to
+ *            ff_stream_info_cache_save(), or NULL if the input cannot be
+ *            cached; must be freed with av_free()
+ * @return 1 if the parameters were loaded, 0 if not, a negative error code
+ *         on failure
+ */
+int ff_stream_info_cache_load(AVFormatContext *s, char **key);
+
+/**
+ * Save the stream parameters of s to its entry in the stream info cache
+ * directory.
+ */
+int ff_stream_info_cache_save(AVFormatContext *s, const char *key);
+
 #endif /* AVFORMAT_INTERNAL_H */
@@ -100,6 +100,27 @@ typedef struct MOVSbgp {
     unsigned int index;
 } MOVSbgp;
 
+/**
+ * Position in the sample tables (stsc, stco, stsz, stts, stss, stps, sbgp)
+ * of a track, used to compute the sample index entries one at a time.
+ */
+typedef struct MOVSampleCursor {
+    unsigned int sample;        ///< number of the next sample
+    unsigned int chunk;         ///< current chunk
+    unsigned int chunk_sample;  ///< number of the next sample in the current chunk
+    int in_chunk;               ///< chunk has been entered
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int stss_index;
+    unsigned int stps_index;
+    unsigned int rap_group_index;
+    unsigned int rap_group_sample;
+    unsigned int distance;      ///< distance of the next sample from the last keyframe
+    int64_t offset;             ///< position of the next sample
+    int64_t dts;                ///< dts of the next sample
+} MOVSampleCursor;
+
 typedef struct MOVFragmentIndexItem {
     int64_t moof_offset;
     int64_t time;
@@ -167,6 +188,17 @@ typedef struct MOVStreamContext {
     int64_t duration_for_fps;
 
     int32_t *display_matrix;
+
+    /**
+     * Compact index: the sample tables are kept, index_entries only holds
+     * seek points and the samples are computed on demand with a cursor.
+     */
+    int compact;
+    unsigned int compact_sample_count;  ///< number of samples of the track
+    MOVSampleCursor *compact_cursors;   ///< cursor before each entry of index_entries
+    MOVSampleCursor cursor;             ///< cursor after cursor_entry
+    AVIndexEntry cursor_entry;          ///< sample number cursor_sample
+    int cursor_sample;                  ///< -1 if cursor_entry is unset
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -198,6 +230,7 @@ typedef struct MOVContext {
     MOVFragmentIndex** fragment_index_data;
     unsigned fragment_index_count;
     int atom_depth;
+    int compact_index;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
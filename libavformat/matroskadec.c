@@ -260,6 +260,12 @@ typedef struct MatroskaLevel1Element {
     int parsed;
 } MatroskaLevel1Element;
 
+typedef struct MatroskaClusterPos {
+    int64_t  pos;
+    uint64_t timecode;
+    int      parsed;    ///< the keyframes of the cluster are indexed
+} MatroskaClusterPos;
+
 typedef struct MatroskaDemuxContext {
     const AVClass *class;
     AVFormatContext *ctx;
@@ -306,6 +312,13 @@ typedef struct MatroskaDemuxContext {
     int current_cluster_num_blocks;
     int64_t current_cluster_pos;
     MatroskaCluster current_cluster;
+    /* The current cluster is read from its start, without seeking. */
+    int current_cluster_complete;
+
+    /* Clusters read so far sorted by position, to seek without cues. */
+    MatroskaClusterPos *cluster_index;
+    int num_cluster_index;
+    unsigned int cluster_index_size;
 
     /* File has SSA subtitles which prevent incremental cluster parsing. */
     int contains_ssa;
@@ -1046,6 +1059,7 @@ static int ebml_parse_elem(MatroskaDemuxContext *matroska,
     };
     AVIOContext *pb = matroska->ctx->pb;
     uint32_t id = syntax->id;
+    int64_t pos = avio_tell(pb);
     uint64_t length;
     int res;
     void *newelem;
@@ -1094,6 +1108,18 @@ static int ebml_parse_elem(MatroskaDemuxContext *matroska,
         break;
     case EBML_LEVEL1:
     case EBML_NEST:
+        /* The cues are only needed to seek, skip them until then like
+         * the ones found through a seekhead. pos is after the 4 bytes ID. */
+        if (id == MATROSKA_ID_CUES && matroska->cues_parsing_deferred > 0 &&
+            pb->seekable && length != 0xffffffffffffff &&
+            !(matroska->ctx->flags & AVFMT_FLAG_IGNIDX) &&
+            (level1_elem = matroska_find_level1_elem(matroska, id)) &&
+            !level1_elem->parsed) {
+            level1_elem->pos = pos - 4 - matroska->segment_start;
+            if (ffio_limit(pb, length) != length)
+                return AVERROR(EIO);
+            return avio_skip(pb, length) < 0 ? AVERROR(EIO) : 0;
+        }
         if ((res = ebml_read_master(matroska, length)) < 0)
             return res;
         if (id == MATROSKA_ID_SEGMENT)
@@ -1534,6 +1560,9 @@ static void matroska_parse_cues(MatroskaDemuxContext *matroska) {
     if (matroska->ctx->flags & AVFMT_FLAG_IGNIDX)
         return;
 
+    if (matroska->cues_parsing_deferred > 0)
+        matroska->cues_parsing_deferred = 0;
+
     for (i = 0; i < matroska->num_level1_elems; i++) {
         MatroskaLevel1Element *elem = &matroska->level1_elems[i];
         if (elem->id == MATROSKA_ID_CUES && !elem->parsed) {
@@ -2910,6 +2939,123 @@ end:
     return res;
 }
 
+/*
+ * Add a cluster to the cluster index.
+ * Returns its index in the cluster index, or < 0 on failure.
+ */
+static int matroska_add_cluster_pos(MatroskaDemuxContext *matroska,
+                                    int64_t pos, uint64_t timecode, int parsed)
+{
+    MatroskaClusterPos *clusters = matroska->cluster_index;
+    int n = matroska->num_cluster_index, lo = 0, hi = n;
+
+    if (n && pos <= clusters[n - 1].pos) {
+        if (pos == clusters[n - 1].pos) {
+            clusters[n - 1].parsed |= parsed;
+            return n - 1;
+        }
+        while (lo < hi) {
+            int mid = (lo + hi) >> 1;
+            if (clusters[mid].pos < pos)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (clusters[lo].pos == pos) {
+            clusters[lo].parsed |= parsed;
+            return lo;
+        }
+    } else
+        lo = n;
+
+    clusters = av_fast_realloc(matroska->cluster_index,
+                               &matroska->cluster_index_size,
+                               (n + 1) * sizeof(*clusters));
+    if (!clusters)
+        return AVERROR(ENOMEM);
+    memmove(&clusters[lo + 1], &clusters[lo], (n - lo) * sizeof(*clusters));
+    clusters[lo].pos      = pos;
+    clusters[lo].timecode = timecode;
+    clusters[lo].parsed   = parsed;
+    matroska->cluster_index     = clusters;
+    matroska->num_cluster_index = n + 1;
+    return lo;
+}
+
+/*
+ * Find the cluster to start parsing from to seek to timestamp in a file
+ * without cues. Starting from the last known cluster at or after pos which
+ * is not after timestamp, only the cluster headers are read until the first
+ * cluster after timestamp.
+ * Returns the index in the cluster index of the last cluster not after
+ * timestamp, or < 0 if none was found.
+ */
+static int matroska_skip_clusters(MatroskaDemuxContext *matroska,
+                                  int64_t pos, uint64_t timestamp)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    int best = -1, i;
+
+    for (i = 0; i < matroska->num_cluster_index; i++) {
+        if (matroska->cluster_index[i].timecode > timestamp)
+            break;
+        if (matroska->cluster_index[i].pos >= pos)
+            best = i;
+    }
+    if (best >= 0)
+        pos = matroska->cluster_index[best].pos;
+
+    while (avio_seek(pb, pos, SEEK_SET) == pos) {
+        uint64_t id, length, timecode = (uint64_t)-1;
+        int64_t end;
+        int res;
+
+        if ((res = ebml_read_num(matroska, pb, 4, &id)) < 0)
+            break;
+        id |= 1 << 7 * res;
+        if (ebml_read_length(matroska, pb, &length) < 0 ||
+            length == 0xffffffffffffff)
+            break;
+        end = avio_tell(pb) + length;
+        if (id != MATROSKA_ID_CLUSTER) {
+            if (id != MATROSKA_ID_CUES && id != MATROSKA_ID_TAGS &&
+                id != MATROSKA_ID_SEEKHEAD && id != MATROSKA_ID_CHAPTERS &&
+                id != MATROSKA_ID_ATTACHMENTS && id != EBML_ID_VOID &&
+                id != EBML_ID_CRC32)
+                break;
+            pos = end;
+            continue;
+        }
+
+        /* the timecode comes first, before the blocks */
+        while (avio_tell(pb) < end) {
+            uint64_t elem_id, elem_length;
+            if ((res = ebml_read_num(matroska, pb, 4, &elem_id)) < 0)
+                break;
+            elem_id |= 1 << 7 * res;
+            if (ebml_read_length(matroska, pb, &elem_length) < 0 ||
+                elem_id == MATROSKA_ID_BLOCKGROUP ||
+                elem_id == MATROSKA_ID_SIMPLEBLOCK)
+                break;
+            if (elem_id == MATROSKA_ID_CLUSTERTIMECODE) {
+                if (elem_length > 8 || ebml_read_uint(pb, elem_length, &timecode) < 0)
+                    timecode = (uint64_t)-1;
+                break;
+            }
+            if (avio_skip(pb, elem_length) < 0)
+                break;
+        }
+        if (timecode == (uint64_t)-1 ||
+            (i = matroska_add_cluster_pos(matroska, pos, timecode, 0)) < 0 ||
+            timecode > timestamp)
+            break;
+        best = i;
+        pos  = end;
+    }
+
+    return best;
+}
+
 static int matroska_parse_cluster_incremental(MatroskaDemuxContext *matroska)
 {
     EbmlList *blocks_list;
@@ -2922,6 +3068,11 @@ static int matroska_parse_cluster_incremental(MatroskaDemuxContext *matroska)
         /* New Cluster */
         if (matroska->current_cluster_pos)
             ebml_level_end(matroska);
+        if (matroska->current_cluster_pos && matroska->current_cluster_complete &&
+            matroska->current_cluster_num_blocks)
+            matroska_add_cluster_pos(matroska, matroska->current_cluster_pos,
+                                     matroska->current_cluster.timecode, 1);
+        matroska->current_cluster_complete = 1;
         ebml_free(matroska_cluster, &matroska->current_cluster);
         memset(&matroska->current_cluster, 0, sizeof(MatroskaCluster));
         matroska->current_cluster_num_blocks = 0;
@@ -2948,6 +3099,9 @@ static int matroska_parse_cluster_incremental(MatroskaDemuxContext *matroska)
 
         matroska->current_cluster_num_blocks = blocks_list->nb_elem;
         i                                    = blocks_list->nb_elem - 1;
+        if (i == 0)
+            matroska_add_cluster_pos(matroska, matroska->current_cluster_pos,
+                                     matroska->current_cluster.timecode, 0);
         if (blocks[i].bin.size > 0 && blocks[i].bin.data) {
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
             uint8_t* additional = blocks[i].additional.size > 0 ?
@@ -2985,6 +3139,8 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
     res         = ebml_parse(matroska, matroska_clusters, &cluster);
     blocks_list = &cluster.blocks;
     blocks      = blocks_list->elem;
+    if (blocks_list->nb_elem)
+        matroska_add_cluster_pos(matroska, pos, cluster.timecode, 1);
     for (i = 0; i < blocks_list->nb_elem; i++)
         if (blocks[i].bin.size > 0 && blocks[i].bin.data) {
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
@@ -3013,6 +3169,67 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/*
+ * Parse the blocks of a cluster of the cluster index, up to the next one.
+ */
+static void matroska_parse_cluster_at(MatroskaDemuxContext *matroska, int i)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+
+    avio_seek(pb, matroska->cluster_index[i].pos, SEEK_SET);
+    matroska->current_id               = 0;
+    matroska->current_cluster_complete = 0;
+    do {
+        matroska_clear_queue(matroska);
+        if (matroska_parse_cluster(matroska) < 0)
+            break;
+    } while (i + 1 >= matroska->num_cluster_index ||
+             avio_tell(pb) < matroska->cluster_index[i + 1].pos);
+    matroska->cluster_index[i].parsed = 1;
+}
+
+/*
+ * Index the keyframes of st around timestamp in a file without cues.
+ * The clusters after the last keyframe indexed before timestamp which are
+ * not known yet are found by only reading their headers. Then the clusters
+ * not parsed yet are parsed, backwards from the last one before timestamp
+ * until a keyframe before timestamp is indexed, and forwards for a keyframe
+ * after timestamp if that is what is searched.
+ * Returns < 0 if the clusters could not be read this way.
+ */
+static int matroska_index_clusters(MatroskaDemuxContext *matroska, AVStream *st,
+                                   int64_t timestamp, int flags)
+{
+    int index = av_index_search_timestamp(st, timestamp, AVSEEK_FLAG_BACKWARD);
+    int64_t pos = st->index_entries[FFMAX(index, 0)].pos;
+    int c = matroska_skip_clusters(matroska, pos, timestamp), i;
+
+    if (c < 0)
+        return c;
+
+    for (i = c; i >= 0 && matroska->cluster_index[i].pos >= pos; i--) {
+        if (!matroska->cluster_index[i].parsed)
+            matroska_parse_cluster_at(matroska, i);
+        index = av_index_search_timestamp(st, timestamp, AVSEEK_FLAG_BACKWARD);
+        if (index >= 0 &&
+            st->index_entries[index].timestamp >= matroska->cluster_index[i].timecode)
+            break;
+    }
+
+    if (!(flags & AVSEEK_FLAG_BACKWARD)) {
+        for (i = c + 1; i < matroska->num_cluster_index; i++) {
+            index = av_index_search_timestamp(st, timestamp, flags);
+            if (index >= 0 && st->index_entries[index].pos < matroska->cluster_index[i].pos)
+                break;
+            if (!matroska->cluster_index[i].parsed)
+                matroska_parse_cluster_at(matroska, i);
+        }
+    }
+
+    matroska_clear_queue(matroska);
+    return 0;
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
@@ -3021,6 +3238,8 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     AVStream *st = s->streams[stream_index];
     int i, index, index_sub, index_min;
 
+    matroska->current_cluster_complete = 0;
+
     /* Parse the CUES now since we need the index data to seek. */
     if (matroska->cues_parsing_deferred > 0) {
         matroska->cues_parsing_deferred = 0;
@@ -3031,7 +3250,10 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
         goto err;
     timestamp = FFMAX(timestamp, st->index_entries[0].timestamp);
 
-    if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 || index == st->nb_index_entries - 1) {
+    if (!matroska->index.nb_elem && s->pb->seekable &&
+        matroska_index_clusters(matroska, st, timestamp, flags) >= 0) {
+        index = av_index_search_timestamp(st, timestamp, flags);
+    } else if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 || index == st->nb_index_entries - 1) {
         avio_seek(s->pb, st->index_entries[st->nb_index_entries - 1].pos,
                   SEEK_SET);
         matroska->current_id = 0;
@@ -3068,6 +3290,7 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
 
     avio_seek(s->pb, st->index_entries[index_min].pos, SEEK_SET);
     matroska->current_id       = 0;
+    matroska->current_cluster_complete = 0;
     if (flags & AVSEEK_FLAG_ANY) {
         st->skip_to_keyframe = 0;
         matroska->skip_to_timecode = timestamp;
@@ -3085,6 +3308,7 @@ err:
     // the generic seeking code.
     matroska_clear_queue(matroska);
     matroska->current_id = 0;
+    matroska->current_cluster_complete = 0;
     st->skip_to_keyframe =
     matroska->skip_to_keyframe = 0;
     matroska->done = 0;
@@ -3105,6 +3329,7 @@ static int matroska_read_close(AVFormatContext *s)
             av_freep(&tracks[n].audio.buf);
     ebml_free(matroska_cluster, &matroska->current_cluster);
     ebml_free(matroska_segment, matroska);
+    av_freep(&matroska->cluster_index);
 
     return 0;
 }
@@ -2381,16 +2381,255 @@ static int mov_read_sbgp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return pb->eof_reached ? AVERROR_EOF : 0;
 }
 
+/**
+ * Compute the index entry of the next sample of a track and advance the
+ * cursor past it.
+ *
+ * @return 1 if the sample belongs to the demuxed sample description,
+ *         0 if it does not, AVERROR_EOF after the last sample,
+ *         another negative error code on invalid sample tables
+ */
+static int mov_cursor_next(MOVContext *mov, AVStream *st, MOVSampleCursor *cur,
+                           AVIndexEntry *e)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int rap_group_present = sc->rap_group_count && sc->rap_group;
+    int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+    unsigned int sample_size;
+    int keyframe = 0;
+
+    while (!cur->in_chunk || cur->chunk_sample >= sc->stsc_data[cur->stsc_index].count) {
+        int64_t next_offset;
+
+        if (cur->in_chunk) {
+            cur->chunk++;
+            cur->in_chunk = 0;
+        }
+        if (cur->chunk >= sc->chunk_count)
+            return AVERROR_EOF;
+
+        next_offset = cur->chunk + 1 < sc->chunk_count ? sc->chunk_offsets[cur->chunk + 1] : INT64_MAX;
+        cur->offset = sc->chunk_offsets[cur->chunk];
+        while (cur->stsc_index + 1 < sc->stsc_count &&
+            cur->chunk + 1 == sc->stsc_data[cur->stsc_index + 1].first)
+            cur->stsc_index++;
+
+        if (next_offset > cur->offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
+            sc->stsc_data[cur->stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - cur->offset) {
+            av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
+            sc->stsz_sample_size = sc->sample_size;
+        }
+        if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
+            av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
+            sc->stsz_sample_size = sc->sample_size;
+        }
+        cur->in_chunk     = 1;
+        cur->chunk_sample = 0;
+    }
+
+    if (cur->sample >= sc->sample_count) {
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    if (!sc->keyframe_absent && (!sc->keyframe_count || cur->sample+key_off == sc->keyframes[cur->stss_index])) {
+        keyframe = 1;
+        if (cur->stss_index + 1 < sc->keyframe_count)
+            cur->stss_index++;
+    } else if (sc->stps_count && cur->sample+key_off == sc->stps_data[cur->stps_index]) {
+        keyframe = 1;
+        if (cur->stps_index + 1 < sc->stps_count)
+            cur->stps_index++;
+    }
+    if (rap_group_present && cur->rap_group_index < sc->rap_group_count) {
+        if (sc->rap_group[cur->rap_group_index].index > 0)
+            keyframe = 1;
+        if (++cur->rap_group_sample == sc->rap_group[cur->rap_group_index].count) {
+            cur->rap_group_sample = 0;
+            cur->rap_group_index++;
+        }
+    }
+    if (sc->keyframe_absent
+        && !sc->stps_count
+        && !rap_group_present
+        && (st->codec->codec_type == AVMEDIA_TYPE_AUDIO || (cur->chunk == 0 && cur->chunk_sample == 0)))
+         keyframe = 1;
+    if (keyframe)
+        cur->distance = 0;
+    sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[cur->sample];
+
+    e->pos          = cur->offset;
+    e->timestamp    = cur->dts;
+    e->size         = sample_size;
+    e->min_distance = cur->distance;
+    e->flags        = keyframe ? AVINDEX_KEYFRAME : 0;
+
+    cur->offset += sample_size;
+    cur->dts    += sc->stts_data[cur->stts_index].duration;
+    cur->distance++;
+    cur->stts_sample++;
+    cur->sample++;
+    cur->chunk_sample++;
+    if (cur->stts_index + 1 < sc->stts_count && cur->stts_sample == sc->stts_data[cur->stts_index].count) {
+        cur->stts_sample = 0;
+        cur->stts_index++;
+    }
+
+    return sc->pseudo_stream_id == -1 ||
+           sc->stsc_data[cur->stsc_index].id - 1 == sc->pseudo_stream_id;
+}
+
+#define COMPACT_INDEX_MIN_INTERVAL   64
+#define COMPACT_INDEX_MAX_INTERVAL 1024
+
+/**
+ * Walk the sample tables of a track once and only keep seek points in
+ * st->index_entries, along with the cursor to resume from each of them:
+ * the first sample, keyframes at least COMPACT_INDEX_MIN_INTERVAL samples
+ * apart, and otherwise a sample every COMPACT_INDEX_MAX_INTERVAL samples.
+ * The other samples are computed on demand by mov_get_sample().
+ */
+static void mov_build_compact_index(MOVContext *mov, AVStream *st, MOVSampleCursor *cur)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int nb_samples = 0, last = 0, allocated = 0;
+    uint64_t stream_size = 0;
+    AVIndexEntry e;
+    int ret;
+
+    for (;;) {
+        MOVSampleCursor prev = *cur;
+
+        if ((ret = mov_cursor_next(mov, st, cur, &e)) < 0)
+            break;
+        if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && nb_samples < 99)
+            ff_rfps_add_frame(mov->fc, st, e.timestamp);
+        stream_size += e.size;
+
+        if (!nb_samples ||
+            ((e.flags & AVINDEX_KEYFRAME) && nb_samples - last >= COMPACT_INDEX_MIN_INTERVAL) ||
+            nb_samples - last >= COMPACT_INDEX_MAX_INTERVAL) {
+            if (st->nb_index_entries >= allocated) {
+                allocated = FFMAX(2 * allocated, 64);
+                if (av_reallocp_array(&st->index_entries, allocated, sizeof(*st->index_entries)) < 0 ||
+                    av_reallocp_array(&sc->compact_cursors, allocated, sizeof(*sc->compact_cursors)) < 0) {
+                    av_freep(&st->index_entries);
+                    av_freep(&sc->compact_cursors);
+                    st->nb_index_entries = 0;
+                    return;
+                }
+            }
+            st->index_entries[st->nb_index_entries]   = e;
+            sc->compact_cursors[st->nb_index_entries] = prev;
+            st->nb_index_entries++;
+            last = nb_samples;
+        }
+        nb_samples++;
+    }
+    st->index_entries_allocated_size = allocated * sizeof(*st->index_entries);
+
+    sc->compact              = 1;
+    sc->compact_sample_count = nb_samples;
+    sc->cursor_sample        = -1;
+    av_log(mov->fc, AV_LOG_TRACE, "stream %d: compact index of %d entries for %u samples\n",
+           st->index, st->nb_index_entries, nb_samples);
+
+    if (ret == AVERROR_EOF && st->duration > 0)
+        st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
+}
+
+/**
+ * Replace the compact index of a track by the full index, for the code
+ * which needs an index entry for every sample.
+ */
+static int mov_expand_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVSampleCursor cur;
+    AVIndexEntry *entries = NULL;
+    unsigned int i = 0;
+
+    if (!sc->compact)
+        return 0;
+
+    if (sc->compact_sample_count) {
+        entries = av_malloc_array(sc->compact_sample_count, sizeof(*entries));
+        if (!entries)
+            return AVERROR(ENOMEM);
+        cur = sc->compact_cursors[0];
+        for (i = 0; i < sc->compact_sample_count; i++)
+            if (mov_cursor_next(mov, st, &cur, &entries[i]) < 0)
+                break;
+    }
+    av_free(st->index_entries);
+    st->index_entries                = entries;
+    st->nb_index_entries             = i;
+    st->index_entries_allocated_size = sc->compact_sample_count * sizeof(*entries);
+
+    av_freep(&sc->compact_cursors);
+    sc->compact = 0;
+    return 0;
+}
+
+/**
+ * Move the cursor of a track with a compact index to the given sample.
+ */
+static int mov_cursor_seek(MOVContext *mov, AVStream *st, int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int ret;
+
+    if (sc->cursor_sample < 0 || sample < sc->cursor_sample ||
+        sample - sc->cursor_sample > COMPACT_INDEX_MAX_INTERVAL) {
+        /* restart from the last seek point at or before the sample */
+        int lo = 0, hi = st->nb_index_entries - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) >> 1;
+            if (sc->compact_cursors[mid].sample <= sample)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        sc->cursor        = sc->compact_cursors[lo];
+        sc->cursor_sample = (int)sc->cursor.sample - 1;
+    }
+    while (sc->cursor_sample < sample) {
+        if ((ret = mov_cursor_next(mov, st, &sc->cursor, &sc->cursor_entry)) < 0) {
+            sc->cursor_sample = -1;
+            return ret;
+        }
+        sc->cursor_sample++;
+    }
+    return 0;
+}
+
+/**
+ * Return the index entry of the current sample of a track, or NULL after
+ * its last sample.
+ */
+static AVIndexEntry *mov_get_sample(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->compact)
+        return sc->current_sample < st->nb_index_entries ?
+               &st->index_entries[sc->current_sample] : NULL;
+
+    if (sc->current_sample < 0 || sc->current_sample >= sc->compact_sample_count)
+        return NULL;
+    if (sc->cursor_sample != sc->current_sample &&
+        mov_cursor_seek(mov, st, sc->current_sample) < 0)
+        return NULL;
+    return &sc->cursor_entry;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
     int64_t current_offset;
     int64_t current_dts = 0;
-    unsigned int stts_index = 0;
     unsigned int stsc_index = 0;
-    unsigned int stss_index = 0;
-    unsigned int stps_index = 0;
-    unsigned int i, j;
+    unsigned int i;
     uint64_t stream_size = 0;
 
     if (sc->elst_count) {
@@ -2433,19 +2672,19 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
     if (!(st->codec->codec_type == AVMEDIA_TYPE_AUDIO &&
           sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
-        unsigned int current_sample = 0;
-        unsigned int stts_sample = 0;
-        unsigned int sample_size;
-        unsigned int distance = 0;
-        unsigned int rap_group_index = 0;
-        unsigned int rap_group_sample = 0;
-        int rap_group_present = sc->rap_group_count && sc->rap_group;
-        int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+        MOVSampleCursor cur = { 0 };
+        AVIndexEntry e;
+        int ret;
 
         current_dts -= sc->dts_shift;
 
         if (!sc->sample_count || st->nb_index_entries)
             return;
+        cur.dts = current_dts;
+        if (mov->compact_index && sc->pseudo_stream_id == -1) {
+            mov_build_compact_index(mov, st, &cur);
+            return;
+        }
         if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
             return;
         if (av_reallocp_array(&st->index_entries,
@@ -2456,82 +2695,19 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
         st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
 
-        for (i = 0; i < sc->chunk_count; i++) {
-            int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
-            current_offset = sc->chunk_offsets[i];
-            while (stsc_index + 1 < sc->stsc_count &&
-                i + 1 == sc->stsc_data[stsc_index + 1].first)
-                stsc_index++;
-
-            if (next_offset > current_offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
-                sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - current_offset) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-
-            for (j = 0; j < sc->stsc_data[stsc_index].count; j++) {
-                int keyframe = 0;
-                if (current_sample >= sc->sample_count) {
-                    av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
-                    return;
-                }
-
-                if (!sc->keyframe_absent && (!sc->keyframe_count || current_sample+key_off == sc->keyframes[stss_index])) {
-                    keyframe = 1;
-                    if (stss_index + 1 < sc->keyframe_count)
-                        stss_index++;
-                } else if (sc->stps_count && current_sample+key_off == sc->stps_data[stps_index]) {
-                    keyframe = 1;
-                    if (stps_index + 1 < sc->stps_count)
-                        stps_index++;
-                }
-                if (rap_group_present && rap_group_index < sc->rap_group_count) {
-                    if (sc->rap_group[rap_group_index].index > 0)
-                        keyframe = 1;
-                    if (++rap_group_sample == sc->rap_group[rap_group_index].count) {
-                        rap_group_sample = 0;
-                        rap_group_index++;
-                    }
-                }
-                if (sc->keyframe_absent
-                    && !sc->stps_count
-                    && !rap_group_present
-                    && (st->codec->codec_type == AVMEDIA_TYPE_AUDIO || (i==0 && j==0)))
-                     keyframe = 1;
-                if (keyframe)
-                    distance = 0;
-                sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[current_sample];
-                if (sc->pseudo_stream_id == -1 ||
-                   sc->stsc_data[stsc_index].id - 1 == sc->pseudo_stream_id) {
-                    AVIndexEntry *e = &st->index_entries[st->nb_index_entries++];
-                    e->pos = current_offset;
-                    e->timestamp = current_dts;
-                    e->size = sample_size;
-                    e->min_distance = distance;
-                    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
-                    av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
-                            "size %d, distance %d, keyframe %d\n", st->index, current_sample,
-                            current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100)
-                        ff_rfps_add_frame(mov->fc, st, current_dts);
-                }
-
-                current_offset += sample_size;
-                stream_size += sample_size;
-                current_dts += sc->stts_data[stts_index].duration;
-                distance++;
-                stts_sample++;
-                current_sample++;
-                if (stts_index + 1 < sc->stts_count && stts_sample == sc->stts_data[stts_index].count) {
-                    stts_sample = 0;
-                    stts_index++;
-                }
+        while ((ret = mov_cursor_next(mov, st, &cur, &e)) >= 0) {
+            if (ret) {
+                st->index_entries[st->nb_index_entries++] = e;
+                av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
+                        "size %d, distance %d, keyframe %d\n", st->index, cur.sample - 1,
+                        e.pos, e.timestamp, e.size, e.min_distance, !!(e.flags & AVINDEX_KEYFRAME));
+                if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100)
+                    ff_rfps_add_frame(mov->fc, st, e.timestamp);
             }
+            stream_size += e.size;
         }
+        if (ret != AVERROR_EOF)
+            return;
         if (st->duration > 0)
             st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
     } else {
@@ -2792,15 +2968,17 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         break;
     }
 
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->stsc_data);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
+    /* Do not need those anymore, unless the samples are computed on demand. */
+    if (!sc->compact) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->stsc_data);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
+        av_freep(&sc->rap_group);
+    }
     av_freep(&sc->elst_data);
-    av_freep(&sc->rap_group);
 
     return 0;
 }
@@ -3187,6 +3365,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if ((err = mov_expand_index(c, st)) < 0)
+        return err;
     avio_r8(pb); /* version */
     flags = avio_rb24(pb);
     entries = avio_rb32(pb);
@@ -3799,6 +3979,8 @@ static void mov_read_chapters(AVFormatContext *s)
     st->discard = AVDISCARD_ALL;
     sc = st->priv_data;
     cur_pos = avio_tell(sc->pb);
+    if (mov_expand_index(mov, st) < 0)
+        return;
 
     for (i = 0; i < st->nb_index_entries; i++) {
         AVIndexEntry *sample = &st->index_entries[i];
@@ -3874,7 +4056,7 @@ static int mov_read_timecode_track(AVFormatContext *s, AVStream *st)
     int64_t cur_pos = avio_tell(sc->pb);
     uint32_t value;
 
-    if (!st->nb_index_entries)
+    if (mov_expand_index(s->priv_data, st) < 0 || !st->nb_index_entries)
         return -1;
 
     avio_seek(sc->pb, st->index_entries->pos, SEEK_SET);
@@ -3926,6 +4108,7 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->elst_data);
         av_freep(&sc->rap_group);
         av_freep(&sc->display_matrix);
+        av_freep(&sc->compact_cursors);
     }
 
     if (mov->dv_demux) {
@@ -4242,8 +4425,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        AVIndexEntry *current_sample;
+        if (msc->pb && (current_sample = mov_get_sample(s->priv_data, avst))) {
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!s->pb->seekable && current_sample->pos < sample->pos) ||
@@ -4264,7 +4447,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, *next, compact_sample;
     AVStream *st = NULL;
     int ret;
     mov->fc = s;
@@ -4286,6 +4469,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    /* the entry of a compact index is overwritten by the next sample */
+    if (sc->compact) {
+        compact_sample = *sample;
+        sample = &compact_sample;
+    }
     /* must be done just before reading, to avoid infinite loop on sample */
     sc->current_sample++;
 
@@ -4300,7 +4488,12 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
                    sc->ffindex, sample->pos);
             return AVERROR_INVALIDDATA;
         }
-        ret = av_get_packet(sc->pb, pkt, sample->size);
+#if CONFIG_DV_DEMUXER
+        if (mov->dv_demux && sc->dv_audio_container)
+            ret = av_get_packet(sc->pb, pkt, sample->size);
+        else
+#endif
+            ret = ff_get_packet_ref(sc->pb, pkt, sample->size);
         if (ret < 0)
             return ret;
         if (sc->has_palette) {
@@ -4340,8 +4533,9 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts;
+        next = mov_get_sample(mov, st);
+        next_dts = next ? next->timestamp : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -4353,13 +4547,77 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/**
+ * Same as av_index_search_timestamp() on the full index, for a track with
+ * a compact index: the search starts from the last seek point before the
+ * timestamp, and continues on the samples computed from there.
+ */
+static int mov_compact_search_timestamp(MOVContext *mov, AVStream *st,
+                                        int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *e;
+    int backward = flags & AVSEEK_FLAG_BACKWARD;
+    int any      = flags & AVSEEK_FLAG_ANY;
+    int old_sample = sc->current_sample;
+    int k, start, last_le = -1, last_key = -1, first_ge = -1, m;
+
+    /* start from a seek point strictly before the timestamp, so that the
+     * first sample at the timestamp is walked over */
+    k = timestamp == INT64_MIN ? -1 :
+        av_index_search_timestamp(st, timestamp - 1, AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY);
+    start = k < 0 ? 0 : sc->compact_cursors[k].sample;
+
+    for (sc->current_sample = start; (e = mov_get_sample(mov, st)); sc->current_sample++) {
+        if (e->timestamp >= timestamp && first_ge < 0)
+            first_ge = sc->current_sample;
+        if (e->timestamp > timestamp)
+            break;
+        last_le = sc->current_sample;
+        if (e->flags & AVINDEX_KEYFRAME)
+            last_key = sc->current_sample;
+    }
+
+    if (backward) {
+        m = last_le;
+        if (!any && m >= 0 && last_key != m) {
+            /* the keyframe may be before the seek point, walk back over the
+             * previous ones until one is found */
+            for (m = last_key; m < 0 && k > 0; k--) {
+                int end = sc->compact_cursors[k].sample;
+                for (sc->current_sample = sc->compact_cursors[k - 1].sample;
+                     sc->current_sample < end && (e = mov_get_sample(mov, st));
+                     sc->current_sample++)
+                    if (e->flags & AVINDEX_KEYFRAME)
+                        m = sc->current_sample;
+            }
+        }
+    } else {
+        m = first_ge;
+        if (m >= 0 && !any) {
+            for (sc->current_sample = m; (e = mov_get_sample(mov, st)); sc->current_sample++)
+                if (e->flags & AVINDEX_KEYFRAME)
+                    break;
+            m = e ? sc->current_sample : -1;
+        }
+    }
+    /* the search walks over the samples with current_sample, leave the
+     * read position as it was if nothing was found */
+    if (m < 0)
+        sc->current_sample = old_sample;
+    return m;
+}
+
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
     int sample, time_sample;
     int i;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->compact)
+        sample = mov_compact_search_timestamp(s->priv_data, st, timestamp, flags);
+    else
+        sample = av_index_search_timestamp(st, timestamp, flags);
     av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
     if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
         sample = 0;
@@ -4400,7 +4658,12 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->index_entries[sample].timestamp;
+        AVIndexEntry *e = mov_get_sample(mc, st);
+        int64_t seek_timestamp;
+
+        if (!e)
+            return AVERROR_INVALIDDATA;
+        seek_timestamp = e->timestamp;
 
         for (i = 0; i < s->nb_streams; i++) {
             int64_t timestamp;
@@ -4463,6 +4726,8 @@ static const AVOption mov_options[] = {
         AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, .flags = FLAGS },
     { "export_xmp", "Export full XMP metadata", OFFSET(export_xmp),
         AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, .flags = FLAGS },
+    { "compact_index", "Keep the sample tables instead of a full index, and compute the samples on demand",
+        OFFSET(compact_index), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, .flags = FLAGS },
     { NULL },
 };
 
@@ -46,9 +46,18 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/timecode.h"
 #include "libavutil/color_utils.h"
+#include "libavutil/file.h"
 #include "hevc.h"
 #include "rtpenc.h"
 #include "mov_chan.h"
+#include "os_support.h"
+#include <fcntl.h>
+#if HAVE_IO_H
+#include <io.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -82,6 +91,7 @@ static const AVOption options[] = {
     { "fragment_index", "Fragment number of the next fragment", offsetof(MOVMuxContext, fragments), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { "mov_gamma", "gamma value for gama atom", offsetof(MOVMuxContext, gamma), AV_OPT_TYPE_FLOAT, {.dbl = 0.0 }, 0.0, 10, AV_OPT_FLAG_ENCODING_PARAM},
     { "frag_interleave", "Interleave samples within fragments (max number of consecutive samples, lower is tighter interleaving, but with more overhead)", offsetof(MOVMuxContext, frag_interleave), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "max_table_entries", "Number of sample table entries per track kept in memory, older ones are spilled to a temporary file (0 for unlimited)", offsetof(MOVMuxContext, max_table_entries), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { NULL },
 };
 
@@ -117,9 +127,119 @@ static int64_t update_size(AVIOContext *pb, int64_t pos)
     return curpos - pos;
 }
 
-static int co64_required(const MOVTrack *track)
+static int spill_block_io(MOVTrack *track, MOVIentry *entries, int index, int store)
+{
+    const int size = track->spill_block_size * sizeof(*entries);
+    int ret;
+
+    if (lseek(track->spill_fd, (int64_t)index * size, SEEK_SET) < 0)
+        return AVERROR(errno);
+    ret = store ? write(track->spill_fd, entries, size)
+                : read(track->spill_fd, entries, size);
+    if (ret < 0)
+        return AVERROR(errno);
+    return ret == size ? 0 : AVERROR(EIO);
+}
+
+/**
+ * Move the oldest spill_block_size in-memory index entries of the track
+ * to its spill file, creating it if needed.
+ */
+static int mov_spill_entries(AVFormatContext *s, MOVTrack *track)
+{
+    int ret;
+
+    if (!track->cluster_first) {
+        char *filename;
+        int fd = av_tempfile("ffmovspill", &filename, 0, s);
+        if (fd < 0)
+            return fd;
+        unlink(filename);
+        av_freep(&filename);
+        track->spill_fd = fd;
+    }
+    ret = spill_block_io(track, track->cluster,
+                         track->cluster_first / track->spill_block_size, 1);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Error spilling index entries: %s\n", av_err2str(ret));
+        if (!track->cluster_first)
+            close(track->spill_fd);
+        return ret;
+    }
+    track->cluster_first += track->spill_block_size;
+    memmove(track->cluster, track->cluster + track->spill_block_size,
+            (track->entry - track->cluster_first) * sizeof(*track->cluster));
+    return 0;
+}
+
+static MOVIentry *get_spilled_cluster(MOVTrack *track, int i, int dirty)
 {
-    if (track->entry > 0 && track->cluster[track->entry - 1].pos + track->data_offset > UINT32_MAX)
+    MOVSpillBlock *cache = track->spill_cache;
+    int index = i / track->spill_block_size;
+    int ret;
+
+    if (!cache[0].entries || cache[0].index != index) {
+        if (!cache[1].entries || cache[1].index != index) {
+            /* evict the least recently used block */
+            if (cache[1].dirty &&
+                (ret = spill_block_io(track, cache[1].entries, cache[1].index, 1)) < 0)
+                goto fail;
+            cache[1].dirty = 0;
+            if (!cache[1].entries &&
+                !(cache[1].entries = av_malloc_array(track->spill_block_size,
+                                                     sizeof(*cache[1].entries)))) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            cache[1].index = -1;
+            if ((ret = spill_block_io(track, cache[1].entries, index, 0)) < 0)
+                goto fail;
+            cache[1].index = index;
+        }
+        FFSWAP(MOVSpillBlock, cache[0], cache[1]);
+    }
+    cache[0].dirty |= dirty;
+    return &cache[0].entries[i % track->spill_block_size];
+
+fail:
+    track->spill_error = ret;
+    memset(&track->spill_dummy, 0, sizeof(track->spill_dummy));
+    track->spill_dummy.entries = 1;
+    return &track->spill_dummy;
+}
+
+/**
+ * Get the index entry i of the track, reading it back from the spill file
+ * if it is not in memory anymore. The returned pointer stays valid until
+ * entries of two other spilled blocks are accessed.
+ */
+static av_always_inline MOVIentry *get_cluster(MOVTrack *track, int i)
+{
+    if (i >= track->cluster_first)
+        return &track->cluster[i - track->cluster_first];
+    return get_spilled_cluster(track, i, 0);
+}
+
+/** Same as get_cluster() for entries which are going to be modified. */
+static av_always_inline MOVIentry *get_cluster_rw(MOVTrack *track, int i)
+{
+    if (i >= track->cluster_first)
+        return &track->cluster[i - track->cluster_first];
+    return get_spilled_cluster(track, i, 1);
+}
+
+static void mov_free_spill(MOVTrack *track)
+{
+    if (track->cluster_first)
+        close(track->spill_fd);
+    track->cluster_first = 0;
+    av_freep(&track->spill_cache[0].entries);
+    av_freep(&track->spill_cache[1].entries);
+}
+
+static int co64_required(MOVTrack *track)
+{
+    if (track->entry > 0 && get_cluster(track, track->entry - 1)->pos + track->data_offset > UINT32_MAX)
         return 1;
     return 0;
 }
@@ -138,12 +258,13 @@ static int mov_write_stco_tag(AVIOContext *pb, MOVTrack *track)
     avio_wb32(pb, 0); /* version & flags */
     avio_wb32(pb, track->chunkCount); /* entry count */
     for (i = 0; i < track->entry; i++) {
-        if (!track->cluster[i].chunkNum)
+        MOVIentry *e = get_cluster(track, i);
+        if (!e->chunkNum)
             continue;
         if (mode64 == 1)
-            avio_wb64(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb64(pb, e->pos + track->data_offset);
         else
-            avio_wb32(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb32(pb, e->pos + track->data_offset);
     }
     return update_size(pb, pos);
 }
@@ -160,14 +281,16 @@ static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
     avio_wb32(pb, 0); /* version & flags */
 
     for (i = 0; i < track->entry; i++) {
-        tst = track->cluster[i].size / track->cluster[i].entries;
+        MOVIentry *e = get_cluster(track, i);
+        tst = e->size / e->entries;
         if (oldtst != -1 && tst != oldtst)
             equalChunks = 0;
         oldtst = tst;
-        entries += track->cluster[i].entries;
+        entries += e->entries;
     }
     if (equalChunks && track->entry) {
-        int sSize = track->entry ? track->cluster[0].size / track->cluster[0].entries : 0;
+        MOVIentry *e = get_cluster(track, 0);
+        int sSize = e->size / e->entries;
         sSize = FFMAX(1, sSize); // adpcm mono case could make sSize == 0
         avio_wb32(pb, sSize); // sample size
         avio_wb32(pb, entries); // sample count
@@ -175,10 +298,9 @@ static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
         avio_wb32(pb, 0); // sample size
         avio_wb32(pb, entries); // sample count
         for (i = 0; i < track->entry; i++) {
-            for (j = 0; j < track->cluster[i].entries; j++) {
-                avio_wb32(pb, track->cluster[i].size /
-                          track->cluster[i].entries);
-            }
+            MOVIentry *e = get_cluster(track, i);
+            for (j = 0; j < e->entries; j++)
+                avio_wb32(pb, e->size / e->entries);
         }
     }
     return update_size(pb, pos);
@@ -197,11 +319,12 @@ static int mov_write_stsc_tag(AVIOContext *pb, MOVTrack *track)
     entryPos = avio_tell(pb);
     avio_wb32(pb, track->chunkCount); // entry count
     for (i = 0; i < track->entry; i++) {
-        if (oldval != track->cluster[i].samples_in_chunk && track->cluster[i].chunkNum) {
-            avio_wb32(pb, track->cluster[i].chunkNum); // first chunk
-            avio_wb32(pb, track->cluster[i].samples_in_chunk); // samples per chunk
+        MOVIentry *e = get_cluster(track, i);
+        if (oldval != e->samples_in_chunk && e->chunkNum) {
+            avio_wb32(pb, e->chunkNum); // first chunk
+            avio_wb32(pb, e->samples_in_chunk); // samples per chunk
             avio_wb32(pb, 0x1); // sample description index
-            oldval = track->cluster[i].samples_in_chunk;
+            oldval = e->samples_in_chunk;
             index++;
         }
     }
@@ -225,7 +348,7 @@ static int mov_write_stss_tag(AVIOContext *pb, MOVTrack *track, uint32_t flag)
     entryPos = avio_tell(pb);
     avio_wb32(pb, track->entry); // entry count
     for (i = 0; i < track->entry; i++) {
-        if (track->cluster[i].flags & flag) {
+        if (get_cluster(track, i)->flags & flag) {
             avio_wb32(pb, i + 1);
             index++;
         }
@@ -545,7 +668,7 @@ static unsigned compute_avg_bitrate(MOVTrack *track)
     if (!track->track_duration)
         return 0;
     for (i = 0; i < track->entry; i++)
-        size += track->cluster[i].size;
+        size += get_cluster(track, i)->size;
     return size * 8 * track->timescale / track->track_duration;
 }
 
@@ -859,9 +982,9 @@ static int get_cluster_duration(MOVTrack *track, int cluster_idx)
     if (cluster_idx + 1 == track->entry)
         next_dts = track->track_duration + track->start_dts;
     else
-        next_dts = track->cluster[cluster_idx + 1].dts;
+        next_dts = get_cluster(track, cluster_idx + 1)->dts;
 
-    next_dts -= track->cluster[cluster_idx].dts;
+    next_dts -= get_cluster(track, cluster_idx)->dts;
 
     av_assert0(next_dts >= 0);
     av_assert0(next_dts <= INT_MAX);
@@ -1861,83 +1984,85 @@ static int mov_write_stsd_tag(AVIOContext *pb, MOVMuxContext *mov, MOVTrack *tra
 
 static int mov_write_ctts_tag(AVIOContext *pb, MOVTrack *track)
 {
-    MOVStts *ctts_entries;
-    uint32_t entries = 0;
-    uint32_t atom_size;
-    int i;
+    uint32_t entries = 0, count = 0;
+    int64_t entryPos, curpos;
+    int i, duration = 0;
 
-    ctts_entries = av_malloc_array((track->entry + 1), sizeof(*ctts_entries)); /* worst case */
-    if (!ctts_entries)
-        return AVERROR(ENOMEM);
-    ctts_entries[0].count = 1;
-    ctts_entries[0].duration = track->cluster[0].cts;
-    for (i = 1; i < track->entry; i++) {
-        if (track->cluster[i].cts == ctts_entries[entries].duration) {
-            ctts_entries[entries].count++; /* compress */
-        } else {
+    int64_t pos = avio_tell(pb);
+    avio_wb32(pb, 0); /* size */
+    ffio_wfourcc(pb, "ctts");
+    avio_wb32(pb, 0); /* version & flags */
+    entryPos = avio_tell(pb);
+    avio_wb32(pb, 0); /* entry count */
+    for (i = 0; i < track->entry; i++) {
+        int cts = get_cluster(track, i)->cts;
+        if (count && cts == duration) {
+            count++; /* compress */
+            continue;
+        }
+        if (count) {
+            avio_wb32(pb, count);
+            avio_wb32(pb, duration);
             entries++;
-            ctts_entries[entries].duration = track->cluster[i].cts;
-            ctts_entries[entries].count = 1;
         }
+        duration = cts;
+        count    = 1;
     }
-    entries++; /* last one */
-    atom_size = 16 + (entries * 8);
-    avio_wb32(pb, atom_size); /* size */
-    ffio_wfourcc(pb, "ctts");
-    avio_wb32(pb, 0); /* version & flags */
-    avio_wb32(pb, entries); /* entry count */
-    for (i = 0; i < entries; i++) {
-        avio_wb32(pb, ctts_entries[i].count);
-        avio_wb32(pb, ctts_entries[i].duration);
+    if (count) { /* last one */
+        avio_wb32(pb, count);
+        avio_wb32(pb, duration);
+        entries++;
     }
-    av_free(ctts_entries);
-    return atom_size;
+    curpos = avio_tell(pb);
+    avio_seek(pb, entryPos, SEEK_SET);
+    avio_wb32(pb, entries); // rewrite size
+    avio_seek(pb, curpos, SEEK_SET);
+    return update_size(pb, pos);
 }
 
 /* Time to sample atom */
 static int mov_write_stts_tag(AVIOContext *pb, MOVTrack *track)
 {
-    MOVStts *stts_entries = NULL;
-    uint32_t entries = -1;
-    uint32_t atom_size;
-    int i;
+    uint32_t entries = 0, count = 0;
+    int64_t entryPos, curpos;
+    int i, duration = 0;
 
+    int64_t pos = avio_tell(pb);
+    avio_wb32(pb, 0); /* size */
+    ffio_wfourcc(pb, "stts");
+    avio_wb32(pb, 0); /* version & flags */
+    entryPos = avio_tell(pb);
+    avio_wb32(pb, 0); /* entry count */
     if (track->enc->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr) {
-        stts_entries = av_malloc(sizeof(*stts_entries)); /* one entry */
-        if (!stts_entries)
-            return AVERROR(ENOMEM);
-        stts_entries[0].count = track->sample_count;
-        stts_entries[0].duration = 1;
+        avio_wb32(pb, track->sample_count);
+        avio_wb32(pb, 1);
         entries = 1;
     } else {
-        if (track->entry) {
-            stts_entries = av_malloc_array(track->entry, sizeof(*stts_entries)); /* worst case */
-            if (!stts_entries)
-                return AVERROR(ENOMEM);
-        }
         for (i = 0; i < track->entry; i++) {
-            int duration = get_cluster_duration(track, i);
-            if (i && duration == stts_entries[entries].duration) {
-                stts_entries[entries].count++; /* compress */
-            } else {
+            int sample_duration = get_cluster_duration(track, i);
+            if (count && sample_duration == duration) {
+                count++; /* compress */
+                continue;
+            }
+            if (count) {
+                avio_wb32(pb, count);
+                avio_wb32(pb, duration);
                 entries++;
-                stts_entries[entries].duration = duration;
-                stts_entries[entries].count = 1;
             }
+            duration = sample_duration;
+            count    = 1;
+        }
+        if (count) { /* last one */
+            avio_wb32(pb, count);
+            avio_wb32(pb, duration);
+            entries++;
         }
-        entries++; /* last one */
-    }
-    atom_size = 16 + (entries * 8);
-    avio_wb32(pb, atom_size); /* size */
-    ffio_wfourcc(pb, "stts");
-    avio_wb32(pb, 0); /* version & flags */
-    avio_wb32(pb, entries); /* entry count */
-    for (i = 0; i < entries; i++) {
-        avio_wb32(pb, stts_entries[i].count);
-        avio_wb32(pb, stts_entries[i].duration);
     }
-    av_free(stts_entries);
-    return atom_size;
+    curpos = avio_tell(pb);
+    avio_seek(pb, entryPos, SEEK_SET);
+    avio_wb32(pb, entries); // rewrite size
+    avio_seek(pb, curpos, SEEK_SET);
+    return update_size(pb, pos);
 }
 
 static int mov_write_dref_tag(AVIOContext *pb)
@@ -2424,14 +2549,15 @@ static int mov_write_edts_tag(AVIOContext *pb, MOVMuxContext *mov,
     int64_t start_dts = track->start_dts;
 
     if (track->entry) {
-        if (start_dts != track->cluster[0].dts || start_ct != track->cluster[0].cts) {
+        MOVIentry *first = get_cluster(track, 0);
+        if (start_dts != first->dts || start_ct != first->cts) {
 
             av_log(mov->fc, AV_LOG_DEBUG,
                    "EDTS using dts:%"PRId64" cts:%d instead of dts:%"PRId64" cts:%"PRId64" tid:%d\n",
-                   track->cluster[0].dts, track->cluster[0].cts,
+                   first->dts, first->cts,
                    start_dts, start_ct, track->track_id);
-            start_dts = track->cluster[0].dts;
-            start_ct  = track->cluster[0].cts;
+            start_dts = first->dts;
+            start_ct  = first->cts;
         }
     }
 
@@ -2611,7 +2737,7 @@ static int mov_write_trak_tag(AVIOContext *pb, MOVMuxContext *mov,
     if (track->start_dts != AV_NOPTS_VALUE) {
         if (mov->use_editlist)
             mov_write_edts_tag(pb, mov, track);  // PSP Movies and several other cases require edts box
-        else if ((track->entry && track->cluster[0].dts) || track->mode == MODE_PSP || is_clcp_track(track))
+        else if ((track->entry && get_cluster(track, 0)->dts) || track->mode == MODE_PSP || is_clcp_track(track))
             av_log(mov->fc, AV_LOG_WARNING,
                    "Not writing any edit list even though one would have been required\n");
     }
@@ -3149,21 +3275,25 @@ static int mov_write_uuidusmt_tag(AVIOContext *pb, AVFormatContext *s)
 
 static void build_chunks(MOVTrack *trk)
 {
-    int i;
-    MOVIentry *chunk = &trk->cluster[0];
+    int i, chunk_idx = 0;
+    MOVIentry *chunk = get_cluster_rw(trk, 0);
     uint64_t chunkSize = chunk->size;
     chunk->chunkNum = 1;
     if (trk->chunkCount)
         return;
     trk->chunkCount = 1;
     for (i = 1; i<trk->entry; i++){
-        if (chunk->pos + chunkSize == trk->cluster[i].pos &&
-            chunkSize + trk->cluster[i].size < (1<<20)){
-            chunkSize             += trk->cluster[i].size;
-            chunk->samples_in_chunk += trk->cluster[i].entries;
+        MOVIentry *e = get_cluster(trk, i);
+        chunk = get_cluster_rw(trk, chunk_idx);
+        if (chunk->pos + chunkSize == e->pos &&
+            chunkSize + e->size < (1<<20)){
+            chunkSize             += e->size;
+            chunk->samples_in_chunk += e->entries;
         } else {
-            trk->cluster[i].chunkNum = chunk->chunkNum+1;
-            chunk=&trk->cluster[i];
+            unsigned chunkNum = chunk->chunkNum;
+            chunk = get_cluster_rw(trk, i);
+            chunk->chunkNum = chunkNum+1;
+            chunk_idx = i;
             chunkSize = chunk->size;
             trk->chunkCount++;
         }
@@ -4046,7 +4176,7 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
                (entry && !trk->vc1_info.packet_entry)) {
         int i;
         for (i = 0; i < trk->entry; i++)
-            trk->cluster[i].flags &= ~MOV_SYNC_SAMPLE;
+            get_cluster_rw(trk, i)->flags &= ~MOV_SYNC_SAMPLE;
         trk->has_keyframes = 0;
         if (seq)
             trk->vc1_info.packet_seq = 1;
@@ -4058,7 +4188,7 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
                 (!entry || trk->vc1_info.first_packet_entry)) {
                 /* First packet had the same headers as this one, readd the
                  * sync sample flag. */
-                trk->cluster[0].flags |= MOV_SYNC_SAMPLE;
+                get_cluster_rw(trk, 0)->flags |= MOV_SYNC_SAMPLE;
                 trk->has_keyframes = 1;
             }
         }
@@ -4070,7 +4200,7 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
     else if (trk->vc1_info.packet_entry)
         key = entry;
     if (key) {
-        trk->cluster[trk->entry].flags |= MOV_SYNC_SAMPLE;
+        get_cluster_rw(trk, trk->entry)->flags |= MOV_SYNC_SAMPLE;
         trk->has_keyframes++;
     }
 }
@@ -4291,18 +4421,19 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     AVIOContext *pb = s->pb;
     MOVTrack *trk = &mov->tracks[pkt->stream_index];
     AVCodecContext *enc = trk->enc;
+    MOVIentry *sample;
     unsigned int samples_in_chunk = 0;
     int size = pkt->size, ret = 0;
     uint8_t *reformatted_data = NULL;
 
     if (trk->entry) {
-        int64_t duration = pkt->dts - trk->cluster[trk->entry - 1].dts;
+        int64_t duration = pkt->dts - get_cluster(trk, trk->entry - 1)->dts;
         if (duration < 0 || duration > INT_MAX) {
             av_log(s, AV_LOG_ERROR, "Application provided duration: %"PRId64" / timestamp: %"PRId64" is out of range for mov/mp4 format\n",
                 duration, pkt->dts
             );
 
-            pkt->dts = trk->cluster[trk->entry - 1].dts + 1;
+            pkt->dts = get_cluster(trk, trk->entry - 1)->dts + 1;
             pkt->pts = AV_NOPTS_VALUE;
         }
         if (pkt->duration < 0) {
@@ -4423,8 +4554,8 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         memcpy(trk->vos_data, pkt->data, size);
     }
 
-    if (trk->entry >= trk->cluster_capacity) {
-        unsigned new_capacity = 2 * (trk->entry + MOV_INDEX_CLUSTER_SIZE);
+    if (trk->entry - trk->cluster_first >= trk->cluster_capacity) {
+        unsigned new_capacity = 2 * (trk->entry - trk->cluster_first + MOV_INDEX_CLUSTER_SIZE);
         if (av_reallocp_array(&trk->cluster, new_capacity,
                               sizeof(*trk->cluster))) {
             ret = AVERROR(ENOMEM);
@@ -4432,27 +4563,28 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         }
         trk->cluster_capacity = new_capacity;
     }
+    sample = &trk->cluster[trk->entry - trk->cluster_first];
 
-    trk->cluster[trk->entry].pos              = avio_tell(pb) - size;
-    trk->cluster[trk->entry].samples_in_chunk = samples_in_chunk;
-    trk->cluster[trk->entry].chunkNum         = 0;
-    trk->cluster[trk->entry].size             = size;
-    trk->cluster[trk->entry].entries          = samples_in_chunk;
-    trk->cluster[trk->entry].dts              = pkt->dts;
+    sample->pos              = avio_tell(pb) - size;
+    sample->samples_in_chunk = samples_in_chunk;
+    sample->chunkNum         = 0;
+    sample->size             = size;
+    sample->entries          = samples_in_chunk;
+    sample->dts              = pkt->dts;
     if (!trk->entry && trk->start_dts != AV_NOPTS_VALUE) {
         if (!trk->frag_discont) {
             /* First packet of a new fragment. We already wrote the duration
              * of the last packet of the previous fragment based on track_duration,
              * which might not exactly match our dts. Therefore adjust the dts
              * of this packet to be what the previous packets duration implies. */
-            trk->cluster[trk->entry].dts = trk->start_dts + trk->track_duration;
+            sample->dts = trk->start_dts + trk->track_duration;
             /* We also may have written the pts and the corresponding duration
              * in sidx/tfrf/tfxd tags; make sure the sidx pts and duration match up with
              * the next fragment. This means the cts of the first sample must
              * be the same in all fragments. */
             if ((mov->flags & FF_MOV_FLAG_DASH && !(mov->flags & FF_MOV_FLAG_FASTSTART)) ||
                 mov->mode == MODE_ISM)
-                pkt->pts = pkt->dts + trk->end_pts - trk->cluster[trk->entry].dts;
+                pkt->pts = pkt->dts + trk->end_pts - sample->dts;
         } else {
             /* New fragment, but discontinuous from previous fragments.
              * Pretend the duration sum of the earlier fragments is
@@ -4470,7 +4602,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
          * to signal the difference in starting time without an edit list.
          * Thus move the timestamp for this first sample to 0, increasing
          * its duration instead. */
-        trk->cluster[trk->entry].dts = trk->start_dts = 0;
+        sample->dts = trk->start_dts = 0;
     }
     if (trk->start_dts == AV_NOPTS_VALUE) {
         trk->start_dts = pkt->dts;
@@ -4496,16 +4628,16 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     }
     if (pkt->dts != pkt->pts)
         trk->flags |= MOV_TRACK_CTTS;
-    trk->cluster[trk->entry].cts   = pkt->pts - pkt->dts;
-    trk->cluster[trk->entry].flags = 0;
+    sample->cts   = pkt->pts - pkt->dts;
+    sample->flags = 0;
     if (trk->start_cts == AV_NOPTS_VALUE)
         trk->start_cts = pkt->pts - pkt->dts;
     if (trk->end_pts == AV_NOPTS_VALUE)
-        trk->end_pts = trk->cluster[trk->entry].dts +
-                       trk->cluster[trk->entry].cts + pkt->duration;
+        trk->end_pts = sample->dts +
+                       sample->cts + pkt->duration;
     else
-        trk->end_pts = FFMAX(trk->end_pts, trk->cluster[trk->entry].dts +
-                                           trk->cluster[trk->entry].cts +
+        trk->end_pts = FFMAX(trk->end_pts, sample->dts +
+                                           sample->cts +
                                            pkt->duration);
 
     if (enc->codec_id == AV_CODEC_ID_VC1) {
@@ -4513,19 +4645,27 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     } else if (pkt->flags & AV_PKT_FLAG_KEY) {
         if (mov->mode == MODE_MOV && enc->codec_id == AV_CODEC_ID_MPEG2VIDEO &&
             trk->entry > 0) { // force sync sample for the first key frame
-            mov_parse_mpeg2_frame(pkt, &trk->cluster[trk->entry].flags);
-            if (trk->cluster[trk->entry].flags & MOV_PARTIAL_SYNC_SAMPLE)
+            mov_parse_mpeg2_frame(pkt, &sample->flags);
+            if (sample->flags & MOV_PARTIAL_SYNC_SAMPLE)
                 trk->flags |= MOV_TRACK_STPS;
         } else {
-            trk->cluster[trk->entry].flags = MOV_SYNC_SAMPLE;
+            sample->flags = MOV_SYNC_SAMPLE;
         }
-        if (trk->cluster[trk->entry].flags & MOV_SYNC_SAMPLE)
+        if (sample->flags & MOV_SYNC_SAMPLE)
             trk->has_keyframes++;
     }
     trk->entry++;
     trk->sample_count += samples_in_chunk;
     mov->mdat_size    += size;
 
+    if (mov->max_table_entries && !(mov->flags & FF_MOV_FLAG_FRAGMENT)) {
+        if (!trk->spill_block_size)
+            trk->spill_block_size = FFMIN(mov->max_table_entries, MOV_SPILL_BLOCK_SIZE);
+        if (trk->entry - trk->cluster_first - trk->spill_block_size >= mov->max_table_entries &&
+            (ret = mov_spill_entries(s, trk)) < 0)
+            goto err;
+    }
+
     if (trk->hint_track >= 0 && trk->hint_track < mov->nb_streams)
         ff_mov_add_hinted_packet(s, pkt, trk->hint_track, trk->entry,
                                  reformatted_data, size);
@@ -4859,6 +4999,7 @@ static void mov_free(AVFormatContext *s)
         else if (mov->tracks[i].tag == MKTAG('t','m','c','d') && mov->nb_meta_tmcd)
             av_freep(&mov->tracks[i].enc);
         av_freep(&mov->tracks[i].cluster);
+        mov_free_spill(&mov->tracks[i]);
         av_freep(&mov->tracks[i].frag_info);
 
         if (mov->tracks[i].vos_len)
@@ -5516,6 +5657,13 @@ static int mov_write_trailer(AVFormatContext *s)
                 goto error;
         }
         res = 0;
+        for (i = 0; i < mov->nb_streams; i++) {
+            if ((res = mov->tracks[i].spill_error) < 0) {
+                av_log(s, AV_LOG_ERROR, "Error reading back spilled index entries: %s\n",
+                       av_err2str(res));
+                goto error;
+            }
+        }
     } else {
         mov_auto_flush_fragment(s);
         for (i = 0; i < mov->nb_streams; i++)
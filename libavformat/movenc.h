@@ -28,6 +28,7 @@
 
 #define MOV_FRAG_INFO_ALLOC_INCREMENT 64
 #define MOV_INDEX_CLUSTER_SIZE 1024
+#define MOV_SPILL_BLOCK_SIZE   4096 ///< maximum number of index entries spilled to disk at once
 #define MOV_TIMESCALE 1000
 
 #define RTP_MAX_PACKET_SIZE 1450
@@ -55,6 +56,12 @@ typedef struct MOVIentry {
     uint32_t     flags;
 } MOVIentry;
 
+typedef struct MOVSpillBlock {
+    MOVIentry *entries;                 ///< spill_block_size entries read back from the spill file
+    int        index;                   ///< block number in the spill file
+    int        dirty;                   ///< entries were modified and must be written back
+} MOVSpillBlock;
+
 typedef struct HintSample {
     uint8_t *data;
     int size;
@@ -107,6 +114,12 @@ typedef struct MOVTrack {
     uint8_t     *vos_data;
     MOVIentry   *cluster;
     unsigned    cluster_capacity;
+    int         cluster_first;     ///< number of the entry in cluster[0], the ones before are spilled
+    int         spill_fd;          ///< temporary file holding the spilled entries, valid if cluster_first > 0
+    int         spill_block_size;  ///< number of entries spilled at once, at most max_table_entries
+    MOVSpillBlock spill_cache[2];  ///< most recently used spilled blocks, the first one being the newest
+    int         spill_error;
+    MOVIentry   spill_dummy;       ///< returned instead of spilled entries which could not be read back
     int         audio_vbr;
     int         height; ///< active picture (w/o VBI) height for D-10/IMX
     uint32_t    tref_tag;
@@ -194,6 +207,8 @@ typedef struct MOVMuxContext {
 
     int frag_interleave;
     int missing_duration_warned;
+
+    int max_table_entries; ///< index entries kept in memory per track before spilling, 0 for unlimited
 } MOVMuxContext;
 
 #define FF_MOV_FLAG_RTP_HINT              (1 <<  0)
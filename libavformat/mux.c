@@ -705,18 +705,12 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
 
 #define CHUNK_START 0x1000
 
-int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
-                             int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
+/**
+ * Move the content of pkt to dst, which is to be queued by the interleaver.
+ */
+static int take_packet(AVPacket *dst, AVPacket *pkt)
 {
-    int ret;
-    AVPacketList **next_point, *this_pktl;
-    AVStream *st   = s->streams[pkt->stream_index];
-    int chunked    = s->max_chunk_size || s->max_chunk_duration;
-
-    this_pktl      = av_mallocz(sizeof(AVPacketList));
-    if (!this_pktl)
-        return AVERROR(ENOMEM);
-    this_pktl->pkt = *pkt;
+    *dst = *pkt;
 #if FF_API_DESTRUCT_PACKET
 FF_DISABLE_DEPRECATION_WARNINGS
     pkt->destruct  = NULL;           // do not free original but only the copy
@@ -728,12 +722,26 @@ FF_ENABLE_DEPRECATION_WARNINGS
     if ((pkt->flags & AV_PKT_FLAG_UNCODED_FRAME)) {
         av_assert0(pkt->size == UNCODED_FRAME_PACKET_SIZE);
         av_assert0(((AVFrame *)pkt->data)->buf);
-    } else {
-        // Duplicate the packet if it uses non-allocated memory
-        if ((ret = av_dup_packet(&this_pktl->pkt)) < 0) {
-            av_free(this_pktl);
-            return ret;
-        }
+        return 0;
+    }
+    // Duplicate the packet if it uses non-allocated memory
+    return av_dup_packet(dst);
+}
+
+int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
+                             int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
+{
+    int ret;
+    AVPacketList **next_point, *this_pktl;
+    AVStream *st   = s->streams[pkt->stream_index];
+    int chunked    = s->max_chunk_size || s->max_chunk_duration;
+
+    this_pktl      = av_mallocz(sizeof(AVPacketList));
+    if (!this_pktl)
+        return AVERROR(ENOMEM);
+    if ((ret = take_packet(&this_pktl->pkt, pkt)) < 0) {
+        av_free(this_pktl);
+        return ret;
     }
 
     if (s->streams[pkt->stream_index]->last_in_packet_buffer) {
@@ -810,8 +818,8 @@ static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
     return comp > 0;
 }
 
-int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
-                                 AVPacket *pkt, int flush)
+static int interleave_packet_per_dts_list(AVFormatContext *s, AVPacket *out,
+                                          AVPacket *pkt, int flush)
 {
     AVPacketList *pktl;
     int stream_count = 0;
@@ -890,6 +898,221 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
     }
 }
 
+typedef struct InterleaveQueue {
+    AVPacketList *first, *last;
+} InterleaveQueue;
+
+static int interleave_heap_less(AVFormatContext *s, int a, int b)
+{
+    InterleaveQueue *q = s->internal->interleave_queues;
+    return interleave_compare_dts(s, &q[b].first->pkt, &q[a].first->pkt);
+}
+
+static void interleave_heap_push(AVFormatContext *s, int stream_index)
+{
+    int *heap = s->internal->interleave_heap;
+    int i     = s->internal->interleave_heap_size++;
+
+    heap[i] = stream_index;
+    while (i > 0 && interleave_heap_less(s, heap[i], heap[(i - 1) / 2])) {
+        FFSWAP(int, heap[i], heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+}
+
+static void interleave_heap_sift_down(AVFormatContext *s)
+{
+    int *heap = s->internal->interleave_heap;
+    int size  = s->internal->interleave_heap_size;
+    int i = 0;
+
+    for (;;) {
+        int min = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < size && interleave_heap_less(s, heap[l], heap[min]))
+            min = l;
+        if (r < size && interleave_heap_less(s, heap[r], heap[min]))
+            min = r;
+        if (min == i)
+            break;
+        FFSWAP(int, heap[i], heap[min]);
+        i = min;
+    }
+}
+
+static int interleave_queues_alloc(AVFormatContext *s, int stream_index)
+{
+    AVFormatInternal *internal = s->internal;
+    InterleaveQueue *queues;
+    int *heap;
+    int nb = FFMAX(s->nb_streams, stream_index + 1);
+
+    if (stream_index < internal->nb_interleave_queues)
+        return 0;
+
+    queues = av_realloc_array(internal->interleave_queues, nb, sizeof(*queues));
+    if (!queues)
+        return AVERROR(ENOMEM);
+    internal->interleave_queues = queues;
+    heap = av_realloc_array(internal->interleave_heap, nb, sizeof(*heap));
+    if (!heap)
+        return AVERROR(ENOMEM);
+    internal->interleave_heap = heap;
+
+    memset(queues + internal->nb_interleave_queues, 0,
+           (nb - internal->nb_interleave_queues) * sizeof(*queues));
+    internal->nb_interleave_queues = nb;
+    return 0;
+}
+
+static int interleave_queue_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    AVFormatInternal *internal = s->internal;
+    InterleaveQueue *q;
+    AVPacketList *pktl;
+    int ret;
+
+    if ((ret = interleave_queues_alloc(s, pkt->stream_index)) < 0)
+        return ret;
+
+    pktl = internal->interleave_free_list;
+    if (pktl)
+        internal->interleave_free_list = pktl->next;
+    else if (!(pktl = av_malloc(sizeof(*pktl))))
+        return AVERROR(ENOMEM);
+    if ((ret = take_packet(&pktl->pkt, pkt)) < 0) {
+        pktl->next = internal->interleave_free_list;
+        internal->interleave_free_list = pktl;
+        return ret;
+    }
+    pktl->next = NULL;
+
+    q = &internal->interleave_queues[pkt->stream_index];
+    if (q->last) {
+        q->last->next = pktl;
+        q->last       = pktl;
+    } else {
+        q->first = q->last = pktl;
+        interleave_heap_push(s, pkt->stream_index);
+    }
+    return 0;
+}
+
+/**
+ * Same as interleave_packet_per_dts_list(), but the packets are kept in
+ * one queue per stream, so that adding a packet does not depend on the
+ * number of buffered packets, and the next packet is found through a heap
+ * of the streams ordered by the dts of their first packet.
+ */
+int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
+                                 AVPacket *pkt, int flush)
+{
+    AVFormatInternal *internal = s->internal;
+    InterleaveQueue *q;
+    AVPacketList *pktl;
+    int stream_count, i, ret;
+
+    /* Chunked interleaving, and packets queued by ff_interleave_add_packet()
+     * with a muxer specific comparison, need the single sorted list. The
+     * latter is the case of mxf and gxf, which queue their packets directly
+     * or through ff_audio_rechunk_interleave(), so they do not use the
+     * per-stream queues. */
+    if (s->max_chunk_size || s->max_chunk_duration || internal->packet_buffer)
+        return interleave_packet_per_dts_list(s, out, pkt, flush);
+
+    if (pkt) {
+        if ((ret = interleave_queue_packet(s, pkt)) < 0)
+            return ret;
+    }
+
+    stream_count = internal->interleave_heap_size;
+    if (internal->nb_interleaved_streams == stream_count)
+        flush = 1;
+
+    if (s->max_interleave_delta > 0 && stream_count && !flush) {
+        int noninterleaved_count = 0;
+
+        for (i = 0; i < s->nb_streams; i++) {
+            if ((i >= internal->nb_interleave_queues || !internal->interleave_queues[i].first) &&
+                s->streams[i]->codec->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+                s->streams[i]->codec->codec_id != AV_CODEC_ID_VP8 &&
+                s->streams[i]->codec->codec_id != AV_CODEC_ID_VP9)
+                ++noninterleaved_count;
+        }
+
+        if (internal->nb_interleaved_streams == stream_count + noninterleaved_count) {
+            AVPacket *top_pkt = &internal->interleave_queues[internal->interleave_heap[0]].first->pkt;
+            int64_t delta_dts = INT64_MIN;
+            int64_t top_dts = av_rescale_q(top_pkt->dts,
+                                           s->streams[top_pkt->stream_index]->time_base,
+                                           AV_TIME_BASE_Q);
+
+            for (i = 0; i < stream_count; i++) {
+                int idx = internal->interleave_heap[i];
+                int64_t last_dts = av_rescale_q(internal->interleave_queues[idx].last->pkt.dts,
+                                                s->streams[idx]->time_base,
+                                                AV_TIME_BASE_Q);
+                delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+            }
+
+            if (delta_dts > s->max_interleave_delta) {
+                av_log(s, AV_LOG_DEBUG,
+                       "Delay between the first packet and last packet in the "
+                       "muxing queue is %"PRId64" > %"PRId64": forcing output\n",
+                       delta_dts, s->max_interleave_delta);
+                flush = 1;
+            }
+        }
+    }
+
+    if (stream_count && flush) {
+        q    = &internal->interleave_queues[internal->interleave_heap[0]];
+        pktl = q->first;
+        *out = pktl->pkt;
+
+        q->first = pktl->next;
+        if (!q->first) {
+            q->last = NULL;
+            internal->interleave_heap[0] = internal->interleave_heap[--internal->interleave_heap_size];
+        }
+        interleave_heap_sift_down(s);
+
+        pktl->next = internal->interleave_free_list;
+        internal->interleave_free_list = pktl;
+
+        return 1;
+    } else {
+        av_init_packet(out);
+        return 0;
+    }
+}
+
+void ff_interleave_queues_free(AVFormatContext *s)
+{
+    AVFormatInternal *internal = s->internal;
+    AVPacketList *pktl;
+    int i;
+
+    if (!internal)
+        return;
+
+    for (i = 0; i < internal->nb_interleave_queues; i++) {
+        InterleaveQueue *q = &internal->interleave_queues[i];
+        while ((pktl = q->first)) {
+            q->first = pktl->next;
+            av_free_packet(&pktl->pkt);
+            av_free(pktl);
+        }
+    }
+    while ((pktl = internal->interleave_free_list)) {
+        internal->interleave_free_list = pktl->next;
+        av_free(pktl);
+    }
+    av_freep(&internal->interleave_queues);
+    av_freep(&internal->interleave_heap);
+    internal->nb_interleave_queues = 0;
+    internal->interleave_heap_size = 0;
+}
+
 /**
  * Interleave an AVPacket correctly so it can be muxed.
  * @param out the interleaved packet will be output here
@@ -78,6 +78,8 @@ int main(int argc, char **argv)
             duration = atoi(argv[i+1]);
         } else if(!strcmp(argv[i], "-usetoc")) {
             av_dict_set(&format_opts, "usetoc", argv[i+1], 0);
+        } else if(!strcmp(argv[i], "-compact_index")) {
+            av_dict_set(&format_opts, "compact_index", argv[i+1], 0);
         } else {
             argc = 1;
         }
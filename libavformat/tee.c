@@ -20,13 +20,26 @@
  */
 
 
+#include "config.h"
+#include "libavutil/atomic.h"
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/threadmessage.h"
 #include "avformat.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #define MAX_SLAVES 16
 
+enum QueueFullPolicy {
+    QUEUE_FULL_BLOCK,
+    QUEUE_FULL_DROP_SLAVE,
+    QUEUE_FULL_DROP_NONKEY,
+};
+
 typedef struct {
     AVFormatContext *avf;
     AVBitStreamFilterContext **bsfs; ///< bitstream filters per stream
@@ -34,12 +47,27 @@ typedef struct {
     /** map from input to output streams indexes,
      * disabled output streams are set to -1 */
     int *stream_map;
+
+    /** packets waiting to be written by the slave thread, if asynchronous */
+    AVThreadMessageQueue *queue;
+#if HAVE_PTHREADS
+    pthread_t thread;
+#endif
+    /** set when the slave has been dropped because its queue was full */
+    volatile int dropped;
+    /** per output stream, set when packets are dropped until a keyframe */
+    uint8_t *wait_keyframe;
+    int64_t nb_dropped_packets;
+    /** error which stopped the slave thread */
+    int error;
 } TeeSlave;
 
 typedef struct TeeContext {
     const AVClass *class;
     unsigned nb_slaves;
     TeeSlave slaves[MAX_SLAVES];
+    int queue_size;
+    int queue_full;
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -48,12 +76,36 @@ static const char *const slave_opt_close = "]";
 static const char *const slave_opt_delim = ":]"; /* must have the close too */
 static const char *const slave_bsfs_spec_sep = "/";
 
+#define OFFSET(x) offsetof(TeeContext, x)
+#define E AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption options[] = {
+    { "queue_size", "write each slave from its own thread, through a queue of this many packets",
+      OFFSET(queue_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, E },
+    { "queue_full", "set what to do when the queue of a slave is full",
+      OFFSET(queue_full), AV_OPT_TYPE_INT, { .i64 = QUEUE_FULL_BLOCK },
+      0, QUEUE_FULL_DROP_NONKEY, E, "queue_full" },
+    { "block",       "wait for the slave",                    0, AV_OPT_TYPE_CONST,
+      { .i64 = QUEUE_FULL_BLOCK },       0, 0, E, "queue_full" },
+    { "drop_slave",  "stop writing to the slave",             0, AV_OPT_TYPE_CONST,
+      { .i64 = QUEUE_FULL_DROP_SLAVE },  0, 0, E, "queue_full" },
+    { "drop_nonkey", "drop packets up to the next keyframe",  0, AV_OPT_TYPE_CONST,
+      { .i64 = QUEUE_FULL_DROP_NONKEY }, 0, 0, E, "queue_full" },
+    { NULL }
+};
+
 static const AVClass tee_muxer_class = {
     .class_name = "Tee muxer",
     .item_name  = av_default_item_name,
+    .option     = options,
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+static int slave_interrupt_cb(void *opaque)
+{
+    TeeSlave *tee_slave = opaque;
+    return avpriv_atomic_int_get(&tee_slave->dropped);
+}
+
 static int parse_slave_options(void *log, char *slave,
                                AVDictionary **options, char **filename)
 {
@@ -134,6 +186,7 @@ end:
 
 static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
 {
+    TeeContext *tee = avf->priv_data;
     int i, ret;
     AVDictionary *options = NULL;
     AVDictionaryEntry *entry;
@@ -161,6 +214,11 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     if (ret < 0)
         goto end;
     av_dict_copy(&avf2->metadata, avf->metadata, 0);
+    if (tee->queue_size && tee->queue_full == QUEUE_FULL_DROP_SLAVE) {
+        /* a dropped slave must not stay stuck in a write */
+        avf2->interrupt_callback.callback = slave_interrupt_cb;
+        avf2->interrupt_callback.opaque   = tee_slave;
+    }
 
     tee_slave->stream_map = av_calloc(avf->nb_streams, sizeof(*tee_slave->stream_map));
     if (!tee_slave->stream_map) {
@@ -206,7 +264,8 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     }
 
     if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
-        if ((ret = avio_open(&avf2->pb, filename, AVIO_FLAG_WRITE)) < 0) {
+        if ((ret = avio_open2(&avf2->pb, filename, AVIO_FLAG_WRITE,
+                              &avf2->interrupt_callback, NULL)) < 0) {
             av_log(avf, AV_LOG_ERROR, "Slave '%s': error opening: %s\n",
                    slave, av_err2str(ret));
             goto end;
@@ -285,6 +344,76 @@ end:
     return ret;
 }
 
+#if HAVE_PTHREADS
+static void *slave_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    AVPacket pkt;
+    int ret;
+
+    while ((ret = av_thread_message_queue_recv(tee_slave->queue, &pkt, 0)) >= 0) {
+        if (avpriv_atomic_int_get(&tee_slave->dropped)) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        if ((ret = av_interleaved_write_frame(tee_slave->avf, &pkt)) < 0)
+            break;
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+    tee_slave->error = ret;
+    /* make the next attempt to queue a packet fail */
+    av_thread_message_queue_set_err_send(tee_slave->queue,
+                                         ret < 0 ? ret : AVERROR_EOF);
+    return NULL;
+}
+#endif
+
+static int start_slave_thread(AVFormatContext *avf, TeeSlave *tee_slave)
+{
+#if HAVE_PTHREADS
+    TeeContext *tee = avf->priv_data;
+    int ret;
+
+    if (tee->queue_full == QUEUE_FULL_DROP_NONKEY) {
+        tee_slave->wait_keyframe = av_mallocz(tee_slave->avf->nb_streams);
+        if (!tee_slave->wait_keyframe)
+            return AVERROR(ENOMEM);
+    }
+    ret = av_thread_message_queue_alloc2(&tee_slave->queue, tee->queue_size,
+                                         sizeof(AVPacket),
+                                         AV_THREAD_MESSAGE_QUEUE_SPSC);
+    if (ret < 0)
+        return ret;
+    if ((ret = pthread_create(&tee_slave->thread, NULL, slave_thread, tee_slave))) {
+        av_log(avf, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        av_thread_message_queue_free(&tee_slave->queue);
+        return AVERROR(ret);
+    }
+    return 0;
+#else
+    av_log(avf, AV_LOG_ERROR, "Slave queues require threading support\n");
+    return AVERROR(ENOSYS);
+#endif
+}
+
+/* Wait for the slave thread to write the queued packets and exit. */
+static void stop_slave_thread(TeeSlave *tee_slave)
+{
+#if HAVE_PTHREADS
+    AVPacket pkt;
+
+    if (!tee_slave->queue)
+        return;
+    av_thread_message_queue_set_err_recv(tee_slave->queue, AVERROR_EOF);
+    pthread_join(tee_slave->thread, NULL);
+    while (av_thread_message_queue_recv(tee_slave->queue, &pkt,
+                                        AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+        av_free_packet(&pkt);
+    av_thread_message_queue_free(&tee_slave->queue);
+#endif
+}
+
 static void close_slaves(AVFormatContext *avf)
 {
     TeeContext *tee = avf->priv_data;
@@ -292,6 +421,7 @@ static void close_slaves(AVFormatContext *avf)
     unsigned i, j;
 
     for (i = 0; i < tee->nb_slaves; i++) {
+        stop_slave_thread(&tee->slaves[i]);
         avf2 = tee->slaves[i].avf;
 
         for (j = 0; j < avf2->nb_streams; j++) {
@@ -304,6 +434,7 @@ static void close_slaves(AVFormatContext *avf)
         }
         av_freep(&tee->slaves[i].stream_map);
         av_freep(&tee->slaves[i].bsfs);
+        av_freep(&tee->slaves[i].wait_keyframe);
 
         avio_closep(&avf2->pb);
         avformat_free_context(avf2);
@@ -375,6 +506,12 @@ static int tee_write_header(AVFormatContext *avf)
             av_log(avf, AV_LOG_WARNING, "Input stream #%d is not mapped "
                    "to any slave.\n", i);
     }
+
+    if (tee->queue_size) {
+        for (i = 0; i < tee->nb_slaves; i++)
+            if ((ret = start_slave_thread(avf, &tee->slaves[i])) < 0)
+                goto fail;
+    }
     return 0;
 
 fail:
@@ -431,10 +568,21 @@ static int tee_write_trailer(AVFormatContext *avf)
     unsigned i;
 
     for (i = 0; i < tee->nb_slaves; i++) {
-        avf2 = tee->slaves[i].avf;
-        if ((ret = av_write_trailer(avf2)) < 0)
-            if (!ret_all)
-                ret_all = ret;
+        TeeSlave *tee_slave = &tee->slaves[i];
+
+        avf2 = tee_slave->avf;
+        stop_slave_thread(tee_slave);
+        if (tee_slave->nb_dropped_packets)
+            av_log(avf, AV_LOG_WARNING, "%"PRId64" packets dropped for slave '%s'\n",
+                   tee_slave->nb_dropped_packets, avf2->filename);
+        /* a dropped slave is left incomplete */
+        if (!tee_slave->dropped) {
+            if (tee_slave->error < 0 && !ret_all)
+                ret_all = tee_slave->error;
+            if ((ret = av_write_trailer(avf2)) < 0)
+                if (!ret_all)
+                    ret_all = ret;
+        }
         if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
             if ((ret = avio_closep(&avf2->pb)) < 0)
                 if (!ret_all)
@@ -445,6 +593,48 @@ static int tee_write_trailer(AVFormatContext *avf)
     return ret_all;
 }
 
+/* Queue a packet for the slave thread, applying the queue_full policy.
+ * The packet is always consumed. */
+static int queue_packet(AVFormatContext *avf, TeeSlave *tee_slave, AVPacket *pkt)
+{
+    TeeContext *tee = avf->priv_data;
+    int key = pkt->flags & AV_PKT_FLAG_KEY;
+    int ret;
+
+    if (tee_slave->dropped)
+        goto drop;
+    if (tee_slave->wait_keyframe && tee_slave->wait_keyframe[pkt->stream_index]) {
+        if (!key)
+            goto drop;
+        tee_slave->wait_keyframe[pkt->stream_index] = 0;
+    }
+
+    ret = av_thread_message_queue_send(tee_slave->queue, pkt,
+                                       tee->queue_full == QUEUE_FULL_BLOCK ?
+                                       0 : AV_THREAD_MESSAGE_NONBLOCK);
+    if (ret == AVERROR(EAGAIN)) {
+        if (tee->queue_full == QUEUE_FULL_DROP_SLAVE) {
+            av_log(avf, AV_LOG_WARNING, "Queue of slave '%s' is full, "
+                   "dropping it\n", tee_slave->avf->filename);
+            avpriv_atomic_int_set(&tee_slave->dropped, 1);
+            goto drop;
+        }
+        if (!key) {
+            tee_slave->wait_keyframe[pkt->stream_index] = 1;
+            goto drop;
+        }
+        ret = av_thread_message_queue_send(tee_slave->queue, pkt, 0);
+    }
+    if (ret < 0)
+        av_free_packet(pkt);
+    return ret;
+
+drop:
+    tee_slave->nb_dropped_packets++;
+    av_free_packet(pkt);
+    return 0;
+}
+
 static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
@@ -476,7 +666,11 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
         pkt2.stream_index = s2;
 
         filter_packet(avf2, &pkt2, avf2, tee->slaves[i].bsfs[s2]);
-        if ((ret = av_interleaved_write_frame(avf2, &pkt2)) < 0)
+        if (tee->slaves[i].queue)
+            ret = queue_packet(avf, &tee->slaves[i], &pkt2);
+        else
+            ret = av_interleaved_write_frame(avf2, &pkt2);
+        if (ret < 0)
             if (!ret_all)
                 ret_all = ret;
     }
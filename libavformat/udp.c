@@ -25,9 +25,11 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
+#include "libavutil/atomic.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
@@ -70,6 +72,7 @@
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_DEFAULT_BATCH_SIZE 16
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -96,9 +99,23 @@ typedef struct UDPContext {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     int thread_started;
+    /* The receiving thread and udp_read() only share the number of bytes
+     * in the fifo; the mutex is only taken to wake up a waiting reader. */
+    volatile int circular_buffer_fill;
+    volatile int reader_waiting;
 #endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
+
+    /* Datagrams received or sent with a single system call */
+    int batch_size;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+    uint8_t *batch_buf;
+    int batch_slot_size;
+    int nb_queued;         ///< number of datagrams waiting to be sent
+#endif
     char *localaddr;
     int timeout;
     struct sockaddr_storage local_addr_storage;
@@ -123,6 +140,7 @@ static const AVOption options[] = {
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_INT,    { .i64 =  0 },     0, 1,       .flags = D|E },
     { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1,    D },
+    { "batch_size",     "set the maximum number of datagrams received or sent per system call (-1 for automatic)", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 1024, D|E },
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -150,6 +168,74 @@ static void log_net_error(void *ctx, int level, const char* prefix)
     av_log(ctx, level, "%s: %s\n", prefix, errbuf);
 }
 
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+/**
+ * Allocate batch_size datagram slots of slot_size bytes, the data of each
+ * datagram being stored after the first prefix bytes of its slot.
+ */
+static int udp_alloc_batch(UDPContext *s, int slot_size, int prefix)
+{
+    int i;
+
+    s->batch_buf = av_malloc_array(s->batch_size, slot_size);
+    s->msgs      = av_mallocz_array(s->batch_size, sizeof(*s->msgs));
+    s->iovs      = av_mallocz_array(s->batch_size, sizeof(*s->iovs));
+    if (!s->batch_buf || !s->msgs || !s->iovs)
+        return AVERROR(ENOMEM);
+
+    s->batch_slot_size = slot_size;
+    for (i = 0; i < s->batch_size; i++) {
+        s->iovs[i].iov_base = s->batch_buf + i * slot_size + prefix;
+        s->iovs[i].iov_len  = slot_size - prefix;
+        s->msgs[i].msg_hdr.msg_iov    = &s->iovs[i];
+        s->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+#endif
+
+static void udp_free_batch(UDPContext *s)
+{
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->batch_buf);
+    av_freep(&s->msgs);
+    av_freep(&s->iovs);
+#endif
+}
+
+/**
+ * Send the datagrams queued by udp_write().
+ */
+static int udp_flush_batch(URLContext *h)
+{
+    int ret = 0;
+#if HAVE_SENDMMSG
+    UDPContext *s = h->priv_data;
+    int i, sent = 0;
+
+    for (i = 0; i < s->nb_queued; i++) {
+        s->msgs[i].msg_hdr.msg_name    = s->is_connected ? NULL : &s->dest_addr;
+        s->msgs[i].msg_hdr.msg_namelen = s->is_connected ? 0    : s->dest_addr_len;
+    }
+    while (sent < s->nb_queued) {
+        ret = ff_network_wait_fd_timeout(s->udp_fd, 1, h->rw_timeout,
+                                         &h->interrupt_callback);
+        if (ret < 0)
+            break;
+        ret = sendmmsg(s->udp_fd, s->msgs + sent, s->nb_queued - sent, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR(EINTR))
+                continue;
+            break;
+        }
+        sent += ret;
+    }
+    s->nb_queued = 0;
+#endif
+    return ret < 0 ? ret : 0;
+}
+
 static int udp_set_multicast_ttl(int sockfd, int mcastTTL,
                                  struct sockaddr *addr)
 {
@@ -424,9 +510,13 @@ int ff_udp_set_remote_url(URLContext *h, const char *uri)
 {
     UDPContext *s = h->priv_data;
     char hostname[256], buf[10];
-    int port;
+    int port, ret;
     const char *p;
 
+    /* the queued datagrams are meant for the previous destination */
+    if ((ret = udp_flush_batch(h)) < 0)
+        return ret;
+
     av_url_split(NULL, 0, NULL, 0, hostname, sizeof(hostname), &port, NULL, 0, uri);
 
     /* set the destination address */
@@ -477,6 +567,37 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/**
+ * Receive one or more datagrams, each one being stored after a 4 byte
+ * prefix holding its size, and return their number.
+ */
+static int udp_recv_batch(UDPContext *s)
+{
+    int len;
+#if HAVE_RECVMMSG
+    if (s->batch_buf) {
+        int i, n = recvmmsg(s->udp_fd, s->msgs, s->batch_size, MSG_WAITFORONE, NULL);
+        for (i = 0; i < n; i++)
+            AV_WL32(s->batch_buf + i * s->batch_slot_size, s->msgs[i].msg_len);
+        return n;
+    }
+#endif
+    len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+    if (len < 0)
+        return len;
+    AV_WL32(s->tmp, len);
+    return 1;
+}
+
+static uint8_t *udp_batch_slot(UDPContext *s, int i)
+{
+#if HAVE_RECVMMSG
+    if (s->batch_buf)
+        return s->batch_buf + i * s->batch_slot_size;
+#endif
+    return s->tmp;
+}
+
 static void *circular_buffer_task( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -484,51 +605,67 @@ static void *circular_buffer_task( void *_URLContext)
     int old_cancelstate;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        avpriv_atomic_int_set(&s->circular_buffer_error, AVERROR(EIO));
         goto end;
     }
     while(1) {
-        int len;
+        int n, i, fill, size = 0, err = 0;
 
-        pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+        n = udp_recv_batch(s);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
+        if (n < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+                avpriv_atomic_int_set(&s->circular_buffer_error, ff_neterrno());
                 goto end;
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+        fill = avpriv_atomic_int_get(&s->circular_buffer_fill);
+        for (i = 0; i < n; i++) {
+            uint8_t *dg = udp_batch_slot(s, i);
+            int len = AV_RL32(dg);
+
+            if (s->circular_buffer_size - fill - size < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    err = AVERROR(EIO);
+                    break;
+                }
             }
+            av_fifo_generic_write(s->fifo, dg, len+4, NULL);
+            size += len + 4;
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
+        if (err)
+            avpriv_atomic_int_set(&s->circular_buffer_error, err);
+        if (size) {
+            /* publishes the datagrams, a full barrier */
+            avpriv_atomic_int_add_and_fetch(&s->circular_buffer_fill, size);
+            if (avpriv_atomic_int_get(&s->reader_waiting)) {
+                pthread_mutex_lock(&s->mutex);
+                pthread_cond_signal(&s->cond);
+                pthread_mutex_unlock(&s->mutex);
+            }
+        }
+        if (err)
+            goto end;
     }
 
 end:
+    pthread_mutex_lock(&s->mutex);
     pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->mutex);
     return NULL;
@@ -656,6 +793,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         }
         if (!is_output && av_find_info_tag(buf, sizeof(buf), "timeout", p))
             s->timeout = strtol(buf, NULL, 10);
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p))
+            s->batch_size = strtol(buf, NULL, 10);
         if (is_output && av_find_info_tag(buf, sizeof(buf), "broadcast", p))
             s->is_broadcast = strtol(buf, NULL, 10);
     }
@@ -811,10 +950,26 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+    /* Sending datagrams in batches delays them, so it is only done on request */
+    if (s->batch_size < 0)
+        s->batch_size = is_output ? 1 : UDP_DEFAULT_BATCH_SIZE;
+#if HAVE_SENDMMSG
+    if (is_output && s->batch_size > 1 && !(h->flags & AVIO_FLAG_NONBLOCK) &&
+        h->max_packet_size > 0 && h->max_packet_size <= UDP_MAX_PKT_SIZE) {
+        if (udp_alloc_batch(s, h->max_packet_size, 0) < 0)
+            goto fail;
+    }
+#endif
+
 #if HAVE_PTHREAD_CANCEL
     if (!is_output && s->circular_buffer_size) {
         int ret;
 
+#if HAVE_RECVMMSG
+        if (s->batch_size > 1 && udp_alloc_batch(s, UDP_MAX_PKT_SIZE + 4, 4) < 0)
+            goto fail;
+#endif
+
         /* start the task going */
         s->fifo = av_fifo_alloc(s->circular_buffer_size);
         ret = pthread_mutex_init(&s->mutex, NULL);
@@ -847,6 +1002,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+    udp_free_batch(s);
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -872,9 +1028,8 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
 
     if (s->fifo) {
-        pthread_mutex_lock(&s->mutex);
         do {
-            avail = av_fifo_size(s->fifo);
+            avail = avpriv_atomic_int_get(&s->circular_buffer_fill);
             if (avail) { // >=size) {
                 uint8_t tmp[4];
 
@@ -887,14 +1042,12 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
 
                 av_fifo_generic_read(s->fifo, buf, avail, NULL);
                 av_fifo_drain(s->fifo, AV_RL32(tmp) - avail);
-                pthread_mutex_unlock(&s->mutex);
+                /* releases the space to the receiving thread */
+                avpriv_atomic_int_add_and_fetch(&s->circular_buffer_fill, -(AV_RL32(tmp) + 4));
                 return avail;
-            } else if(s->circular_buffer_error){
-                int err = s->circular_buffer_error;
-                pthread_mutex_unlock(&s->mutex);
-                return err;
+            } else if (avpriv_atomic_int_get(&s->circular_buffer_error)) {
+                return s->circular_buffer_error;
             } else if(nonblock) {
-                pthread_mutex_unlock(&s->mutex);
                 return AVERROR(EAGAIN);
             }
             else {
@@ -903,10 +1056,19 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
                 int64_t t = av_gettime() + 100000;
                 struct timespec tv = { .tv_sec  =  t / 1000000,
                                        .tv_nsec = (t % 1000000) * 1000 };
-                if (pthread_cond_timedwait(&s->cond, &s->mutex, &tv) < 0) {
-                    pthread_mutex_unlock(&s->mutex);
+                int ret = 0;
+
+                /* the receiving thread only signals a reader which has
+                 * announced itself, after the fill level has been updated */
+                pthread_mutex_lock(&s->mutex);
+                avpriv_atomic_int_set(&s->reader_waiting, 1);
+                if (!avpriv_atomic_int_get(&s->circular_buffer_fill) &&
+                    !avpriv_atomic_int_get(&s->circular_buffer_error))
+                    ret = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+                avpriv_atomic_int_set(&s->reader_waiting, 0);
+                pthread_mutex_unlock(&s->mutex);
+                if (ret < 0)
                     return AVERROR(errno == ETIMEDOUT ? EAGAIN : errno);
-                }
                 nonblock = 1;
             }
         } while( 1);
@@ -928,6 +1090,20 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     UDPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_SENDMMSG
+    if (s->batch_buf) {
+        if (size <= s->batch_slot_size) {
+            memcpy(s->batch_buf + s->nb_queued * s->batch_slot_size, buf, size);
+            s->iovs[s->nb_queued++].iov_len = size;
+            if (s->nb_queued == s->batch_size && (ret = udp_flush_batch(h)) < 0)
+                return ret;
+            return size;
+        }
+        if ((ret = udp_flush_batch(h)) < 0)
+            return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -948,6 +1124,7 @@ static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
 
+    udp_flush_batch(h);
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr,(struct sockaddr *)&s->local_addr_storage);
     closesocket(s->udp_fd);
@@ -963,6 +1140,7 @@ static int udp_close(URLContext *h)
     }
 #endif
     av_fifo_freep(&s->fifo);
+    udp_free_batch(s);
     return 0;
 }
 
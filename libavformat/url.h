@@ -28,6 +28,7 @@
 #include "avio.h"
 #include "libavformat/version.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -90,6 +91,17 @@ typedef struct URLProtocol {
     int (*url_open_dir)(URLContext *h);
     int (*url_read_dir)(URLContext *h, AVIODirEntry **next);
     int (*url_close_dir)(URLContext *h);
+
+    /**
+     * Return a reference to size bytes of the resource starting at pos,
+     * without copying them, for protocols that keep the resource in memory.
+     * The padding bytes following them must be readable as well.
+     * Return AVERROR(ENOSYS) if the range is not available that way, in
+     * which case the data must be read with url_read().
+     * The read position of the protocol is not changed.
+     */
+    int (*url_read_ref)(URLContext *h, int64_t pos, int size, int padding,
+                        AVBufferRef **buf);
 } URLProtocol;
 
 /**
@@ -42,6 +42,7 @@
 #include "audiointerleave.h"
 #include "avformat.h"
 #include "avio_internal.h"
+#include "http.h"
 #include "id3v2.h"
 #include "internal.h"
 #include "metadata.h"
@@ -248,6 +249,20 @@ int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
     return append_packet_chunked(s, pkt, size);
 }
 
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size)
+{
+    av_init_packet(pkt);
+    pkt->pos = avio_tell(s);
+
+    if (ffio_read_ref(s, size, FF_INPUT_BUFFER_PADDING_SIZE, &pkt->buf) >= 0) {
+        pkt->data = pkt->buf->data;
+        pkt->size = size;
+        return size;
+    }
+
+    return av_get_packet(s, pkt, size);
+}
+
 int av_append_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
     if (!pkt->size)
@@ -1310,6 +1325,83 @@ static int64_t ts_to_samples(AVStream *st, int64_t ts)
     return av_rescale(ts, st->time_base.num * st->codec->sample_rate, st->time_base.den);
 }
 
+/**
+ * Merge the pending generic index entries of st into its index.
+ */
+static void merge_index_pending(AVStream *st)
+{
+    AVIndexEntry *entries;
+    int i, j, k;
+
+    if (!st->nb_index_pending)
+        return;
+
+    entries = av_fast_realloc(st->index_entries,
+                              &st->index_entries_allocated_size,
+                              (st->nb_index_entries + st->nb_index_pending) *
+                              sizeof(AVIndexEntry));
+    if (!entries) {
+        /* the index is only an optimization, drop the entries */
+        st->nb_index_pending = 0;
+        return;
+    }
+    st->index_entries = entries;
+
+    /* Both lists are sorted and share no timestamp, merge from the end so
+     * that the existing entries are moved at most once. */
+    i = st->nb_index_entries - 1;
+    j = st->nb_index_pending - 1;
+    k = st->nb_index_entries + st->nb_index_pending - 1;
+    while (j >= 0) {
+        if (i >= 0 && entries[i].timestamp > st->index_pending[j].timestamp)
+            entries[k--] = entries[i--];
+        else
+            entries[k--] = st->index_pending[j--];
+    }
+    st->nb_index_entries += st->nb_index_pending;
+    st->nb_index_pending  = 0;
+}
+
+/**
+ * Add a keyframe found while reading to the index of st.
+ *
+ * Entries which are appended to the index, or which update an existing
+ * entry, are added directly. Entries which belong in the middle of the
+ * index, as found when reading again after seeking back, are kept in
+ * a small sorted list instead, merged into the index once it grows to
+ * about the square root of the index size. This avoids moving the tail of
+ * a large index for every keyframe.
+ */
+static void add_generic_index_entry(AVStream *st, int64_t pos, int64_t timestamp)
+{
+    int64_t ts;
+    int index;
+
+    if (timestamp == AV_NOPTS_VALUE)
+        return;
+    timestamp = wrap_timestamp(st, timestamp);
+    ts = is_relative(timestamp) ? timestamp - RELATIVE_TS_BASE : timestamp;
+
+    if (st->nb_index_entries &&
+        st->index_entries[st->nb_index_entries - 1].timestamp > ts) {
+        index = ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
+                                          ts, AVSEEK_FLAG_ANY);
+        if (st->index_entries[index].timestamp != ts) {
+            ff_add_index_entry(&st->index_pending, &st->nb_index_pending,
+                               &st->index_pending_allocated_size, pos,
+                               timestamp, 0, 0, AVINDEX_KEYFRAME);
+            if (st->nb_index_pending >= 64 &&
+                (int64_t)st->nb_index_pending * st->nb_index_pending >= st->nb_index_entries)
+                merge_index_pending(st);
+            return;
+        }
+    }
+
+    ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
+                       &st->index_entries_allocated_size, pos,
+                       timestamp, 0, 0, AVINDEX_KEYFRAME);
+}
+
 static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
 {
     int ret = 0, i, got_packet = 0;
@@ -1380,8 +1472,7 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
             if ((s->iformat->flags & AVFMT_GENERIC_INDEX) &&
                 (pkt->flags & AV_PKT_FLAG_KEY) && pkt->dts != AV_NOPTS_VALUE) {
                 ff_reduce_index(s, st->index);
-                av_add_index_entry(st, pkt->pos, pkt->dts,
-                                   0, 0, AVINDEX_KEYFRAME);
+                add_generic_index_entry(st, pkt->pos, pkt->dts);
             }
             got_packet = 1;
         } else if (st->discard < AVDISCARD_ALL) {
@@ -1554,7 +1645,7 @@ return_packet:
     st = s->streams[pkt->stream_index];
     if ((s->iformat->flags & AVFMT_GENERIC_INDEX) && pkt->flags & AV_PKT_FLAG_KEY) {
         ff_reduce_index(s, st->index);
-        av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
+        add_generic_index_entry(st, pkt->pos, pkt->dts);
     }
 
     if (is_relative(pkt->dts))
@@ -1629,6 +1720,8 @@ void ff_read_frame_flush(AVFormatContext *s)
     for (i = 0; i < s->nb_streams; i++) {
         st = s->streams[i];
 
+        merge_index_pending(st);
+
         if (st->parser) {
             av_parser_close(st->parser);
             st->parser = NULL;
@@ -1672,8 +1765,9 @@ void ff_reduce_index(AVFormatContext *s, int stream_index)
     AVStream *st             = s->streams[stream_index];
     unsigned int max_entries = s->max_index_size / sizeof(AVIndexEntry);
 
-    if ((unsigned) st->nb_index_entries >= max_entries) {
+    if ((unsigned) st->nb_index_entries + st->nb_index_pending >= max_entries) {
         int i;
+        merge_index_pending(st);
         for (i = 0; 2 * i < st->nb_index_entries; i++)
             st->index_entries[i] = st->index_entries[2 * i];
         st->nb_index_entries = i;
@@ -1742,6 +1836,7 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
 int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags)
 {
+    merge_index_pending(st);
     timestamp = wrap_timestamp(st, timestamp);
     return ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
                               &st->index_entries_allocated_size, pos,
@@ -1783,6 +1878,7 @@ int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
 
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
 {
+    merge_index_pending(st);
     return ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
                                      wanted_timestamp, flags);
 }
@@ -3023,14 +3119,15 @@ void ff_rfps_calculate(AVFormatContext *ic)
 
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
-    int i, count, ret = 0, j;
+    int i, count = 0, ret = 0, j;
     int64_t read_size;
     AVStream *st;
     AVPacket pkt1, *pkt;
     int64_t old_offset  = avio_tell(ic->pb);
     // new streams might appear, no options for those
     int orig_nb_streams = ic->nb_streams;
-    int flush_codecs;
+    int flush_codecs, found_all = 1;
+    char *cache_key = NULL;
     int64_t max_analyze_duration = ic->max_analyze_duration2;
     int64_t max_stream_analyze_duration;
     int64_t probesize = ic->probesize2;
@@ -3055,6 +3152,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         av_log(ic, AV_LOG_DEBUG, "Before avformat_find_stream_info() pos: %"PRId64" bytes read:%"PRId64" seeks:%d\n",
                avio_tell(ic->pb), ic->pb->bytes_read, ic->pb->seek_count);
 
+    if (ic->stream_info_cache &&
+        ff_stream_info_cache_load(ic, &cache_key) > 0) {
+        av_freep(&cache_key);
+        compute_chapters_end(ic);
+        ret = 0;
+        goto find_stream_info_err;
+    }
+
     for (i = 0; i < ic->nb_streams; i++) {
         const AVCodec *codec;
         AVDictionary *thread_opt = NULL;
@@ -3449,6 +3554,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         st = ic->streams[i];
         if (!has_codec_parameters(st, &errmsg)) {
             char buf[256];
+            found_all = 0;
             avcodec_string(buf, sizeof(buf), st->codec, 0);
             av_log(ic, AV_LOG_WARNING,
                    "Could not find codec parameters for stream %d (%s): %s\n"
@@ -3461,7 +3567,13 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
     compute_chapters_end(ic);
 
+    /* only the streams found when reading the header can be restored */
+    if (cache_key && found_all && ret >= 0 &&
+        ic->nb_streams == orig_nb_streams)
+        ff_stream_info_cache_save(ic, cache_key);
+
 find_stream_info_err:
+    av_free(cache_key);
     for (i = 0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
         if (ic->streams[i]->codec->codec_type != AVMEDIA_TYPE_AUDIO)
@@ -3595,6 +3707,7 @@ void ff_free_stream(AVFormatContext *s, AVStream *st) {
     av_dict_free(&st->metadata);
     av_freep(&st->probe_data.buf);
     av_freep(&st->index_entries);
+    av_freep(&st->index_pending);
     av_freep(&st->codec->extradata);
     av_freep(&st->codec->subtitle_header);
     av_freep(&st->codec);
@@ -3636,6 +3749,7 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
     av_freep(&s->streams);
+    ff_interleave_queues_free(s);
     av_freep(&s->internal);
     flush_packet_queue(s);
     av_free(s);
@@ -4135,6 +4249,9 @@ int avformat_network_init(void)
 int avformat_network_deinit(void)
 {
 #if CONFIG_NETWORK
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_close_pool();
+#endif
     ff_network_close();
     ff_tls_deinit();
     ff_network_inited_globally = 0;
@@ -18,6 +18,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "atomic.h"
 #include "fifo.h"
 #include "threadmessage.h"
 #if HAVE_THREADS
@@ -40,6 +41,14 @@ struct AVThreadMessageQueue {
     int err_send;
     int err_recv;
     unsigned elsize;
+    unsigned nelem;
+    int spsc;
+    /* single producer/single consumer mode: the fifo indexes are only
+     * modified by their own side, the number of queued messages is the only
+     * state shared without the lock */
+    volatile int nb_msgs;
+    volatile int send_waiting;
+    volatile int recv_waiting;
 #else
     int dummy;
 #endif
@@ -48,6 +57,14 @@ struct AVThreadMessageQueue {
 int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
                                   unsigned nelem,
                                   unsigned elsize)
+{
+    return av_thread_message_queue_alloc2(mq, nelem, elsize, 0);
+}
+
+int av_thread_message_queue_alloc2(AVThreadMessageQueue **mq,
+                                   unsigned nelem,
+                                   unsigned elsize,
+                                   unsigned flags)
 {
 #if HAVE_THREADS
     AVThreadMessageQueue *rmq;
@@ -55,6 +72,8 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
 
     if (nelem > INT_MAX / elsize)
         return AVERROR(EINVAL);
+    if ((flags & AV_THREAD_MESSAGE_QUEUE_SPSC) && !nelem)
+        return AVERROR(EINVAL);
     if (!(rmq = av_mallocz(sizeof(*rmq))))
         return AVERROR(ENOMEM);
     if ((ret = pthread_mutex_init(&rmq->lock, NULL))) {
@@ -73,6 +92,8 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
         return AVERROR(ret);
     }
     rmq->elsize = elsize;
+    rmq->nelem  = nelem;
+    rmq->spsc   = !!(flags & AV_THREAD_MESSAGE_QUEUE_SPSC);
     *mq = rmq;
     return 0;
 #else
@@ -127,6 +148,72 @@ static int av_thread_message_queue_recv_locked(AVThreadMessageQueue *mq,
     return 0;
 }
 
+/* The number of messages is updated with a full barrier, which publishes
+ * the message written into (or releases the slot read from) the fifo.
+ * Setting the waiting flag and reading the number of messages on one side,
+ * and updating the number of messages and reading the waiting flag on the
+ * other side, are both ordered, so that at least one side sees the other:
+ * a waiting thread always gets woken up. */
+
+static void wake_up(AVThreadMessageQueue *mq, volatile int *waiting)
+{
+    if (avpriv_atomic_int_get(waiting)) {
+        pthread_mutex_lock(&mq->lock);
+        pthread_cond_signal(&mq->cond);
+        pthread_mutex_unlock(&mq->lock);
+    }
+}
+
+static int av_thread_message_queue_send_spsc(AVThreadMessageQueue *mq,
+                                             void *msg,
+                                             unsigned flags)
+{
+    int err;
+
+    while (1) {
+        if ((err = avpriv_atomic_int_get(&mq->err_send)))
+            return err;
+        if (avpriv_atomic_int_get(&mq->nb_msgs) < mq->nelem)
+            break;
+        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+            return AVERROR(EAGAIN);
+        pthread_mutex_lock(&mq->lock);
+        avpriv_atomic_int_set(&mq->send_waiting, 1);
+        if (!mq->err_send && avpriv_atomic_int_get(&mq->nb_msgs) >= mq->nelem)
+            pthread_cond_wait(&mq->cond, &mq->lock);
+        avpriv_atomic_int_set(&mq->send_waiting, 0);
+        pthread_mutex_unlock(&mq->lock);
+    }
+    av_fifo_generic_write(mq->fifo, msg, mq->elsize, NULL);
+    avpriv_atomic_int_add_and_fetch(&mq->nb_msgs, 1);
+    wake_up(mq, &mq->recv_waiting);
+    return 0;
+}
+
+static int av_thread_message_queue_recv_spsc(AVThreadMessageQueue *mq,
+                                             void *msg,
+                                             unsigned flags)
+{
+    int err;
+
+    while (!avpriv_atomic_int_get(&mq->nb_msgs)) {
+        if ((err = avpriv_atomic_int_get(&mq->err_recv)))
+            return err;
+        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+            return AVERROR(EAGAIN);
+        pthread_mutex_lock(&mq->lock);
+        avpriv_atomic_int_set(&mq->recv_waiting, 1);
+        if (!mq->err_recv && !avpriv_atomic_int_get(&mq->nb_msgs))
+            pthread_cond_wait(&mq->cond, &mq->lock);
+        avpriv_atomic_int_set(&mq->recv_waiting, 0);
+        pthread_mutex_unlock(&mq->lock);
+    }
+    av_fifo_generic_read(mq->fifo, msg, mq->elsize, NULL);
+    avpriv_atomic_int_add_and_fetch(&mq->nb_msgs, -1);
+    wake_up(mq, &mq->send_waiting);
+    return 0;
+}
+
 #endif /* HAVE_THREADS */
 
 int av_thread_message_queue_send(AVThreadMessageQueue *mq,
@@ -136,6 +223,8 @@ int av_thread_message_queue_send(AVThreadMessageQueue *mq,
 #if HAVE_THREADS
     int ret;
 
+    if (mq->spsc)
+        return av_thread_message_queue_send_spsc(mq, msg, flags);
     pthread_mutex_lock(&mq->lock);
     ret = av_thread_message_queue_send_locked(mq, msg, flags);
     pthread_mutex_unlock(&mq->lock);
@@ -152,6 +241,8 @@ int av_thread_message_queue_recv(AVThreadMessageQueue *mq,
 #if HAVE_THREADS
     int ret;
 
+    if (mq->spsc)
+        return av_thread_message_queue_recv_spsc(mq, msg, flags);
     pthread_mutex_lock(&mq->lock);
     ret = av_thread_message_queue_recv_locked(mq, msg, flags);
     pthread_mutex_unlock(&mq->lock);
@@ -166,7 +257,7 @@ void av_thread_message_queue_set_err_send(AVThreadMessageQueue *mq,
 {
 #if HAVE_THREADS
     pthread_mutex_lock(&mq->lock);
-    mq->err_send = err;
+    avpriv_atomic_int_set(&mq->err_send, err);
     pthread_cond_broadcast(&mq->cond);
     pthread_mutex_unlock(&mq->lock);
 #endif /* HAVE_THREADS */
@@ -177,8 +268,97 @@ void av_thread_message_queue_set_err_recv(AVThreadMessageQueue *mq,
 {
 #if HAVE_THREADS
     pthread_mutex_lock(&mq->lock);
-    mq->err_recv = err;
+    avpriv_atomic_int_set(&mq->err_recv, err);
     pthread_cond_broadcast(&mq->cond);
     pthread_mutex_unlock(&mq->lock);
 #endif /* HAVE_THREADS */
 }
+
+#ifdef TEST
+#include "avassert.h"
+
+#define NB_MSGS 1000
+
+#if HAVE_THREADS
+static void *producer(void *arg)
+{
+    AVThreadMessageQueue *mq = arg;
+    int i;
+
+    for (i = 0; i < NB_MSGS; i++)
+        av_assert0(av_thread_message_queue_send(mq, &i, 0) >= 0);
+    av_thread_message_queue_set_err_recv(mq, AVERROR_EOF);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    AVThreadMessageQueue *mq = arg;
+    int i, msg;
+
+    for (i = 0; i < NB_MSGS / 2; i++) {
+        av_assert0(av_thread_message_queue_recv(mq, &msg, 0) >= 0);
+        av_assert0(msg == i);
+    }
+    av_thread_message_queue_set_err_send(mq, AVERROR(EPIPE));
+    return NULL;
+}
+
+static void test_queue(unsigned flags)
+{
+    AVThreadMessageQueue *mq;
+    pthread_t thread;
+    int i, msg, ret;
+
+    av_assert0(av_thread_message_queue_alloc2(&mq, 4, sizeof(int), flags) >= 0);
+
+    /* non-blocking calls on an empty and on a full queue */
+    av_assert0(av_thread_message_queue_recv(mq, &msg, AV_THREAD_MESSAGE_NONBLOCK) == AVERROR(EAGAIN));
+    for (i = 0; i < 4; i++)
+        av_assert0(av_thread_message_queue_send(mq, &i, AV_THREAD_MESSAGE_NONBLOCK) >= 0);
+    av_assert0(av_thread_message_queue_send(mq, &i, AV_THREAD_MESSAGE_NONBLOCK) == AVERROR(EAGAIN));
+    for (i = 0; i < 2; i++) {
+        av_assert0(av_thread_message_queue_recv(mq, &msg, AV_THREAD_MESSAGE_NONBLOCK) >= 0);
+        av_assert0(msg == i);
+    }
+
+    /* the receiver still gets the queued messages before the error */
+    av_thread_message_queue_set_err_recv(mq, AVERROR_EOF);
+    for (i = 2; i < 4; i++) {
+        av_assert0(av_thread_message_queue_recv(mq, &msg, 0) >= 0);
+        av_assert0(msg == i);
+    }
+    av_assert0(av_thread_message_queue_recv(mq, &msg, 0) == AVERROR_EOF);
+    av_assert0(av_thread_message_queue_recv(mq, &msg, AV_THREAD_MESSAGE_NONBLOCK) == AVERROR_EOF);
+    av_thread_message_queue_free(&mq);
+
+    /* messages arrive in order through blocking calls */
+    av_assert0(av_thread_message_queue_alloc2(&mq, 4, sizeof(int), flags) >= 0);
+    av_assert0(!pthread_create(&thread, NULL, producer, mq));
+    for (i = 0; (ret = av_thread_message_queue_recv(mq, &msg, 0)) >= 0; i++)
+        av_assert0(msg == i);
+    av_assert0(ret == AVERROR_EOF && i == NB_MSGS);
+    pthread_join(thread, NULL);
+    av_thread_message_queue_free(&mq);
+
+    /* a blocked sender is woken up by the error */
+    av_assert0(av_thread_message_queue_alloc2(&mq, 4, sizeof(int), flags) >= 0);
+    av_assert0(!pthread_create(&thread, NULL, consumer, mq));
+    for (i = 0; (ret = av_thread_message_queue_send(mq, &i, 0)) >= 0; i++)
+        ;
+    av_assert0(ret == AVERROR(EPIPE) && i >= NB_MSGS / 2);
+    av_assert0(av_thread_message_queue_send(mq, &i, AV_THREAD_MESSAGE_NONBLOCK) == AVERROR(EPIPE));
+    pthread_join(thread, NULL);
+    av_thread_message_queue_free(&mq);
+}
+#endif /* HAVE_THREADS */
+
+int main(void)
+{
+#if HAVE_THREADS
+    test_queue(0);
+    test_queue(AV_THREAD_MESSAGE_QUEUE_SPSC);
+#endif
+    return 0;
+}
+#endif
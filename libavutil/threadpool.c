@@ -0,0 +1,430 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "atomic.h"
+#include "common.h"
+#include "cpu.h"
+#include "error.h"
+#include "internal.h"
+#include "mem.h"
+#include "threadpool.h"
+#include "threadpool_internal.h"
+
+#if HAVE_THREADS
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#else
+#error "Unknown threads implementation"
+#endif
+#endif
+
+#if HAVE_THREADS
+
+typedef struct ThreadPoolWorker ThreadPoolWorker;
+
+typedef struct ThreadPoolBatch {
+    AVThreadPoolJobFunc *func;
+    void *opaque;
+    int nb_jobs;
+    int max_threads;
+
+    int next_job;               ///< index of the next job to start
+    int nb_threads;             ///< number of threads that joined the batch
+    int nb_workers;             ///< number of workers still in the batch
+    ThreadPoolWorker *queue;    ///< worker the batch is queued on, if any
+    pthread_cond_t done_cond;   ///< signaled when nb_workers drops to 0
+    struct ThreadPoolBatch *next;
+} ThreadPoolBatch;
+
+struct ThreadPoolWorker {
+    AVThreadPool *pool;
+    pthread_t thread;
+    /* batches with jobs left to start and room for more threads, oldest
+     * first; served by this worker first, and stolen by the others once
+     * their own queue is empty */
+    ThreadPoolBatch *queue;
+};
+
+struct AVThreadPool {
+    ThreadPoolWorker *workers;
+    int nb_workers;
+    volatile int refcount;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    int nb_queued;              ///< number of batches in all the queues
+    int next_queue;             ///< worker the next batch is queued on
+    int done;
+};
+
+static AVThreadPool * volatile global_pool;
+
+static void enqueue_batch(AVThreadPool *pool, ThreadPoolBatch *b)
+{
+    ThreadPoolBatch **p;
+
+    b->queue = &pool->workers[pool->next_queue];
+    pool->next_queue = (pool->next_queue + 1) % pool->nb_workers;
+    for (p = &b->queue->queue; *p; p = &(*p)->next)
+        ;
+    *p = b;
+    pool->nb_queued++;
+}
+
+static void dequeue_batch(AVThreadPool *pool, ThreadPoolBatch *b)
+{
+    ThreadPoolBatch **p;
+
+    if (!b->queue)
+        return;
+    for (p = &b->queue->queue; *p != b; p = &(*p)->next)
+        ;
+    *p = b->next;
+    b->queue = NULL;
+    pool->nb_queued--;
+}
+
+/* Return the oldest batch of the worker's own queue, or else steal the
+ * oldest batch of the next non-empty queue. */
+static ThreadPoolBatch *find_batch(AVThreadPool *pool, ThreadPoolWorker *w)
+{
+    int idx = w - pool->workers;
+    int i;
+
+    for (i = 0; i < pool->nb_workers; i++) {
+        ThreadPoolWorker *victim = &pool->workers[(idx + i) % pool->nb_workers];
+        if (victim->queue)
+            return victim->queue;
+    }
+    return NULL;
+}
+
+/* Called and returns with the pool lock held. */
+static void run_jobs(AVThreadPool *pool, ThreadPoolBatch *b, int threadnr)
+{
+    while (b->next_job < b->nb_jobs) {
+        int jobnr = b->next_job++;
+
+        if (b->next_job == b->nb_jobs)
+            dequeue_batch(pool, b);
+        pthread_mutex_unlock(&pool->lock);
+
+        b->func(b->opaque, jobnr, threadnr);
+
+        pthread_mutex_lock(&pool->lock);
+    }
+}
+
+static void *attribute_align_arg worker(void *v)
+{
+    ThreadPoolWorker *w = v;
+    AVThreadPool *pool  = w->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        ThreadPoolBatch *b;
+        int threadnr;
+
+        while (!pool->nb_queued && !pool->done)
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        if (!(b = find_batch(pool, w)))
+            break;
+
+        threadnr = b->nb_threads++;
+        b->nb_workers++;
+        if (b->nb_threads == b->max_threads)
+            dequeue_batch(pool, b);
+
+        run_jobs(pool, b, threadnr);
+
+        if (!--b->nb_workers)
+            pthread_cond_signal(&b->done_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static void pool_stop(AVThreadPool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->done = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->nb_workers; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+    av_freep(&pool->workers);
+}
+
+#endif /* HAVE_THREADS */
+
+int av_thread_pool_alloc(AVThreadPool **ppool, int nb_threads)
+{
+#if HAVE_THREADS
+    AVThreadPool *pool;
+    int i, ret;
+
+    *ppool = NULL;
+
+    if (nb_threads < 0)
+        return AVERROR(EINVAL);
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+
+    if (!(pool = av_mallocz(sizeof(*pool))))
+        return AVERROR(ENOMEM);
+    if (!(pool->workers = av_mallocz_array(nb_threads, sizeof(*pool->workers)))) {
+        av_free(pool);
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = pthread_mutex_init(&pool->lock, NULL))) {
+        av_free(pool->workers);
+        av_free(pool);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pool->work_cond, NULL))) {
+        pthread_mutex_destroy(&pool->lock);
+        av_free(pool->workers);
+        av_free(pool);
+        return AVERROR(ret);
+    }
+    pool->refcount = 1;
+
+    for (i = 0; i < nb_threads; i++) {
+        pool->workers[i].pool = pool;
+        if ((ret = pthread_create(&pool->workers[i].thread, NULL, worker,
+                                  &pool->workers[i]))) {
+            pool_stop(pool);
+            av_free(pool);
+            return AVERROR(ret);
+        }
+        pool->nb_workers++;
+    }
+
+    *ppool = pool;
+    return 0;
+#else
+    *ppool = NULL;
+    return AVERROR(ENOSYS);
+#endif /* HAVE_THREADS */
+}
+
+void av_thread_pool_free(AVThreadPool **ppool)
+{
+#if HAVE_THREADS
+    AVThreadPool *pool = *ppool;
+
+    *ppool = NULL;
+    if (pool && !avpriv_atomic_int_add_and_fetch(&pool->refcount, -1)) {
+        pool_stop(pool);
+        av_free(pool);
+    }
+#endif
+}
+
+int av_thread_pool_get_nb_threads(AVThreadPool *pool)
+{
+#if HAVE_THREADS
+    return pool->nb_workers;
+#else
+    return 0;
+#endif
+}
+
+int av_thread_pool_execute(AVThreadPool *pool, AVThreadPoolJobFunc *func,
+                           void *opaque, int nb_jobs, int max_threads)
+{
+#if HAVE_THREADS
+    ThreadPoolBatch b = { 0 };
+    int i;
+
+    if (pool && nb_jobs > 1 && max_threads > 1) {
+        b.func        = func;
+        b.opaque      = opaque;
+        b.nb_jobs     = nb_jobs;
+        b.max_threads = FFMIN(max_threads, pool->nb_workers + 1);
+        b.nb_threads  = 1;
+        pthread_cond_init(&b.done_cond, NULL);
+
+        pthread_mutex_lock(&pool->lock);
+        enqueue_batch(pool, &b);
+        for (i = 1; i < FFMIN(nb_jobs, b.max_threads); i++)
+            pthread_cond_signal(&pool->work_cond);
+
+        run_jobs(pool, &b, 0);
+
+        while (b.nb_workers)
+            pthread_cond_wait(&b.done_cond, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+
+        pthread_cond_destroy(&b.done_cond);
+        return 0;
+    }
+#endif
+    {
+        int jobnr;
+
+        for (jobnr = 0; jobnr < nb_jobs; jobnr++)
+            func(opaque, jobnr, 0);
+    }
+    return 0;
+}
+
+void av_thread_pool_set_global(AVThreadPool *pool)
+{
+#if HAVE_THREADS
+    AVThreadPool *old;
+
+    if (pool)
+        avpriv_atomic_int_add_and_fetch(&pool->refcount, 1);
+    do {
+        old = global_pool;
+    } while (avpriv_atomic_ptr_cas((void * volatile *)&global_pool, old, pool) != old);
+    av_thread_pool_free(&old);
+#endif
+}
+
+AVThreadPool *av_thread_pool_get_global(void)
+{
+#if HAVE_THREADS
+    return avpriv_atomic_ptr_cas((void * volatile *)&global_pool, NULL, NULL);
+#else
+    return NULL;
+#endif
+}
+
+AVThreadPool *avpriv_thread_pool_ref(AVThreadPool *pool)
+{
+#if HAVE_THREADS
+    if (pool)
+        avpriv_atomic_int_add_and_fetch(&pool->refcount, 1);
+#endif
+    return pool;
+}
+
+AVThreadPool *avpriv_thread_pool_ref_global(void)
+{
+    return avpriv_thread_pool_ref(av_thread_pool_get_global());
+}
+
+#ifdef TEST
+#include "avassert.h"
+
+#define NB_JOBS     64
+#define MAX_THREADS 3
+
+typedef struct TestBatch {
+    AVThreadPool *pool;
+    volatile int done[NB_JOBS];
+    volatile int busy[MAX_THREADS];
+    int nested;
+} TestBatch;
+
+static void test_job(void *opaque, int jobnr, int threadnr)
+{
+    TestBatch *t = opaque;
+
+    av_assert0(threadnr >= 0 && threadnr < MAX_THREADS);
+    av_assert0(avpriv_atomic_int_add_and_fetch(&t->busy[threadnr], 1) == 1);
+
+    /* jobs wait for the previous one, as in wavefront decoding */
+    if (jobnr)
+        while (!avpriv_atomic_int_get(&t->done[jobnr - 1]))
+            ;
+
+    if (t->nested && !(jobnr % 16)) {
+        TestBatch n = { .pool = t->pool };
+        int i;
+
+        av_thread_pool_execute(n.pool, test_job, &n, NB_JOBS, MAX_THREADS);
+        for (i = 0; i < NB_JOBS; i++)
+            av_assert0(n.done[i] == 1);
+    }
+
+    avpriv_atomic_int_add_and_fetch(&t->busy[threadnr], -1);
+    avpriv_atomic_int_add_and_fetch(&t->done[jobnr], 1);
+}
+
+#if HAVE_THREADS
+/* batches submitted from several threads at once are queued on different
+ * workers, and idle workers steal them from each other */
+static void *attribute_align_arg test_submitter(void *v)
+{
+    TestBatch *t = v;
+    int i;
+
+    av_thread_pool_execute(t->pool, test_job, t, NB_JOBS, MAX_THREADS);
+    for (i = 0; i < NB_JOBS; i++)
+        av_assert0(t->done[i] == 1);
+    return NULL;
+}
+#endif
+
+int main(void)
+{
+    AVThreadPool *pool;
+    int i, nested;
+
+    if (av_thread_pool_alloc(&pool, 2) < 0)
+        pool = NULL;
+    av_thread_pool_set_global(pool);
+    av_assert0(av_thread_pool_get_global() == pool);
+
+    for (nested = 0; nested < 2; nested++) {
+        TestBatch t = { .pool = pool, .nested = nested };
+
+        av_thread_pool_execute(pool, test_job, &t, NB_JOBS, MAX_THREADS);
+        for (i = 0; i < NB_JOBS; i++)
+            av_assert0(t.done[i] == 1);
+    }
+
+#if HAVE_THREADS
+    if (pool) {
+        TestBatch t[4] = { { 0 } };
+        pthread_t submitters[4];
+
+        for (i = 0; i < 4; i++) {
+            t[i].pool = pool;
+            av_assert0(!pthread_create(&submitters[i], NULL, test_submitter, &t[i]));
+        }
+        for (i = 0; i < 4; i++)
+            pthread_join(submitters[i], NULL);
+    }
+#endif
+
+    av_thread_pool_free(&pool);
+    pool = avpriv_thread_pool_ref_global();
+    av_thread_pool_set_global(NULL);
+    av_assert0(!av_thread_pool_get_global());
+    av_thread_pool_free(&pool);
+
+    return 0;
+}
+#endif
@@ -0,0 +1,125 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_thread_pool
+ * Shared worker thread pool
+ */
+
+#ifndef AVUTIL_THREADPOOL_H
+#define AVUTIL_THREADPOOL_H
+
+/**
+ * @defgroup lavu_thread_pool Thread pool
+ * @ingroup lavu_data
+ *
+ * A fixed set of worker threads shared by any number of users.
+ *
+ * Work is submitted as a batch of independent jobs. The submitting thread
+ * runs jobs of its own batch, and the batch is queued on one of the workers
+ * of the pool, in turn. Idle workers serve their own queue first and steal
+ * batches queued on the other workers when it is empty, so that the total
+ * number of threads busy with jobs never exceeds the number of workers plus
+ * the number of submitting threads.
+ *
+ * When a pool is installed with av_thread_pool_set_global(), codec slice
+ * threading, filter graph slice threading and scalers run their jobs on it
+ * instead of starting threads of their own.
+ * @{
+ */
+
+typedef struct AVThreadPool AVThreadPool;
+
+/**
+ * Job callback.
+ *
+ * @param opaque   the opaque pointer passed to av_thread_pool_execute()
+ * @param jobnr    index of the job, in the range [0, nb_jobs)
+ * @param threadnr index of the thread running the job in the batch, in the
+ *                 range [0, max_threads); no two jobs of a batch running
+ *                 concurrently get the same index
+ */
+typedef void (AVThreadPoolJobFunc)(void *opaque, int jobnr, int threadnr);
+
+/**
+ * Allocate a thread pool and start its worker threads.
+ *
+ * @param pool       pointer to the new pool
+ * @param nb_threads number of worker threads, 0 for the number of CPUs
+ * @return >=0 for success; <0 for error, in particular AVERROR(ENOSYS) if
+ *         lavu was built without thread support
+ */
+int av_thread_pool_alloc(AVThreadPool **pool, int nb_threads);
+
+/**
+ * Release the caller's reference to a pool.
+ *
+ * The worker threads are stopped once the pool is no longer referenced,
+ * that is once it is no longer installed as the global pool and all the
+ * contexts that picked it up have been freed. No batch may be executing on
+ * the pool when the last reference is released.
+ */
+void av_thread_pool_free(AVThreadPool **pool);
+
+/**
+ * @return the number of worker threads of the pool
+ */
+int av_thread_pool_get_nb_threads(AVThreadPool *pool);
+
+/**
+ * Run a batch of jobs on the pool and wait for all of them to finish.
+ *
+ * Jobs are started in increasing jobnr order. The calling thread takes part
+ * in the batch with threadnr 0, so the batch completes even when all the
+ * workers are busy, and jobs may wait for the progress of jobs with a lower
+ * jobnr. Batches may be executed from several threads at the same time,
+ * including from within a job.
+ *
+ * @param pool        the pool, or NULL to run all the jobs in the calling
+ *                    thread
+ * @param func        function called for each job
+ * @param opaque      passed to func
+ * @param nb_jobs     number of jobs
+ * @param max_threads maximum number of threads running jobs of the batch
+ *                    concurrently, including the calling thread
+ * @return 0
+ */
+int av_thread_pool_execute(AVThreadPool *pool, AVThreadPoolJobFunc *func,
+                           void *opaque, int nb_jobs, int max_threads);
+
+/**
+ * Install a pool as the process-wide pool used by libavcodec, libavfilter
+ * and libswscale contexts initialized afterwards, or uninstall it if pool
+ * is NULL. The global pool holds its own reference to the pool.
+ *
+ * This function must not be called while contexts are being initialized
+ * in other threads.
+ */
+void av_thread_pool_set_global(AVThreadPool *pool);
+
+/**
+ * @return the process-wide pool, or NULL if none is installed
+ */
+AVThreadPool *av_thread_pool_get_global(void);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_THREADPOOL_H */
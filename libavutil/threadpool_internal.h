@@ -0,0 +1,39 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_THREADPOOL_INTERNAL_H
+#define AVUTIL_THREADPOOL_INTERNAL_H
+
+#include "threadpool.h"
+
+/**
+ * Get a new reference to a pool, to be released with av_thread_pool_free().
+ *
+ * @return pool
+ */
+AVThreadPool *avpriv_thread_pool_ref(AVThreadPool *pool);
+
+/**
+ * Get a new reference to the global pool.
+ *
+ * @return the global pool, to be released with av_thread_pool_free(), or
+ *         NULL if no global pool is installed
+ */
+AVThreadPool *avpriv_thread_pool_ref_global(void);
+
+#endif /* AVUTIL_THREADPOOL_INTERNAL_H */
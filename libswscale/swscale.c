@@ -35,6 +35,7 @@
 #include "rgb2rgb.h"
 #include "swscale_internal.h"
 #include "swscale.h"
+#include "thread.h"
 
 DECLARE_ALIGNED(8, const uint8_t, ff_dither_8x8_128)[9][8] = {
     {  36, 68,  60, 92,  34, 66,  58, 90, },
@@ -361,6 +362,8 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     const int chrSrcSliceH           = FF_CEIL_RSHIFT(srcSliceH,   c->chrSrcVSubSample);
     int should_dither                = is9_OR_10BPS(c->srcFormat) ||
                                        is16BPS(c->srcFormat);
+    const int dstSliceEnd            = c->dstSliceH ? c->dstSliceY + c->dstSliceH
+                                                    : dstH;
     int lastDstY;
 
     /* vars which will change and which we need to store back in the context */
@@ -429,7 +432,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = c->dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -439,7 +442,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     }
     lastDstY = dstY;
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstSliceEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         uint8_t *dest[4]  = {
             dst[0] + dstStride[0] * dstY,
@@ -905,6 +908,53 @@ static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
     }
 }
 
+typedef struct SwsSliceArgs {
+    const uint8_t **src;
+    int *srcStride;
+    uint8_t **dst;
+    int *dstStride;
+} SwsSliceArgs;
+
+static int scale_slice(SwsContext *c, void *arg, int jobnr, int nb_jobs)
+{
+    SwsSliceArgs *s      = arg;
+    SwsContext *slice    = c->slice_ctx[jobnr];
+    const uint8_t *src[4] = { s->src[0], s->src[1], s->src[2], s->src[3] };
+    uint8_t *dst[4]       = { s->dst[0], s->dst[1], s->dst[2], s->dst[3] };
+    int srcStride[4]      = { s->srcStride[0], s->srcStride[1],
+                              s->srcStride[2], s->srcStride[3] };
+    int dstStride[4]      = { s->dstStride[0], s->dstStride[1],
+                              s->dstStride[2], s->dstStride[3] };
+
+    return slice->swscale(slice, src, srcStride, 0, c->srcH, dst, dstStride);
+}
+
+/**
+ * Scale a whole picture by running each slice context on its own band of
+ * destination lines.
+ */
+static int scale_threaded(SwsContext *c, const uint8_t *src[], int srcStride[],
+                          uint8_t *dst[], int dstStride[])
+{
+    SwsSliceArgs args = { src, srcStride, dst, dstStride };
+    int rets[MAX_SLICE_CTX];
+    int i, ret = 0;
+
+    /* the palette is converted by the caller into the master context */
+    if (usePal(c->srcFormat))
+        for (i = 0; i < c->nb_slice_ctx; i++)
+            memcpy(c->slice_ctx[i]->pal_yuv, c->pal_yuv, sizeof(c->pal_yuv));
+
+    ff_sws_thread_execute(c, scale_slice, &args, rets, c->nb_slice_ctx);
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        if (rets[i] < 0)
+            return rets[i];
+        ret += rets[i];
+    }
+    return ret;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -1110,8 +1160,11 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (srcSliceY + srcSliceH == c->srcH)
             c->sliceDir = 0;
 
-        ret = c->swscale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
-                          dstStride2);
+        if (c->nb_slice_ctx && srcSliceY == 0 && srcSliceH == c->srcH)
+            ret = scale_threaded(c, src2, srcStride2, dst2, dstStride2);
+        else
+            ret = c->swscale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
+                             dstStride2);
     } else {
         // slices go from bottom to top => we flip the image internally
         int srcStride2[4] = { -srcStride[0], -srcStride[1], -srcStride[2],
@@ -43,6 +43,8 @@
 
 #define MAX_FILTER_SIZE SWS_MAX_FILTER_SIZE
 
+#define MAX_SLICE_CTX 64
+
 #define DITHER1XBPP
 
 #if HAVE_BIGENDIAN
@@ -313,6 +315,17 @@ typedef struct SwsContext {
     int cascaded1_tmpStride[4];
     uint8_t *cascaded1_tmp[4];
 
+    /* Slice threading splits the destination picture into horizontal bands,
+     * each scaled by its own slice context with private line ring buffers
+     * and filter state. Only used when a whole picture is passed in one call.
+     */
+    int nb_threads;               ///< Number of threads requested by the user (0 = auto).
+    struct SwsContext **slice_ctx;
+    int nb_slice_ctx;
+    void *thread;
+    int dstSliceY;                ///< First destination line output by a slice context.
+    int dstSliceH;                ///< Number of destination lines output by a slice context, 0 for the whole picture.
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
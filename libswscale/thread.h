@@ -0,0 +1,44 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SWSCALE_THREAD_H
+#define SWSCALE_THREAD_H
+
+#include "swscale_internal.h"
+
+typedef int (sws_action_func)(SwsContext *c, void *arg, int jobnr, int nb_jobs);
+
+/**
+ * Start the worker threads of a scaler.
+ *
+ * @param nb_threads number of requested threads, 0 for automatic
+ * @return number of started threads (1 means no threading), or a negative
+ *         AVERROR code on failure
+ */
+int ff_sws_thread_init(SwsContext *c, int nb_threads);
+
+void ff_sws_thread_free(SwsContext *c);
+
+/**
+ * Run func for jobs 0..nb_jobs-1 on the worker threads and wait for all of
+ * them to finish. ret, if not NULL, receives the return value of each job.
+ */
+int ff_sws_thread_execute(SwsContext *c, sws_action_func *func,
+                          void *arg, int *ret, int nb_jobs);
+
+#endif /* SWSCALE_THREAD_H */
@@ -53,6 +53,7 @@
 #include "rgb2rgb.h"
 #include "swscale.h"
 #include "swscale_internal.h"
+#include "thread.h"
 
 static void handle_formats(SwsContext *c);
 
@@ -829,6 +830,13 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange,
+                                 table, dstRange,
+                                 brightness, contrast, saturation);
+
     memmove(c->srcColorspaceTable, inv_table, sizeof(int) * 4);
     memmove(c->dstColorspaceTable, table, sizeof(int) * 4);
 
@@ -964,6 +972,97 @@ SwsContext *sws_alloc_context(void)
     return c;
 }
 
+#if !HAVE_THREADS
+int ff_sws_thread_init(SwsContext *c, int nb_threads)
+{
+    return 1;
+}
+
+void ff_sws_thread_free(SwsContext *c)
+{
+}
+
+int ff_sws_thread_execute(SwsContext *c, sws_action_func *func,
+                          void *arg, int *ret, int nb_jobs)
+{
+    int i;
+
+    for (i = 0; i < nb_jobs; i++) {
+        int r = func(c, arg, i, nb_jobs);
+        if (ret)
+            ret[i] = r;
+    }
+    return 0;
+}
+#endif
+
+static av_cold int init_slice_contexts(SwsContext *c, SwsFilter *srcFilter,
+                                       SwsFilter *dstFilter)
+{
+    int i, ret, nb_threads, nb_slices;
+
+    /* error diffusion carries state from one line to the next */
+    if (c->nb_threads == 1 || c->dither == SWS_DITHER_ED)
+        return 0;
+
+    nb_threads = ff_sws_thread_init(c, c->nb_threads);
+    if (nb_threads < 0)
+        return nb_threads;
+
+    /* bands have to start on a destination chroma line */
+    nb_slices = FFMIN3(nb_threads, c->chrDstH, MAX_SLICE_CTX);
+    if (nb_slices <= 1) {
+        ff_sws_thread_free(c);
+        return 0;
+    }
+
+    c->slice_ctx = av_mallocz_array(nb_slices, sizeof(*c->slice_ctx));
+    if (!c->slice_ctx)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_slices; i++) {
+        SwsContext *s;
+        int start = (int64_t)c->chrDstH *  i      / nb_slices << c->chrDstVSubSample;
+        int end   = (int64_t)c->chrDstH * (i + 1) / nb_slices << c->chrDstVSubSample;
+
+        if (!(s = c->slice_ctx[i] = sws_alloc_context()))
+            return AVERROR(ENOMEM);
+        c->nb_slice_ctx++;
+
+        s->flags         = c->flags & ~SWS_PRINT_INFO;
+        s->srcW          = c->srcW;
+        s->srcH          = c->srcH;
+        s->dstW          = c->dstW;
+        s->dstH          = c->dstH;
+        s->srcFormat     = c->srcFormat;
+        s->dstFormat     = c->dstFormat;
+        s->srcRange      = c->srcRange;
+        s->dstRange      = c->dstRange;
+        s->param[0]      = c->param[0];
+        s->param[1]      = c->param[1];
+        s->src_h_chr_pos = c->src_h_chr_pos;
+        s->src_v_chr_pos = c->src_v_chr_pos;
+        s->dst_h_chr_pos = c->dst_h_chr_pos;
+        s->dst_v_chr_pos = c->dst_v_chr_pos;
+        s->dither        = c->dither;
+        s->nb_threads    = 1;
+
+        if ((ret = sws_init_context(s, srcFilter, dstFilter)) < 0)
+            return ret;
+        if (s->swscale != c->swscale)
+            return AVERROR_BUG;
+
+        sws_setColorspaceDetails(s, c->srcColorspaceTable, c->srcRange,
+                                 c->dstColorspaceTable, c->dstRange,
+                                 c->brightness, c->contrast, c->saturation);
+
+        s->dstSliceY = start;
+        s->dstSliceH = FFMIN(end, c->dstH) - start;
+    }
+
+    return 0;
+}
+
 static uint16_t * alloc_gamma_tbl(double e)
 {
     int i = 0;
@@ -1591,7 +1690,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
     }
 
     c->swscale = ff_getSwsFunc(c);
-    return 0;
+    return init_slice_contexts(c, srcFilter, dstFilter);
 fail: // FIXME replace things by appropriate error codes
     if (ret == RETCODE_USE_CASCADE)  {
         int tmpW = sqrt(srcW * (int64_t)dstW);
@@ -1987,6 +2086,12 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    c->nb_slice_ctx = 0;
+    ff_sws_thread_free(c);
+
     if (c->lumPixBuf) {
         for (i = 0; i < c->vLumBufSize; i++)
             av_freep(&c->lumPixBuf[i]);
@@ -2071,6 +2176,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
                                              SWS_PARAM_DEFAULT };
     int64_t src_h_chr_pos = -513, dst_h_chr_pos = -513,
             src_v_chr_pos = -513, dst_v_chr_pos = -513;
+    int64_t nb_threads = 1;
 
     if (!param)
         param = default_param;
@@ -2090,6 +2196,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
         av_opt_get_int(context, "src_v_chr_pos", 0, &src_v_chr_pos);
         av_opt_get_int(context, "dst_h_chr_pos", 0, &dst_h_chr_pos);
         av_opt_get_int(context, "dst_v_chr_pos", 0, &dst_v_chr_pos);
+        av_opt_get_int(context, "threads",       0, &nb_threads);
         sws_freeContext(context);
         context = NULL;
     }
@@ -2111,6 +2218,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
         av_opt_set_int(context, "src_v_chr_pos", src_v_chr_pos, 0);
         av_opt_set_int(context, "dst_h_chr_pos", dst_h_chr_pos, 0);
         av_opt_set_int(context, "dst_v_chr_pos", dst_v_chr_pos, 0);
+        av_opt_set_int(context, "threads",       nb_threads,    0);
 
         if (sws_init_context(context, srcFilter, dstFilter) < 0) {
             sws_freeContext(context);
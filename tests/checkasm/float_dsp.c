@@ -0,0 +1,232 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavutil/float_dsp.h"
+#include "libavutil/internal.h"
+
+#define LEN 256
+
+#define randomize_buffer(buf)                                    \
+    do {                                                         \
+        int i;                                                   \
+        for (i = 0; i < LEN; i++)                                \
+            buf[i] = (float)rnd() / (UINT_MAX >> 5) - 16.0f;     \
+    } while (0)
+
+#define EPS 0.005
+
+static void check_vector_fmul(const AVFloatDSPContext *fdsp,
+                              const float *src0, const float *src1)
+{
+    LOCAL_ALIGNED_32(float, dst0, [LEN]);
+    LOCAL_ALIGNED_32(float, dst1, [LEN]);
+
+    declare_func(void, float *dst, const float *src0, const float *src1, int len);
+
+    if (check_func(fdsp->vector_fmul, "vector_fmul")) {
+        call_ref(dst0, src0, src1, LEN);
+        call_new(dst1, src0, src1, LEN);
+        if (!float_near_abs_eps_array(dst0, dst1, EPS, LEN))
+            fail();
+        bench_new(dst1, src0, src1, LEN);
+    }
+}
+
+static void check_vector_fmul_add(const AVFloatDSPContext *fdsp, const float *src0,
+                                  const float *src1, const float *src2)
+{
+    LOCAL_ALIGNED_32(float, dst0, [LEN]);
+    LOCAL_ALIGNED_32(float, dst1, [LEN]);
+
+    declare_func(void, float *dst, const float *src0, const float *src1,
+                 const float *src2, int len);
+
+    if (check_func(fdsp->vector_fmul_add, "vector_fmul_add")) {
+        call_ref(dst0, src0, src1, src2, LEN);
+        call_new(dst1, src0, src1, src2, LEN);
+        if (!float_near_abs_eps_array(dst0, dst1, EPS, LEN))
+            fail();
+        bench_new(dst1, src0, src1, src2, LEN);
+    }
+}
+
+static void check_vector_fmul_reverse(const AVFloatDSPContext *fdsp,
+                                      const float *src0, const float *src1)
+{
+    LOCAL_ALIGNED_32(float, dst0, [LEN]);
+    LOCAL_ALIGNED_32(float, dst1, [LEN]);
+
+    declare_func(void, float *dst, const float *src0, const float *src1, int len);
+
+    if (check_func(fdsp->vector_fmul_reverse, "vector_fmul_reverse")) {
+        call_ref(dst0, src0, src1, LEN);
+        call_new(dst1, src0, src1, LEN);
+        if (!float_near_abs_eps_array(dst0, dst1, EPS, LEN))
+            fail();
+        bench_new(dst1, src0, src1, LEN);
+    }
+}
+
+static void check_vector_fmul_window(const AVFloatDSPContext *fdsp, const float *src0,
+                                     const float *src1, const float *win)
+{
+    LOCAL_ALIGNED_32(float, dst0, [LEN]);
+    LOCAL_ALIGNED_32(float, dst1, [LEN]);
+
+    declare_func(void, float *dst, const float *src0, const float *src1,
+                 const float *win, int len);
+
+    if (check_func(fdsp->vector_fmul_window, "vector_fmul_window")) {
+        call_ref(dst0, src0, src1, win, LEN / 2);
+        call_new(dst1, src0, src1, win, LEN / 2);
+        if (!float_near_abs_eps_array(dst0, dst1, EPS, LEN))
+            fail();
+        bench_new(dst1, src0, src1, win, LEN / 2);
+    }
+}
+
+static void check_vector_fmac_scalar(const AVFloatDSPContext *fdsp,
+                                     const float *src, float scale)
+{
+    LOCAL_ALIGNED_32(float, dst0, [LEN]);
+    LOCAL_ALIGNED_32(float, dst1, [LEN]);
+
+    declare_func(void, float *dst, const float *src, float mul, int len);
+
+    if (check_func(fdsp->vector_fmac_scalar, "vector_fmac_scalar")) {
+        memcpy(dst0, src, LEN * sizeof(*src));
+        memcpy(dst1, src, LEN * sizeof(*src));
+        call_ref(dst0, src, scale, LEN);
+        call_new(dst1, src, scale, LEN);
+        if (!float_near_abs_eps_array(dst0, dst1, EPS, LEN))
+            fail();
+        bench_new(dst1, src, scale, LEN);
+    }
+}
+
+static void check_vector_fmul_scalar(const AVFloatDSPContext *fdsp,
+                                     const float *src, float scale)
+{
+    LOCAL_ALIGNED_32(float, dst0, [LEN]);
+    LOCAL_ALIGNED_32(float, dst1, [LEN]);
+
+    declare_func(void, float *dst, const float *src, float mul, int len);
+
+    if (check_func(fdsp->vector_fmul_scalar, "vector_fmul_scalar")) {
+        call_ref(dst0, src, scale, LEN);
+        call_new(dst1, src, scale, LEN);
+        if (!float_near_abs_eps_array(dst0, dst1, EPS, LEN))
+            fail();
+        bench_new(dst1, src, scale, LEN);
+    }
+}
+
+static void check_vector_dmul_scalar(const AVFloatDSPContext *fdsp,
+                                     const float *srcf, double scale)
+{
+    LOCAL_ALIGNED_32(double, src,  [LEN]);
+    LOCAL_ALIGNED_32(double, dst0, [LEN]);
+    LOCAL_ALIGNED_32(double, dst1, [LEN]);
+    int i;
+
+    declare_func(void, double *dst, const double *src, double mul, int len);
+
+    for (i = 0; i < LEN; i++)
+        src[i] = srcf[i];
+
+    if (check_func(fdsp->vector_dmul_scalar, "vector_dmul_scalar")) {
+        call_ref(dst0, src, scale, LEN);
+        call_new(dst1, src, scale, LEN);
+        if (!double_near_abs_eps_array(dst0, dst1, EPS, LEN))
+            fail();
+        bench_new(dst1, src, scale, LEN);
+    }
+}
+
+static void check_butterflies_float(const AVFloatDSPContext *fdsp,
+                                    const float *src0, const float *src1)
+{
+    LOCAL_ALIGNED_32(float, v1_ref, [LEN]);
+    LOCAL_ALIGNED_32(float, v2_ref, [LEN]);
+    LOCAL_ALIGNED_32(float, v1_new, [LEN]);
+    LOCAL_ALIGNED_32(float, v2_new, [LEN]);
+
+    declare_func(void, float *av_restrict v1, float *av_restrict v2, int len);
+
+    if (check_func(fdsp->butterflies_float, "butterflies_float")) {
+        memcpy(v1_ref, src0, LEN * sizeof(*src0));
+        memcpy(v2_ref, src1, LEN * sizeof(*src1));
+        memcpy(v1_new, src0, LEN * sizeof(*src0));
+        memcpy(v2_new, src1, LEN * sizeof(*src1));
+        call_ref(v1_ref, v2_ref, LEN);
+        call_new(v1_new, v2_new, LEN);
+        if (!float_near_abs_eps_array(v1_ref, v1_new, EPS, LEN) ||
+            !float_near_abs_eps_array(v2_ref, v2_new, EPS, LEN))
+            fail();
+        bench_new(v1_new, v2_new, LEN);
+    }
+}
+
+static void check_scalarproduct_float(const AVFloatDSPContext *fdsp,
+                                      const float *src0, const float *src1)
+{
+    float res0, res1;
+
+    declare_func(float, const float *v1, const float *v2, int len);
+
+    if (check_func(fdsp->scalarproduct_float, "scalarproduct_float")) {
+        res0 = call_ref(src0, src1, LEN);
+        res1 = call_new(src0, src1, LEN);
+        // the sum of LEN products is compared, so allow for a larger error
+        if (!float_near_abs_eps(res0, res1, EPS * LEN))
+            fail();
+        bench_new(src0, src1, LEN);
+    }
+}
+
+void checkasm_check_float_dsp(void)
+{
+    LOCAL_ALIGNED_32(float, src0, [LEN]);
+    LOCAL_ALIGNED_32(float, src1, [LEN]);
+    LOCAL_ALIGNED_32(float, src2, [LEN]);
+    AVFloatDSPContext fdsp;
+    float scale;
+
+    avpriv_float_dsp_init(&fdsp, 1);
+
+    randomize_buffer(src0);
+    randomize_buffer(src1);
+    randomize_buffer(src2);
+    scale = (float)rnd() / UINT_MAX - 0.5f;
+
+    check_vector_fmul(&fdsp, src0, src1);
+    check_vector_fmul_add(&fdsp, src0, src1, src2);
+    check_vector_fmul_reverse(&fdsp, src0, src1);
+    check_vector_fmul_window(&fdsp, src0, src1, src2);
+    report("vector_fmul");
+    check_vector_fmac_scalar(&fdsp, src0, scale);
+    check_vector_fmul_scalar(&fdsp, src0, scale);
+    check_vector_dmul_scalar(&fdsp, src0, scale);
+    report("vector_fmul_scalar");
+    check_butterflies_float(&fdsp, src0, src1);
+    report("butterflies_float");
+    check_scalarproduct_float(&fdsp, src0, src1);
+    report("scalarproduct_float");
+}
@@ -0,0 +1,173 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/h264dsp.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x01ff01ff, 0x03ff03ff };
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define SIZEOF_COEF  (2 * ((bit_depth + 7) / 8))
+#define PIXEL_STRIDE 32
+
+#define randomize_pixels(buf, size)                                    \
+    do {                                                               \
+        int i;                                                         \
+        uint32_t mask = pixel_mask[bit_depth - 8];                     \
+        for (i = 0; i < size; i += 4)                                  \
+            AV_WN32A(buf + i, rnd() & mask);                           \
+    } while (0)
+
+/* Coefficients are kept small enough for the 16 bit intermediates of the
+ * SIMD versions not to overflow, which valid streams never make them do. */
+#define randomize_coefs(buf, n)                                        \
+    do {                                                               \
+        int i;                                                         \
+        for (i = 0; i < n; i++) {                                      \
+            int v = (int)(rnd() & 511) - 256;                          \
+            if (bit_depth == 8)                                        \
+                ((int16_t *)buf)[i] = v;                               \
+            else                                                       \
+                ((int32_t *)buf)[i] = v << (bit_depth - 8);            \
+        }                                                              \
+    } while (0)
+
+static void check_idct(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, dst,      [8 * PIXEL_STRIDE * 2]);
+    LOCAL_ALIGNED_16(uint8_t, dst0,     [8 * PIXEL_STRIDE * 2]);
+    LOCAL_ALIGNED_16(uint8_t, dst1,     [8 * PIXEL_STRIDE * 2]);
+    LOCAL_ALIGNED_16(int16_t, coef,     [8 * 8 * 2]);
+    LOCAL_ALIGNED_16(int16_t, subcoef0, [8 * 8 * 2]);
+    LOCAL_ALIGNED_16(int16_t, subcoef1, [8 * 8 * 2]);
+    H264DSPContext h;
+    int bit_depth, sz, dc;
+
+    declare_func(void, uint8_t *dst, int16_t *block, int stride);
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth++) {
+        ff_h264dsp_init(&h, bit_depth, 1);
+        for (sz = 4; sz <= 8; sz += 4) {
+            for (dc = 0; dc <= 1; dc++) {
+                void (*idct)(uint8_t *, int16_t *, int) =
+                    sz == 4 ? (dc ? h.h264_idct_dc_add  : h.h264_idct_add) :
+                              (dc ? h.h264_idct8_dc_add : h.h264_idct8_add);
+
+                randomize_pixels(dst, 8 * PIXEL_STRIDE * 2);
+                randomize_coefs(coef, sz * sz);
+
+                if (check_func(idct, "h264_idct%s%s_add_%dbpp",
+                               sz == 8 ? "8" : "", dc ? "_dc" : "", bit_depth)) {
+                    memcpy(dst0, dst, sz * PIXEL_STRIDE * SIZEOF_PIXEL);
+                    memcpy(dst1, dst, sz * PIXEL_STRIDE * SIZEOF_PIXEL);
+                    memcpy(subcoef0, coef, sz * sz * SIZEOF_COEF);
+                    memcpy(subcoef1, coef, sz * sz * SIZEOF_COEF);
+                    call_ref(dst0, subcoef0, PIXEL_STRIDE * SIZEOF_PIXEL);
+                    call_new(dst1, subcoef1, PIXEL_STRIDE * SIZEOF_PIXEL);
+                    if (memcmp(dst0, dst1, sz * PIXEL_STRIDE * SIZEOF_PIXEL) ||
+                        memcmp(subcoef0, subcoef1, sz * sz * SIZEOF_COEF))
+                        fail();
+                    bench_new(dst1, subcoef1, PIXEL_STRIDE * SIZEOF_PIXEL);
+                }
+            }
+        }
+    }
+    report("idct");
+}
+
+/* Fill the area around the edge with a smooth gradient plus some noise, so
+ * that the filter thresholds are actually crossed for some of the pixels. */
+#define randomize_edge(buf)                                            \
+    do {                                                               \
+        int x, y, base = rnd() & ((1 << bit_depth) - 1);               \
+        for (y = 0; y < PIXEL_STRIDE; y++) {                           \
+            for (x = 0; x < PIXEL_STRIDE; x++) {                       \
+                int v = av_clip(base + (int)(rnd() % (17 << (bit_depth - 8))) - \
+                                (8 << (bit_depth - 8)), 0, (1 << bit_depth) - 1); \
+                if (bit_depth == 8)                                    \
+                    buf[y * PIXEL_STRIDE + x] = v;                     \
+                else                                                   \
+                    ((uint16_t *)buf)[y * PIXEL_STRIDE + x] = v;       \
+            }                                                          \
+        }                                                              \
+    } while (0)
+
+static void check_loop_filter(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, buf,  [PIXEL_STRIDE * PIXEL_STRIDE * 2]);
+    LOCAL_ALIGNED_16(uint8_t, buf0, [PIXEL_STRIDE * PIXEL_STRIDE * 2]);
+    LOCAL_ALIGNED_16(uint8_t, buf1, [PIXEL_STRIDE * PIXEL_STRIDE * 2]);
+    H264DSPContext h;
+    int8_t tc0[4];
+    int bit_depth, alpha, beta, i;
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth++) {
+        int stride = PIXEL_STRIDE * SIZEOF_PIXEL;
+        int off    = (PIXEL_STRIDE / 2) * stride + (PIXEL_STRIDE / 2) * SIZEOF_PIXEL;
+        int size   = PIXEL_STRIDE * stride;
+
+        ff_h264dsp_init(&h, bit_depth, 1);
+        randomize_edge(buf);
+        alpha = rnd() % 52;
+        beta  = rnd() % 19;
+        for (i = 0; i < 4; i++)
+            tc0[i] = (int)(rnd() % 27) - 1;
+
+#define CHECK_LF(name, intra)                                               \
+        do {                                                                \
+            if (check_func(h.name, #name "_%dbpp", bit_depth)) {           \
+                memcpy(buf0, buf, size);                                    \
+                memcpy(buf1, buf, size);                                    \
+                if (intra) {                                                \
+                    declare_func(void, uint8_t *pix, int stride, int alpha, int beta); \
+                    call_ref(buf0 + off, stride, alpha, beta);              \
+                    call_new(buf1 + off, stride, alpha, beta);              \
+                    bench_new(buf + off, stride, alpha, beta);              \
+                } else {                                                    \
+                    declare_func(void, uint8_t *pix, int stride, int alpha, int beta, \
+                                 int8_t *tc0);                              \
+                    call_ref(buf0 + off, stride, alpha, beta, tc0);         \
+                    call_new(buf1 + off, stride, alpha, beta, tc0);         \
+                    bench_new(buf + off, stride, alpha, beta, tc0);         \
+                }                                                           \
+                if (memcmp(buf0, buf1, size))                               \
+                    fail();                                                 \
+            }                                                               \
+        } while (0)
+
+        CHECK_LF(h264_v_loop_filter_luma,         0);
+        CHECK_LF(h264_h_loop_filter_luma,         0);
+        CHECK_LF(h264_v_loop_filter_chroma,       0);
+        CHECK_LF(h264_h_loop_filter_chroma,       0);
+        CHECK_LF(h264_v_loop_filter_luma_intra,   1);
+        CHECK_LF(h264_h_loop_filter_luma_intra,   1);
+        CHECK_LF(h264_v_loop_filter_chroma_intra, 1);
+        CHECK_LF(h264_h_loop_filter_chroma_intra, 1);
+#undef CHECK_LF
+    }
+    report("loop_filter");
+}
+
+void checkasm_check_h264dsp(void)
+{
+    check_idct();
+    check_loop_filter();
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/hevcdsp.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x01ff01ff, 0x03ff03ff };
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+
+/* residuals and coefficients are limited to the range valid streams
+ * produce for the given bit depth */
+#define randomize_coefs(buf, n, bits)                   \
+    do {                                                \
+        int j;                                          \
+        for (j = 0; j < n; j++)                         \
+            buf[j] = (int)(rnd() & ((2 << (bits)) - 1)) - (1 << (bits)); \
+    } while (0)
+
+#define randomize_pixels(buf, n)                        \
+    do {                                                \
+        uint32_t mask = pixel_mask[bit_depth - 8];      \
+        int j;                                          \
+        for (j = 0; j < n; j += 4)                      \
+            AV_WN32A(buf + j, rnd() & mask);            \
+    } while (0)
+
+static void check_idct_dc(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(int16_t, coeffs0, [32 * 32]);
+    LOCAL_ALIGNED_32(int16_t, coeffs1, [32 * 32]);
+    int i;
+
+    declare_func(void, int16_t *coeffs);
+
+    for (i = 0; i < 4; i++) {
+        int block_size = 4 << i;
+        int size = block_size * block_size * sizeof(int16_t);
+
+        randomize_coefs(coeffs0, block_size * block_size, 14);
+        memcpy(coeffs1, coeffs0, size);
+
+        if (check_func(h->idct_dc[i], "hevc_idct_%dx%d_dc_%d",
+                       block_size, block_size, bit_depth)) {
+            call_ref(coeffs0);
+            call_new(coeffs1);
+            if (memcmp(coeffs0, coeffs1, size))
+                fail();
+            bench_new(coeffs1);
+        }
+    }
+}
+
+static void check_idct(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(int16_t, coeffs,  [32 * 32]);
+    LOCAL_ALIGNED_32(int16_t, coeffs0, [32 * 32]);
+    LOCAL_ALIGNED_32(int16_t, coeffs1, [32 * 32]);
+    int i;
+
+    declare_func(void, int16_t *coeffs, int col_limit);
+
+    for (i = 0; i < 4; i++) {
+        int block_size = 4 << i;
+        int size = block_size * block_size * sizeof(int16_t);
+
+        randomize_coefs(coeffs, block_size * block_size, bit_depth + 2);
+
+        if (check_func(h->idct[i], "hevc_idct_%dx%d_%d",
+                       block_size, block_size, bit_depth)) {
+            memcpy(coeffs0, coeffs, size);
+            memcpy(coeffs1, coeffs, size);
+            call_ref(coeffs0, block_size);
+            call_new(coeffs1, block_size);
+            if (memcmp(coeffs0, coeffs1, size))
+                fail();
+            memcpy(coeffs1, coeffs, size);
+            bench_new(coeffs1, block_size);
+        }
+    }
+}
+
+static void check_transform_add(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(int16_t, coeffs,  [32 * 32]);
+    LOCAL_ALIGNED_32(int16_t, coeffs0, [32 * 32]);
+    LOCAL_ALIGNED_32(int16_t, coeffs1, [32 * 32]);
+    LOCAL_ALIGNED_32(uint8_t, dst,  [32 * 32 * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [32 * 32 * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [32 * 32 * 2]);
+    int i;
+
+    declare_func(void, uint8_t *dst, int16_t *coeffs, ptrdiff_t stride);
+
+    for (i = 0; i < 4; i++) {
+        int block_size = 4 << i;
+        int size   = block_size * block_size * sizeof(int16_t);
+        int stride = block_size * SIZEOF_PIXEL;
+
+        randomize_coefs(coeffs, block_size * block_size, bit_depth);
+        randomize_pixels(dst, block_size * stride);
+
+        if (check_func(h->transform_add[i], "hevc_transform_add_%dx%d_%d",
+                       block_size, block_size, bit_depth)) {
+            memcpy(coeffs0, coeffs, size);
+            memcpy(coeffs1, coeffs, size);
+            memcpy(dst0, dst, block_size * stride);
+            memcpy(dst1, dst, block_size * stride);
+            call_ref(dst0, coeffs0, stride);
+            call_new(dst1, coeffs1, stride);
+            if (memcmp(dst0, dst1, block_size * stride))
+                fail();
+            bench_new(dst1, coeffs1, stride);
+        }
+    }
+}
+
+void checkasm_check_hevc_idct(void)
+{
+    HEVCDSPContext h;
+    int bit_depth;
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth += 2) {
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_idct_dc(&h, bit_depth);
+    }
+    report("idct_dc");
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth += 2) {
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_idct(&h, bit_depth);
+    }
+    report("idct");
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth += 2) {
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_transform_add(&h, bit_depth);
+    }
+    report("transform_add");
+}
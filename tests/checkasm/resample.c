@@ -0,0 +1,141 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "checkasm.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libswresample/resample.h"
+
+#define FILTER_LENGTH 32
+#define PHASE_SHIFT   5
+#define PHASE_COUNT   (1 << PHASE_SHIFT)
+#define IN_RATE       44100
+#define OUT_RATE      48000
+#define DST_SAMPLES   256
+/* enough input for DST_SAMPLES output samples plus the filter length */
+#define SRC_SAMPLES   (DST_SAMPLES * IN_RATE / OUT_RATE + FILTER_LENGTH + 16)
+
+static const struct {
+    enum AVSampleFormat format;
+    const char *name;
+    int size;
+} formats[] = {
+    { AV_SAMPLE_FMT_S16P, "int16",  2 },
+    { AV_SAMPLE_FMT_S32P, "int32",  4 },
+    { AV_SAMPLE_FMT_FLTP, "float",  4 },
+    { AV_SAMPLE_FMT_DBLP, "double", 8 },
+};
+
+static void randomize_samples(void *buf, enum AVSampleFormat format, int n, int is_filter)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        /* filter taps are kept small enough for the sums not to saturate */
+        double v = ((double)rnd() / UINT_MAX - 0.5) * (is_filter ? 2.0 / FILTER_LENGTH : 1.0);
+
+        switch (format) {
+        case AV_SAMPLE_FMT_S16P: ((int16_t *)buf)[i] = lrint(v * (1 << 15));    break;
+        case AV_SAMPLE_FMT_S32P: ((int32_t *)buf)[i] = lrint(v * (1 << 30));    break;
+        case AV_SAMPLE_FMT_FLTP: ((float   *)buf)[i] = v;                       break;
+        case AV_SAMPLE_FMT_DBLP: ((double  *)buf)[i] = v;                       break;
+        }
+    }
+}
+
+static int compare_samples(const void *a, const void *b, enum AVSampleFormat format, int n)
+{
+    switch (format) {
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array(a, b, 1e-6, n);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array(a, b, 1e-12, n);
+    default:
+        return memcmp(a, b, n * av_get_bytes_per_sample(format));
+    }
+}
+
+static void check_resample(ResampleContext *c, const char *fmt_name,
+                           const uint8_t *src, uint8_t *dst0, uint8_t *dst1)
+{
+    ResampleContext c0, c1;
+    int ret0, ret1;
+
+    declare_func(int, ResampleContext *c, void *dst, const void *src, int n, int update_ctx);
+
+    swri_resample_dsp_init(c);
+    if (check_func(c->dsp.resample, "resample_%s_%s",
+                   c->linear ? "linear" : "common", fmt_name)) {
+        c0 = c1 = *c;
+        memset(dst0, 0, DST_SAMPLES * c->felem_size);
+        memset(dst1, 0, DST_SAMPLES * c->felem_size);
+        ret0 = call_ref(&c0, dst0, src, DST_SAMPLES, 1);
+        ret1 = call_new(&c1, dst1, src, DST_SAMPLES, 1);
+        if (ret0 != ret1 || c0.index != c1.index || c0.frac != c1.frac ||
+            compare_samples(dst0, dst1, c->format, DST_SAMPLES))
+            fail();
+        bench_new(c, dst1, src, DST_SAMPLES, 0);
+    }
+}
+
+void checkasm_check_resample(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [SRC_SAMPLES * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_SAMPLES * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_SAMPLES * 8]);
+    ResampleContext c = { 0 };
+    int i;
+
+    c.filter_length = FILTER_LENGTH;
+    c.filter_alloc  = FFALIGN(FILTER_LENGTH, 8);
+    c.phase_shift   = PHASE_SHIFT;
+    c.phase_mask    = PHASE_COUNT - 1;
+    c.src_incr      = OUT_RATE;
+    c.ideal_dst_incr =
+    c.dst_incr      = IN_RATE * PHASE_COUNT;
+    c.dst_incr_div  = c.dst_incr / c.src_incr;
+    c.dst_incr_mod  = c.dst_incr % c.src_incr;
+
+    /* the linear interpolation reads one phase past the last one */
+    c.filter_bank = av_malloc_array(c.filter_alloc * (PHASE_COUNT + 1), 8);
+    if (!c.filter_bank) {
+        fprintf(stderr, "checkasm: resample filter bank allocation failed\n");
+        return;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        c.format     = formats[i].format;
+        c.felem_size = formats[i].size;
+        c.index      = rnd() & c.phase_mask;
+        c.frac       = rnd() % c.src_incr;
+
+        randomize_samples(c.filter_bank, c.format, c.filter_alloc * (PHASE_COUNT + 1), 1);
+        randomize_samples(src, c.format, SRC_SAMPLES, 0);
+
+        c.linear = 0;
+        check_resample(&c, formats[i].name, src, dst0, dst1);
+        c.linear = 1;
+        check_resample(&c, formats[i].name, src, dst0, dst1);
+    }
+    report("resample");
+
+    av_freep(&c.filter_bank);
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/videodsp.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+#define FRAME_W  64
+#define FRAME_H  64
+#define BLOCK_W  80 /* wider than the frame, to test all edges at once */
+#define BLOCK_H  80
+#define MAX_SIZE (BLOCK_W * BLOCK_H * 2)
+
+#define randomize_buffer(buf, size)             \
+    do {                                        \
+        int k;                                  \
+        for (k = 0; k < size; k += 4)           \
+            AV_WN32A(buf + k, rnd());           \
+    } while (0)
+
+static void check_emulated_edge_mc(int bpc)
+{
+    LOCAL_ALIGNED_16(uint8_t, frame, [FRAME_W * FRAME_H * 2]);
+    LOCAL_ALIGNED_16(uint8_t, dst0,  [MAX_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1,  [MAX_SIZE]);
+    VideoDSPContext vdsp;
+    int bytes = (bpc + 7) >> 3;
+    ptrdiff_t src_stride = FRAME_W * bytes;
+    ptrdiff_t dst_stride = BLOCK_W * bytes;
+    int i;
+
+    declare_func(void, uint8_t *dst, const uint8_t *src,
+                 ptrdiff_t dst_linesize, ptrdiff_t src_linesize,
+                 int block_w, int block_h, int src_x, int src_y, int w, int h);
+
+    ff_videodsp_init(&vdsp, bpc);
+    randomize_buffer(frame, FRAME_W * FRAME_H * bytes);
+
+    if (check_func(vdsp.emulated_edge_mc, "emulated_edge_mc_%d", bpc)) {
+        for (i = 0; i < 64; i++) {
+            /* the block may stick out of the frame on any side, the
+             * function is only called when it does on at least one */
+            int block_w = 1 + rnd() % 22;
+            int block_h = 1 + rnd() % 22;
+            int src_x   = (int)(rnd() % (FRAME_W + 2 * block_w)) - 2 * block_w + block_w / 2;
+            int src_y   = (int)(rnd() % (FRAME_H + 2 * block_h)) - 2 * block_h + block_h / 2;
+            const uint8_t *src = frame + src_y * src_stride + src_x * bytes;
+
+            if (i & 1) {
+                block_w += rnd() % (BLOCK_W - 22);
+                block_h += rnd() % (BLOCK_H - 22);
+                src_x = src_y = -8;
+                src = frame + src_y * src_stride + src_x * bytes;
+            }
+
+            memset(dst0, 0, MAX_SIZE);
+            memset(dst1, 0, MAX_SIZE);
+            call_ref(dst0, src, dst_stride, src_stride,
+                     block_w, block_h, src_x, src_y, FRAME_W, FRAME_H);
+            call_new(dst1, src, dst_stride, src_stride,
+                     block_w, block_h, src_x, src_y, FRAME_W, FRAME_H);
+            if (memcmp(dst0, dst1, MAX_SIZE)) {
+                fail();
+                break;
+            }
+        }
+        bench_new(dst1, frame - 4 * src_stride - 4 * bytes, dst_stride, src_stride,
+                  16, 16, -4, -4, FRAME_W, FRAME_H);
+    }
+}
+
+void checkasm_check_videodsp(void)
+{
+    check_emulated_edge_mc(8);
+    check_emulated_edge_mc(16);
+    report("emulated_edge_mc");
+}
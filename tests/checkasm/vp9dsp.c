@@ -0,0 +1,267 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/vp9dsp.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define BIT_DEPTH_IDX ((bit_depth - 8) >> 1)
+
+#define randomize_buffer(buf, size)                     \
+    do {                                                \
+        uint32_t mask = pixel_mask[BIT_DEPTH_IDX];      \
+        int k;                                          \
+        for (k = 0; k < size; k += 4)                   \
+            AV_WN32A(buf + k, rnd() & mask);            \
+    } while (0)
+
+static void check_itxfm(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst,    [32 * 32 * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst0,   [32 * 32 * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1,   [32 * 32 * 2]);
+    LOCAL_ALIGNED_32(int16_t, coef,   [32 * 32 * 2]);
+    LOCAL_ALIGNED_32(int16_t, coef0,  [32 * 32 * 2]);
+    LOCAL_ALIGNED_32(int16_t, coef1,  [32 * 32 * 2]);
+    static const char *const txfm_names[N_TXFM_TYPES] = {
+        "idct_idct", "idct_iadst", "iadst_idct", "iadst_iadst"
+    };
+    VP9DSPContext dsp;
+    int bit_depth, tx, txtp, dc_only;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t stride, int16_t *block, int eob);
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        int coef_size = SIZEOF_PIXEL * 2; /* int16_t or int32_t */
+
+        ff_vp9dsp_init(&dsp, bit_depth);
+
+        for (tx = TX_4X4; tx <= N_TXFM_SIZES; tx++) {
+            int lossless = tx == N_TXFM_SIZES;
+            int sz       = lossless ? 4 : 4 << tx;
+            int n_txtps  = lossless ? 1 : (tx == TX_32X32 ? 1 : N_TXFM_TYPES);
+            ptrdiff_t stride = sz * SIZEOF_PIXEL;
+
+            for (txtp = 0; txtp < n_txtps; txtp++) {
+                for (dc_only = 0; dc_only <= 1; dc_only++) {
+                    int n = dc_only ? 1 : sz * sz, eob = n, i, x, y;
+
+                    /* only the low frequencies are populated, with values
+                     * in the range reachable by a dequantized residual,
+                     * so that the SIMD intermediates cannot overflow */
+                    memset(coef, 0, sz * sz * coef_size);
+                    for (y = 0; y < FFMIN(sz, 4); y++)
+                        for (x = 0; x < FFMIN(sz, 4); x++) {
+                            int v = (int)(rnd() & 255) - 128;
+                            i = y * sz + x;
+                            if (dc_only && i)
+                                continue;
+                            v <<= bit_depth - 8;
+                            if (bit_depth == 8)
+                                coef[i] = v;
+                            else
+                                ((int32_t *) coef)[i] = v;
+                        }
+                    randomize_buffer(dst, sz * stride);
+
+                    if (check_func(dsp.itxfm_add[tx][txtp], "vp9_inv_%s_%dx%d%s_add_%d",
+                                   lossless ? "wht_wht" : txfm_names[txtp], sz, sz,
+                                   dc_only ? "_dc" : "", bit_depth)) {
+                        memcpy(dst0, dst, sz * stride);
+                        memcpy(dst1, dst, sz * stride);
+                        memcpy(coef0, coef, sz * sz * coef_size);
+                        memcpy(coef1, coef, sz * sz * coef_size);
+                        call_ref(dst0, stride, coef0, eob);
+                        call_new(dst1, stride, coef1, eob);
+                        if (memcmp(dst0, dst1, sz * stride) ||
+                            memcmp(coef0, coef1, sz * sz * coef_size))
+                            fail();
+                        bench_new(dst1, stride, coef1, eob);
+                    }
+                }
+            }
+        }
+    }
+    report("itxfm");
+}
+
+#define LF_STRIDE 32 /* pixels */
+
+/* Fill the buffer with a flat area plus noise, so that the filter decisions
+ * go both ways for different pixels of the edge. */
+static void randomize_loopfilter(uint8_t *buf, int bit_depth)
+{
+    int base = rnd() & ((1 << bit_depth) - 1), x, y;
+
+    for (y = 0; y < LF_STRIDE; y++)
+        for (x = 0; x < LF_STRIDE; x++) {
+            int v = av_clip(base + (int)(rnd() % (9 << (bit_depth - 8))) -
+                            (4 << (bit_depth - 8)), 0, (1 << bit_depth) - 1);
+            if (bit_depth == 8)
+                buf[y * LF_STRIDE + x] = v;
+            else
+                ((uint16_t *) buf)[y * LF_STRIDE + x] = v;
+        }
+}
+
+static void check_loopfilter(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf,  [LF_STRIDE * LF_STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, buf0, [LF_STRIDE * LF_STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [LF_STRIDE * LF_STRIDE * 2]);
+    static const char *const dir_name[2] = { "h", "v" };
+    static const int wd_tab[3] = { 4, 8, 16 };
+    VP9DSPContext dsp;
+    int bit_depth, dir, wd, wd2, lvl[2], E[2], I[2], H[2], i;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t stride, int E, int I, int H);
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ptrdiff_t stride = LF_STRIDE * SIZEOF_PIXEL;
+        int size = LF_STRIDE * stride;
+        int off  = (LF_STRIDE / 2) * (stride + SIZEOF_PIXEL);
+
+        ff_vp9dsp_init(&dsp, bit_depth);
+        for (i = 0; i < 2; i++) {
+            lvl[i] = 1 + rnd() % 63;
+            I[i]   = FFMAX(1, lvl[i] >> (rnd() & 1));
+            E[i]   = 2 * (lvl[i] + 2) + I[i];
+            H[i]   = lvl[i] >> 4;
+        }
+
+#define CHECK_LF(fn, e, i, h, name, ...)                    \
+        do {                                                \
+            if (check_func(fn, name, __VA_ARGS__)) {        \
+                randomize_loopfilter(buf, bit_depth);       \
+                memcpy(buf0, buf, size);                    \
+                memcpy(buf1, buf, size);                    \
+                call_ref(buf0 + off, stride, e, i, h);      \
+                call_new(buf1 + off, stride, e, i, h);      \
+                if (memcmp(buf0, buf1, size))               \
+                    fail();                                 \
+                bench_new(buf1 + off, stride, e, i, h);     \
+            }                                               \
+        } while (0)
+
+        for (dir = 0; dir < 2; dir++) {
+            for (wd = 0; wd < 3; wd++)
+                CHECK_LF(dsp.loop_filter_8[wd][dir], E[0], I[0], H[0],
+                         "vp9_loop_filter_%s_%d_8_%dbpp",
+                         dir_name[dir], wd_tab[wd], bit_depth);
+            CHECK_LF(dsp.loop_filter_16[dir], E[0], I[0], H[0],
+                     "vp9_loop_filter_%s_16_16_%dbpp",
+                     dir_name[dir], bit_depth);
+            for (wd = 0; wd < 2; wd++)
+                for (wd2 = 0; wd2 < 2; wd2++)
+                    CHECK_LF(dsp.loop_filter_mix2[wd][wd2][dir],
+                             E[0] | (E[1] << 8), I[0] | (I[1] << 8), H[0] | (H[1] << 8),
+                             "vp9_loop_filter_mix2_%s_%d%d_16_%dbpp",
+                             dir_name[dir], wd_tab[wd], wd_tab[wd2], bit_depth);
+        }
+#undef CHECK_LF
+    }
+    report("loopfilter");
+}
+
+#define SRC_STRIDE 72 /* pixels */
+#define DST_STRIDE 64 /* pixels */
+#define SRC_OFFSET ((3 * SRC_STRIDE + 3) * SIZEOF_PIXEL)
+
+static void check_mc(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf,  [SRC_STRIDE * SRC_STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst,  [DST_STRIDE * DST_STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_STRIDE * DST_STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_STRIDE * DST_STRIDE * 2]);
+    static const char *const filter_names[4] = {
+        "8tap_smooth", "8tap_regular", "8tap_sharp", "bilin"
+    };
+    static const char *const subpel_names[2][2] = { { "", "v" }, { "h", "hv" } };
+    static const char *const op_names[2] = { "put", "avg" };
+    VP9DSPContext dsp;
+    int op, hsize, bit_depth, filter, dx, dy;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride,
+                 const uint8_t *ref, ptrdiff_t ref_stride,
+                 int h, int mx, int my);
+
+    for (op = 0; op < 2; op++) {
+        for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+            ptrdiff_t src_stride = SRC_STRIDE * SIZEOF_PIXEL;
+            ptrdiff_t dst_stride = DST_STRIDE * SIZEOF_PIXEL;
+            int dst_size = DST_STRIDE * dst_stride;
+
+            ff_vp9dsp_init(&dsp, bit_depth);
+            for (hsize = 0; hsize < 5; hsize++) {
+                int size = 64 >> hsize;
+
+                for (filter = 0; filter < 4; filter++) {
+                    for (dx = 0; dx < 2; dx++) {
+                        for (dy = 0; dy < 2; dy++) {
+                            int mx = dx ? 1 + (rnd() % 15) : 0;
+                            int my = dy ? 1 + (rnd() % 15) : 0;
+
+                            // the full-pel functions do not depend on the filter
+                            if (!dx && !dy && filter)
+                                continue;
+
+                            if (dx || dy) {
+                                if (!check_func(dsp.mc[hsize][filter][op][dx][dy],
+                                                "vp9_%s_%s_%d%s_%dbpp", op_names[op],
+                                                filter_names[filter], size,
+                                                subpel_names[dx][dy], bit_depth))
+                                    continue;
+                            } else {
+                                if (!check_func(dsp.mc[hsize][filter][op][dx][dy],
+                                                "vp9_%s%d_%dbpp", op_names[op],
+                                                size, bit_depth))
+                                    continue;
+                            }
+
+                            randomize_buffer(buf, SRC_STRIDE * src_stride);
+                            randomize_buffer(dst, dst_size);
+                            memcpy(dst0, dst, dst_size);
+                            memcpy(dst1, dst, dst_size);
+                            call_ref(dst0, dst_stride, buf + SRC_OFFSET, src_stride,
+                                     size, mx, my);
+                            call_new(dst1, dst_stride, buf + SRC_OFFSET, src_stride,
+                                     size, mx, my);
+                            if (memcmp(dst0, dst1, dst_size))
+                                fail();
+                            bench_new(dst1, dst_stride, buf + SRC_OFFSET, src_stride,
+                                      size, mx, my);
+                        }
+                    }
+                }
+            }
+        }
+        report("%s", op_names[op]);
+    }
+}
+
+void checkasm_check_vp9dsp(void)
+{
+    check_itxfm();
+    check_loopfilter();
+    check_mc();
+}
@@ -140,6 +140,18 @@ enc_dec_pcm(){
     ffmpeg -flags +bitexact -i ${encfile} -c:a pcm_${pcm_fmt} -f ${dec_fmt} -
 }
 
+enc_dec_framecrc(){
+    out_fmt=$1
+    src_opts=$2
+    src_file=$(target_path $3)
+    shift 3
+    encfile="${outdir}/${test}.${out_fmt}"
+    cleanfiles=$encfile
+    encfile=$(target_path ${encfile})
+    ffmpeg $src_opts -i $src_file "$@" -f $out_fmt -y ${encfile} || return
+    framecrc -i ${encfile}
+}
+
 FLAGS="-flags +bitexact -sws_flags +accurate_rnd+bitexact -fflags +bitexact"
 DEC_OPTS="-threads $threads -idct simple $FLAGS"
 ENC_OPTS="-threads 1        -idct simple -dct fastint"
@@ -180,6 +192,15 @@ lavftest(){
     ${base}/lavf-regression.sh $t lavf tests/vsynth1 "$target_exec" "$target_path" "$threads" "$thread_type" "$cpuflags" "$target_samples"
 }
 
+# run the lavf test $1 with additional output options, which must not change
+# its result
+lavftest_opts(){
+    t=$1
+    shift
+    ref=${base}/ref/lavf/$t
+    ${base}/lavf-regression.sh $t lavf tests/vsynth1 "$target_exec" "$target_path" "$threads" "$thread_type" "$cpuflags" "$target_samples" "$*"
+}
+
 video_filter(){
     filters=$1
     shift
@@ -244,6 +265,22 @@ gapless(){
     do_md5sum $decfile3
 }
 
+stream_info_cache(){
+    cachedir="${outdir}/${test}.cache"
+    rm -rf "$cachedir"
+    mkdir "$cachedir" || return
+
+    # the first run analyzes the input and fills the cache, the second one
+    # must find the same streams, loaded from the cache if it was filled
+    for pass in cold warm; do
+        echo "$pass cache:"
+        run ffprobe -show_streams -print_format compact -bitexact -v 0 \
+            -stream_info_cache "$cachedir" "$@"
+        echo "cache entries: $(ls "$cachedir" | wc -l | tr -d ' ')"
+    done
+    rm -rf "$cachedir"
+}
+
 mkdir -p "$outdir"
 
 # Disable globbing: command arguments may contain globbing characters and
@@ -62,8 +62,16 @@ FATE_LAVF += $(FATE_LAVF_PIXFMT-yes)
 $(FATE_LAVF): $(AREF) $(VREF)
 $(FATE_LAVF): CMD = lavftest
 
-FATE_AVCONV += $(FATE_LAVF)
-fate-lavf:     $(FATE_LAVF)
+# spilling the sample tables to a temporary file must give the same file;
+# the output file is shared with fate-lavf-mov
+FATE_LAVF_OPTS-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-lavf-mov_spill
+fate-lavf-mov_spill: fate-lavf-mov
+fate-lavf-mov_spill: CMD = lavftest_opts mov -max_table_entries 100
+FATE_LAVF_OPTS = $(FATE_LAVF_OPTS-yes)
+$(FATE_LAVF_OPTS): $(AREF) $(VREF)
+
+FATE_AVCONV += $(FATE_LAVF) $(FATE_LAVF_OPTS)
+fate-lavf:     $(FATE_LAVF) $(FATE_LAVF_OPTS)
 
 FATE_LAVF_FATE-$(call ALLYES, MATROSKA_DEMUXER   OGG_MUXER)          += ogg_vp3
 FATE_LAVF_FATE-$(call ALLYES, MOV_DEMUXER        LATM_MUXER)         += latm
@@ -74,3 +82,42 @@ $(FATE_LAVF_FATE): CMD = lavffatetest
 
 FATE_SAMPLES_FFMPEG += $(FATE_LAVF_FATE)
 fate-lavf-fate:        $(FATE_LAVF_FATE)
+
+# packets referencing a memory mapping of the file must be read as copied ones
+FATE_MMAP-$(call DEMDEC, RAWVIDEO, RAWVIDEO) += fate-mmap-rawvideo-copy
+fate-mmap-rawvideo-copy: CMD = framemd5 -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -c copy
+
+FATE_MMAP-$(call DEMDEC, RAWVIDEO, RAWVIDEO) += fate-mmap-rawvideo-copy_mmap
+fate-mmap-rawvideo-copy_mmap: CMD = framemd5 -mmap 1 -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -c copy
+fate-mmap-rawvideo-copy_mmap: REF = $(SRC_PATH)/tests/ref/fate/mmap-rawvideo-copy
+
+FATE_MMAP-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-mmap-mov-copy
+fate-mmap-mov-copy: CMD = framemd5 -i $(TARGET_PATH)/tests/data/lavf/lavf.mov -c copy
+
+FATE_MMAP-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-mmap-mov-copy_mmap
+fate-mmap-mov-copy_mmap: CMD = framemd5 -mmap 1 -i $(TARGET_PATH)/tests/data/lavf/lavf.mov -c copy
+fate-mmap-mov-copy_mmap: REF = $(SRC_PATH)/tests/ref/fate/mmap-mov-copy
+
+FATE_MMAP-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-mmap-mov-decode
+fate-mmap-mov-decode: CMD = framecrc -i $(TARGET_PATH)/tests/data/lavf/lavf.mov
+
+FATE_MMAP-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-mmap-mov-decode_mmap
+fate-mmap-mov-decode_mmap: CMD = framecrc -mmap 1 -i $(TARGET_PATH)/tests/data/lavf/lavf.mov
+fate-mmap-mov-decode_mmap: REF = $(SRC_PATH)/tests/ref/fate/mmap-mov-decode
+
+FATE_MMAP = $(FATE_MMAP-$(call ALLYES, FILE_PROTOCOL FRAMEMD5_MUXER FRAMECRC_MUXER))
+$(filter fate-mmap-rawvideo%, $(FATE_MMAP)): $(VREF)
+# fate-lavf-mov_spill rewrites the same file, do not read it meanwhile
+$(filter fate-mmap-mov%, $(FATE_MMAP)): fate-lavf-mov fate-lavf-mov_spill
+
+FATE_AVCONV += $(FATE_MMAP)
+fate-mmap: $(FATE_MMAP)
+
+# the playlist is appended to, and rewritten when its target duration changes
+FATE_HLSENC-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER MPEG2VIDEO_ENCODER HLS_MUXER MPEGTS_MUXER) += fate-hls-list
+fate-hls-list: tests/data/hls-list.m3u8
+fate-hls-list: CMD = cat $(TARGET_PATH)/tests/data/hls-list.m3u8
+
+FATE_HLSENC = $(FATE_HLSENC-$(CONFIG_FILE_PROTOCOL))
+FATE_AVCONV += $(FATE_HLSENC)
+fate-hlsenc: $(FATE_HLSENC)
@@ -0,0 +1,7 @@
+# checkasm links against internal symbols of the libraries
+FATE_CHECKASM-$(CONFIG_STATIC) += fate-checkasm
+fate-checkasm: $(CHECKASM)
+fate-checkasm: CMD = run tests/checkasm/checkasm
+fate-checkasm: REF = /dev/null
+
+FATE-yes += $(FATE_CHECKASM-yes)
@@ -21,6 +21,35 @@ fate-ffmpeg-filter_complex: CMD = framecrc -filter_complex color=d=1:r=5
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5
 
+FFMPEG_SPLIT_DEPS = TESTSRC_FILTER SPLIT_FILTER SCALE_FILTER HFLIP_FILTER \
+                    SINE_FILTER ASPLIT_FILTER VOLUME_FILTER        \
+                    RAWVIDEO_ENCODER PCM_S16LE_ENCODER
+FFMPEG_SPLIT_GRAPH = -filter_complex "sws_flags=+accurate_rnd+bitexact;testsrc=r=7:d=5,split=3[a][b][c];[b]scale=88:72[b2];[c]hflip[c2];sine=d=5,asplit[x][y];[y]volume=0.5[y2]" \
+  -map "[a]" -map "[b2]" -map "[c2]" -map "[x]" -map "[y2]" -c:v rawvideo -c:a pcm_s16le
+
+FATE_FFMPEG-$(call ALLYES, $(FFMPEG_SPLIT_DEPS)) += fate-ffmpeg-filter_split
+fate-ffmpeg-filter_split: CMD = framecrc $(FFMPEG_SPLIT_GRAPH)
+
+# the branches of split filtered on pipeline threads must give the same output
+FATE_FFMPEG-$(call ALLYES, $(FFMPEG_SPLIT_DEPS)) += fate-ffmpeg-filter_pipeline
+fate-ffmpeg-filter_pipeline: CMD = framecrc -filter_pipeline $(FFMPEG_SPLIT_GRAPH)
+fate-ffmpeg-filter_pipeline: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-filter_split
+
+# encoding each output stream in its own thread must give the same packets,
+# including those the encoder delays because of B-frames
+FFMPEG_SPLIT_MPEG4 = -c:v mpeg4 -bf 2 -qscale 5 -idct simple -dct fastint
+
+FATE_FFMPEG-$(call ALLYES, $(FFMPEG_SPLIT_DEPS) MPEG4_ENCODER) += fate-ffmpeg-encode_split
+fate-ffmpeg-encode_split: CMD = framecrc $(FFMPEG_SPLIT_GRAPH) $(FFMPEG_SPLIT_MPEG4)
+
+FATE_FFMPEG-$(call ALLYES, $(FFMPEG_SPLIT_DEPS) MPEG4_ENCODER) += fate-ffmpeg-encode_pipeline
+fate-ffmpeg-encode_pipeline: CMD = framecrc -encode_pipeline $(FFMPEG_SPLIT_GRAPH) $(FFMPEG_SPLIT_MPEG4)
+fate-ffmpeg-encode_pipeline: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-encode_split
+
+FATE_FFMPEG-$(call ALLYES, $(FFMPEG_SPLIT_DEPS) MPEG4_ENCODER) += fate-ffmpeg-filter_encode_pipeline
+fate-ffmpeg-filter_encode_pipeline: CMD = framecrc -filter_pipeline -encode_pipeline $(FFMPEG_SPLIT_GRAPH) $(FFMPEG_SPLIT_MPEG4)
+fate-ffmpeg-filter_encode_pipeline: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-encode_split
+
 FATE_SAMPLES_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
@@ -29,5 +29,16 @@ FATE_FFPROBE += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+FATE_FFPROBE += fate-stream-info-cache-nut
+fate-stream-info-cache-nut: $(FFPROBE_TEST_FILE)
+fate-stream-info-cache-nut: CMD = stream_info_cache $(FFPROBE_TEST_FILE)
+
+# MPEG-PS streams are not declared in a header, so they are never cached
+FATE_FFPROBE-$(call ALLYES, MPEG1VIDEO_ENCODER MP2_ENCODER MPEG1SYSTEM_MUXER MPEGPS_DEMUXER) += fate-stream-info-cache-mpeg
+fate-stream-info-cache-mpeg: tests/data/ffprobe-test.mpg
+fate-stream-info-cache-mpeg: CMD = stream_info_cache tests/data/ffprobe-test.mpg
+
+FATE_FFPROBE += $(FATE_FFPROBE-yes)
+
 fate-ffprobe: $(FATE_FFPROBE)
 
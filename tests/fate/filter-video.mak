@@ -384,6 +384,11 @@ fate-filter-pixfmts-rotate: CMD = pixfmts "2*PI*n/50"
 FATE_FILTER_PIXFMTS-$(CONFIG_SCALE_FILTER) += fate-filter-pixfmts-scale
 fate-filter-pixfmts-scale: CMD = pixfmts "200:100"
 
+# slice threaded swscale must match the unthreaded output
+FATE_FILTER_PIXFMTS-$(CONFIG_SCALE_FILTER) += fate-filter-pixfmts-scale_threads
+fate-filter-pixfmts-scale_threads: CMD = pixfmts "200:100:threads=4"
+fate-filter-pixfmts-scale_threads: REF = $(SRC_PATH)/tests/ref/fate/filter-pixfmts-scale
+
 FATE_FILTER_PIXFMTS-$(CONFIG_SUPER2XSAI_FILTER) += fate-filter-pixfmts-super2xsai
 fate-filter-pixfmts-super2xsai: CMD = pixfmts
 
@@ -194,6 +194,21 @@ FATE_H264  := $(FATE_H264:%=fate-h264-conformance-%)                    \
               fate-h264-lossless                                        \
 
 FATE_H264-$(call DEMDEC, H264, H264) += $(FATE_H264)
+
+# frame threads decoding the slices of their own frame in parallel must give
+# the same output as a single thread
+define FATE_H264_FRAME_SLICE_TEST
+FATE_H264-$(call DEMDEC, H264, H264) += fate-h264-frame_slice-$(1)
+fate-h264-frame_slice-$(1): CMD = framecrc -vsync drop -slice_threads 2 -i $(TARGET_SAMPLES)/h264-conformance/$(2).264
+fate-h264-frame_slice-$(1): THREADS = 2
+fate-h264-frame_slice-$(1): THREAD_TYPE = frame+slice
+fate-h264-frame_slice-$(1): REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(1)
+endef
+
+$(eval $(call FATE_H264_FRAME_SLICE_TEST,ba1_ft_c,BA1_FT_C))
+$(eval $(call FATE_H264_FRAME_SLICE_TEST,ba3_sva_c,BA3_SVA_C))
+$(eval $(call FATE_H264_FRAME_SLICE_TEST,capama3_sand_f,CAPAMA3_Sand_F))
+$(eval $(call FATE_H264_FRAME_SLICE_TEST,sl1_sva_b,SL1_SVA_B))
 FATE_H264-$(call DEMDEC,  MOV, H264) += fate-h264-crop-to-container
 FATE_H264-$(call DEMDEC,  MOV, H264) += fate-h264-interlace-crop
 FATE_H264-$(call ALLYES, MOV_DEMUXER H264_MP4TOANNEXB_BSF) += fate-h264-bsf-mp4toannexb
@@ -222,6 +222,33 @@ $(foreach N,$(HEVC_SAMPLES_422_10BIN),$(eval $(call FATE_HEVC_TEST_422_10BIN,$(N
 $(foreach N,$(HEVC_SAMPLES_444_8BIT),$(eval $(call FATE_HEVC_TEST_444_8BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_444_12BIT),$(eval $(call FATE_HEVC_TEST_444_12BIT,$(N))))
 
+# frame threads decoding the WPP rows, entry points and slices of their own
+# frame in parallel must give the same output as a single thread
+HEVC_SAMPLES_FRAME_SLICE =      \
+    DSLICE_A_HHI_5              \
+    DSLICE_B_HHI_5              \
+    DSLICE_C_HHI_5              \
+    ENTP_A_Qualcomm_1           \
+    ENTP_B_Qualcomm_1           \
+    ENTP_C_Qualcomm_1           \
+    SLICES_A_Rovi_3             \
+    WPP_A_ericsson_MAIN_2       \
+    WPP_B_ericsson_MAIN_2       \
+    WPP_C_ericsson_MAIN_2       \
+    WPP_D_ericsson_MAIN_2       \
+    WPP_E_ericsson_MAIN_2       \
+    WPP_F_ericsson_MAIN_2       \
+
+define FATE_HEVC_TEST_FRAME_SLICE
+FATE_HEVC += fate-hevc-frame_slice-$(1)
+fate-hevc-frame_slice-$(1): CMD = framecrc -flags unaligned -vsync drop -slice_threads 2 -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit
+fate-hevc-frame_slice-$(1): THREADS = 2
+fate-hevc-frame_slice-$(1): THREAD_TYPE = frame+slice
+fate-hevc-frame_slice-$(1): REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+endef
+
+$(foreach N,$(HEVC_SAMPLES_FRAME_SLICE),$(eval $(call FATE_HEVC_TEST_FRAME_SLICE,$(N))))
+
 fate-hevc-paramchange-yuv420p-yuv420p10: CMD = framecrc -vsync 0 -i $(TARGET_SAMPLES)/hevc/paramchange_yuv420p_yuv420p10.hevc -sws_flags area+accurate_rnd+bitexact
 FATE_HEVC += fate-hevc-paramchange-yuv420p-yuv420p10
 
@@ -77,6 +77,28 @@ FATE_PNG-$(call DEMDEC, IMAGE2, PNG) += $(FATE_PNG)
 FATE_IMAGE += $(FATE_PNG-yes)
 fate-png: $(FATE_PNG-yes)
 
+# the bands of a slice threaded encode must decode to the same images
+PNG_ENC_SRC = "-f rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv
+PNG_ENC_OPTS = -frames:v 5 -sws_flags +accurate_rnd+bitexact -pix_fmt rgb24 -flags +bitexact
+
+FATE_PNG_ENC-$(call ENCDEC, PNG, AVI) += fate-png-enc
+fate-png-enc: CMD = enc_dec_framecrc avi $(PNG_ENC_SRC) $(PNG_ENC_OPTS) -c:v png -threads 1
+
+FATE_PNG_ENC-$(call ENCDEC, PNG, AVI) += fate-png-enc_slice
+fate-png-enc_slice: CMD = enc_dec_framecrc avi $(PNG_ENC_SRC) $(PNG_ENC_OPTS) -c:v png -threads 4 -thread_type slice
+fate-png-enc_slice: REF = $(SRC_PATH)/tests/ref/fate/png-enc
+
+FATE_PNG_ENC-$(call ENCDEC, APNG, APNG) += fate-apng-enc
+fate-apng-enc: CMD = enc_dec_framecrc apng $(PNG_ENC_SRC) $(PNG_ENC_OPTS) -c:v apng -threads 1
+
+FATE_PNG_ENC-$(call ENCDEC, APNG, APNG) += fate-apng-enc_slice
+fate-apng-enc_slice: CMD = enc_dec_framecrc apng $(PNG_ENC_SRC) $(PNG_ENC_OPTS) -c:v apng -threads 4 -thread_type slice
+fate-apng-enc_slice: REF = $(SRC_PATH)/tests/ref/fate/apng-enc
+
+FATE_PNG_ENC = $(FATE_PNG_ENC-$(CONFIG_RAWVIDEO_DEMUXER))
+$(FATE_PNG_ENC): $(VREF)
+FATE_FFMPEG += $(FATE_PNG_ENC)
+
 FATE_IMAGE-$(call DEMDEC, IMAGE2, PTX) += fate-ptx
 fate-ptx: CMD = framecrc -i $(TARGET_SAMPLES)/ptx/_113kw_pic.ptx -pix_fmt rgb24
 
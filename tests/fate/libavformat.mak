@@ -1,3 +1,14 @@
+ifdef HAVE_PTHREADS
+FATE_LIBAVFORMAT-$(call ALLYES, HTTP_PROTOCOL TCP_PROTOCOL) += fate-http
+fate-http: libavformat/http-test$(EXESUF)
+fate-http: CMD = run libavformat/http-test
+endif
+
+FATE_LIBAVFORMAT-yes += fate-format
+fate-format: libavformat/format-test$(EXESUF)
+fate-format: CMD = run libavformat/format-test
+fate-format: REF = /dev/null
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/noproxy-test$(EXESUF)
 fate-noproxy: CMD = run libavformat/noproxy-test
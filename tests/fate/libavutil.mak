@@ -107,6 +107,16 @@ FATE_LIBAVUTIL += fate-sha512
 fate-sha512: libavutil/sha512-test$(EXESUF)
 fate-sha512: CMD = run libavutil/sha512-test
 
+FATE_LIBAVUTIL += fate-threadmessage
+fate-threadmessage: libavutil/threadmessage-test$(EXESUF)
+fate-threadmessage: CMD = run libavutil/threadmessage-test
+fate-threadmessage: REF = /dev/null
+
+FATE_LIBAVUTIL += fate-threadpool
+fate-threadpool: libavutil/threadpool-test$(EXESUF)
+fate-threadpool: CMD = run libavutil/threadpool-test
+fate-threadpool: REF = /dev/null
+
 FATE_LIBAVUTIL += fate-tree
 fate-tree: libavutil/tree-test$(EXESUF)
 fate-tree: CMD = run libavutil/tree-test
@@ -247,12 +247,31 @@ FATE_SEEK_EXTRA-$(CONFIG_MP3_DEMUXER)   += fate-seek-extra-mp3
 fate-seek-extra-mp3:  CMD = run libavformat/seek-test$(EXESUF) $(TARGET_SAMPLES)/gapless/gapless.mp3 -usetoc 0
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
+# the mov demuxer with a compact index must seek like with the full one
+FATE_SEEK_COMPACT-$(call ENCDEC, PCM_S16BE, MOV) += fate-seek-compact-acodec-pcm-s16be
+fate-seek-compact-acodec-pcm-s16be: SRC = fate/acodec-pcm-s16be.mov
+fate-seek-compact-acodec-pcm-s16be: fate-acodec-pcm-s16be
+FATE_SEEK_COMPACT-$(CONFIG_MOV_MUXER) += fate-seek-compact-lavf-mov
+fate-seek-compact-lavf-mov: SRC = lavf/lavf.mov
+fate-seek-compact-lavf-mov: fate-lavf-mov
+FATE_SEEK_COMPACT = $(FATE_SEEK_COMPACT-$(CONFIG_MOV_DEMUXER))
 
-$(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/seek-test$(EXESUF)
+# the matroska demuxer must seek in files without cues, and with the cues
+# before the clusters
+FATE_SEEK_MKV-$(call ENCDEC2, MPEG4, MP2, MATROSKA) += fate-seek-mkv-nocues
+fate-seek-mkv-nocues: tests/data/seek-nocues.mkv
+FATE_SEEK_MKV-$(call ENCDEC2, MPEG4, MP2, MATROSKA) += fate-seek-mkv-frontcues
+fate-seek-mkv-frontcues: tests/data/seek-frontcues.mkv
+FATE_SEEK_MKV = $(FATE_SEEK_MKV-$(call ALLYES, IMAGE2_DEMUXER PGMYUV_DECODER PCM_S16LE_DEMUXER))
+$(FATE_SEEK_MKV): CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/$(@:fate-seek-mkv-%=seek-%).mkv
+
+
+$(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_COMPACT) $(FATE_SEEK_MKV): libavformat/seek-test$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
+$(FATE_SEEK_COMPACT): CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC) -compact_index 1
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_COMPACT) $(FATE_SEEK_MKV)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_COMPACT) $(FATE_SEEK_MKV)
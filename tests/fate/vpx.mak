@@ -121,6 +121,7 @@ $(eval $(call FATE_VP9_SUITE,parallelmode-akiyo))
 $(eval $(call FATE_VP9_SUITE,segmentation-aq-akiyo))
 $(eval $(call FATE_VP9_SUITE,segmentation-sf-akiyo))
 $(eval $(call FATE_VP9_SUITE,tiling-pedestrian))
+$(eval $(call FATE_VP9_SUITE,tiling-pedestrian,-slice,-threads 4 -thread_type slice))
 $(eval $(call FATE_VP9_SUITE,trac3849))
 $(eval $(call FATE_VP9_SUITE,trac4359))
 endef
@@ -12,6 +12,7 @@ target_path=$5
 threads=${6:-1}
 cpuflags=${8:-all}
 target_samples=$9
+extra_enc_opts=${10}
 
 datadir="./tests/data"
 target_datadir="${target_path}/${datadir}"
@@ -46,7 +47,7 @@ echov(){
 AVCONV_OPTS="-nostats -y -cpuflags $cpuflags"
 COMMON_OPTS="-flags +bitexact -idct simple -sws_flags +accurate_rnd+bitexact -fflags +bitexact"
 DEC_OPTS="$COMMON_OPTS -threads $threads"
-ENC_OPTS="$COMMON_OPTS -threads $threads -dct fastint"
+ENC_OPTS="$COMMON_OPTS -threads $threads -dct fastint $extra_enc_opts"
 
 run_avconv()
 {